@@ -0,0 +1,60 @@
+#include "BitStream.h"
+
+/*This function points a writer at an empty buffer.*/
+void startWriting(BitWriter& writer, sf::Uint8* buffer, std::size_t capacity)
+{
+	writer.buffer = buffer;
+	writer.capacity = capacity;
+	writer.bits = 0;
+	writer.overflow = false;
+}
+
+/*This function appends the count low bits of value.*/
+void writeBits(BitWriter& writer, sf::Uint32 value, int count)
+{
+	if (writer.overflow || writer.bits + count > writer.capacity * 8) {
+		writer.overflow = true;
+		return;
+	}
+	for (int i = count - 1; i >= 0; --i)
+	{
+		std::size_t byte = writer.bits >> 3;
+		int shift = 7 - static_cast<int>(writer.bits & 7);
+		if (shift == 7)
+			writer.buffer[byte] = 0;	// the buffer is not cleared beforehand
+		writer.buffer[byte] |= static_cast<sf::Uint8>(((value >> i) & 1) << shift);
+		writer.bits++;
+	}
+}
+
+/*This function returns the size of what was written, the last byte padded with zeros.*/
+std::size_t getWrittenBytes(const BitWriter& writer)
+{
+	return (writer.bits + 7) / 8;
+}
+
+/*This function points a reader at the start of a buffer.*/
+void startReading(BitReader& reader, const sf::Uint8* buffer, std::size_t size)
+{
+	reader.buffer = buffer;
+	reader.size = size;
+	reader.bits = 0;
+	reader.overflow = false;
+}
+
+/*This function reads count bits as an unsigned value.*/
+sf::Uint32 readBits(BitReader& reader, int count)
+{
+	if (reader.overflow || reader.bits + count > reader.size * 8) {
+		reader.overflow = true;
+		return 0;
+	}
+	sf::Uint32 value = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		int shift = 7 - static_cast<int>(reader.bits & 7);
+		value = (value << 1) | ((reader.buffer[reader.bits >> 3] >> shift) & 1);
+		reader.bits++;
+	}
+	return value;
+}
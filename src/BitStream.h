@@ -0,0 +1,29 @@
+#ifndef BIT_STREAM_H
+#define BIT_STREAM_H
+
+#include <SFML/Config.hpp>
+#include <cstddef>
+
+// Writes values of any width up to 32 bits into a caller's buffer, most significant bit first.
+// Nothing is allocated; writing past the end only sets overflow.
+struct BitWriter {
+	sf::Uint8* buffer;
+	std::size_t capacity;	// bytes
+	std::size_t bits;		// bits written so far
+	bool overflow;
+};
+
+struct BitReader {
+	const sf::Uint8* buffer;
+	std::size_t size;		// bytes
+	std::size_t bits;		// bits read so far
+	bool overflow;			// tried to read past the end, every read after that returns 0
+};
+
+void startWriting(BitWriter& writer, sf::Uint8* buffer, std::size_t capacity);
+void writeBits(BitWriter& writer, sf::Uint32 value, int count);
+std::size_t getWrittenBytes(const BitWriter& writer);
+void startReading(BitReader& reader, const sf::Uint8* buffer, std::size_t size);
+sf::Uint32 readBits(BitReader& reader, int count);
+
+#endif
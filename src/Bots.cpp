@@ -0,0 +1,194 @@
+#include "Bots.h"
+#include <iostream>
+#include "Server.h"
+
+/*This function returns the next number of the group's generator (a plain LCG).*/
+static sf::Uint32 nextRandom(BotGroup& group)
+{
+	group.random = group.random * 1664525u + 1013904223u;
+	return group.random >> 16;
+}
+
+/*This function reads the welcomes and states the server sent to the group.*/
+static void receiveServerPackets(BotGroup& group)
+{
+	sf::Packet packet;
+	sf::IpAddress address;
+	unsigned short port;
+	while (group.socket.receive(packet, address, port) == sf::Socket::Done)
+	{
+		sf::Uint8 type;
+		if (!(packet >> type))
+			continue;
+		if (type == welcomeMessage)
+		{
+			sf::Uint32 id, match;
+			sf::Uint8 player;
+			if (!(packet >> id >> match >> player) || id < group.firstId || id - group.firstId >= group.bots.size())
+				continue;
+			Bot& bot = group.bots[id - group.firstId];
+			bot.joined = true;
+			bot.match = match;
+			bot.player = player;
+		}
+		else if (type == stateMessage)
+		{
+			BitReader reader;
+			startReading(reader, static_cast<const sf::Uint8*>(packet.getData()), packet.getDataSize());
+			readBits(reader, 8);
+			sf::Uint32 id = readBits(reader, 32);
+			readBits(reader, 32);	// newest input applied, bots don't predict
+			if (reader.overflow || id < group.firstId || id - group.firstId >= group.bots.size())
+				continue;
+			Bot& bot = group.bots[id - group.firstId];
+			group.bytesReceived += packet.getDataSize();
+			if (!decodeSnapshot(reader, group.decoded, bot.received)) {
+				group.statesLost++;
+				continue;
+			}
+			bot.received[group.decoded.tick & (SNAPSHOT_HISTORY - 1)] = group.decoded;
+			if (group.decoded.tick > bot.ackedTick)
+				bot.ackedTick = group.decoded.tick;
+			group.statesReceived++;
+		}
+	}
+}
+
+/*This function sends, for every bot of the group, a join request or the input of this tick.*/
+static void sendBotPackets(BotGroup& group)
+{
+	sf::Packet packet;
+	for (std::size_t i = 0; i < group.bots.size(); ++i)
+	{
+		Bot& bot = group.bots[i];
+		packet.clear();
+		if (!bot.joined)
+		{
+			if (group.ticks % BOT_JOIN_RETRY_TICKS != 0)
+				continue;
+			packet << static_cast<sf::Uint8>(joinMessage) << bot.id;
+		}
+		else
+		{
+			if (nextRandom(group) % BOT_INPUT_HOLD_TICKS == 0)
+				bot.input = static_cast<sf::Uint8>(nextRandom(group) % 8);
+			packet << static_cast<sf::Uint8>(inputMessage) << bot.match << bot.player << group.ticks
+				<< static_cast<sf::Uint8>(1) << bot.input << bot.ackedTick;
+		}
+		group.socket.send(packet, group.serverAddress, bot.serverPort);
+	}
+}
+
+/*This function is the loop of a bot thread, ticking at the server's rate.*/
+static void runBotGroup(BotGroup* group)
+{
+	sf::Clock clock;
+	sf::Int64 nextTick = 0;
+	while (*group->running)
+	{
+		sf::Int64 now = clock.getElapsedTime().asMicroseconds();
+		if (now < nextTick)
+		{
+			if (group->selector.wait(sf::microseconds(nextTick - now)))
+				receiveServerPackets(*group);
+			continue;
+		}
+		receiveServerPackets(*group);
+		sendBotPackets(*group);
+		group->ticks++;
+		nextTick += TICK_MICROSECONDS;
+	}
+}
+
+/*This function starts two bots per match, spread over groupCount threads. Bots are spread evenly
+over the shards; the server seats them in the order their join requests arrive.*/
+bool startBots(BotLoad& load, const sf::IpAddress& serverAddress, unsigned short basePort, int shardCount, int matches, int groupCount)
+{
+	load.groups = new BotGroup[groupCount];
+	load.groupCount = groupCount;
+	load.running = true;
+
+	int botCount = matches * 2;
+	for (int g = 0; g < groupCount; ++g)
+	{
+		BotGroup& group = load.groups[g];
+		if (group.socket.bind(sf::Socket::AnyPort) != sf::Socket::Done) {
+			std::cout << "Could not bind a UDP port for the bots" << std::endl;
+			delete[] load.groups;
+			load.groups = NULL;
+			return false;
+		}
+		group.socket.setBlocking(false);
+		group.selector.add(group.socket);
+		group.serverAddress = serverAddress;
+		group.running = &load.running;
+		group.random = g + 1;
+		group.ticks = 0;
+		group.statesReceived = 0;
+		group.bytesReceived = 0;
+		group.statesLost = 0;
+
+		// Whole matches per group, so both players of a match share a thread
+		int firstMatch = matches * g / groupCount;
+		int lastMatch = matches * (g + 1) / groupCount;
+		group.firstId = firstMatch * 2;
+		group.bots.reserve((lastMatch - firstMatch) * 2);
+		for (int id = firstMatch * 2; id < lastMatch * 2 && id < botCount; ++id)
+		{
+			group.bots.push_back(Bot());
+			Bot& bot = group.bots.back();
+			bot.id = id;
+			bot.serverPort = static_cast<unsigned short>(basePort + (id / 2) % shardCount);
+			bot.joined = false;
+			bot.match = 0;
+			bot.player = 0;
+			bot.input = 0;
+			bot.ackedTick = 0;
+			for (int i = 0; i < SNAPSHOT_HISTORY; ++i)
+				clearSnapshot(bot.received[i]);
+		}
+	}
+
+	for (int g = 0; g < groupCount; ++g)
+	{
+		load.threads.push_back(new sf::Thread(&runBotGroup, &load.groups[g]));
+		load.threads.back()->launch();
+	}
+	return true;
+}
+
+/*This function stops the bot threads and prints how many states came back, out of one per bot per
+server tick.*/
+void stopBots(BotLoad& load, std::ostream& report)
+{
+	load.running = false;
+	for (std::size_t i = 0; i < load.threads.size(); ++i)
+	{
+		load.threads[i]->wait();
+		delete load.threads[i];
+	}
+	load.threads.clear();
+
+	sf::Uint64 bots = 0, joined = 0, states = 0, bytes = 0, lost = 0;
+	sf::Uint32 ticks = 0;
+	for (int g = 0; g < load.groupCount; ++g)
+	{
+		const BotGroup& group = load.groups[g];
+		for (std::size_t i = 0; i < group.bots.size(); ++i)
+			joined += group.bots[i].joined ? 1 : 0;
+		bots += group.bots.size();
+		states += group.statesReceived;
+		bytes += group.bytesReceived;
+		lost += group.statesLost;
+		if (group.ticks > ticks)
+			ticks = group.ticks;
+	}
+	report << "BOTS" << std::endl;
+	report << "  " << joined << " of " << bots << " bots seated, " << states << " states received";
+	if (joined > 0 && ticks > 0 && states > 0)
+		report << " (" << 100.0 * states / (joined * ticks) << "% of ticks), " << bytes / (states + lost) << " bytes per state";
+	report << ", " << lost << " without baseline" << std::endl;
+
+	delete[] load.groups;
+	load.groups = NULL;
+}
@@ -0,0 +1,51 @@
+#ifndef BOTS_H
+#define BOTS_H
+
+#include <SFML/Network.hpp>
+#include <atomic>
+#include <ostream>
+#include <vector>
+#include "Snapshot.h"
+
+const int BOT_JOIN_RETRY_TICKS = 15;	// ticks between join requests until the server answers
+const int BOT_INPUT_HOLD_TICKS = 10;	// a bot keeps pressing the same keys about this long
+
+// A fake player. It moves and fires at random and decodes what the server sends back.
+struct Bot {
+	sf::Uint32 id;
+	unsigned short serverPort;	// port of the shard the bot plays on
+	bool joined;
+	sf::Uint32 match;
+	sf::Uint8 player;
+	sf::Uint8 input;
+	Snapshot received[SNAPSHOT_HISTORY];	// by tick, baselines of the next snapshots
+	sf::Uint32 ackedTick;					// newest snapshot received, 0 for none
+};
+
+// Bots sharing one socket and one thread, so thousands of them don't need thousands of sockets.
+struct BotGroup {
+	sf::UdpSocket socket;
+	sf::SocketSelector selector;
+	sf::IpAddress serverAddress;
+	std::vector<Bot> bots;
+	sf::Uint32 firstId;
+	sf::Uint32 random;				// state of the group's own generator, rand() is not thread safe
+	const std::atomic<bool>* running;
+	sf::Uint32 ticks;
+	sf::Uint64 statesReceived;
+	sf::Uint64 bytesReceived;
+	sf::Uint64 statesLost;			// could not be decoded, their baseline was gone
+	Snapshot decoded;
+};
+
+struct BotLoad {
+	BotGroup* groups;
+	int groupCount;
+	std::vector<sf::Thread*> threads;
+	std::atomic<bool> running;
+};
+
+bool startBots(BotLoad& load, const sf::IpAddress& serverAddress, unsigned short basePort, int shardCount, int matches, int groupCount);
+void stopBots(BotLoad& load, std::ostream& report);
+
+#endif
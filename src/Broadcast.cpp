@@ -0,0 +1,444 @@
+#include "Broadcast.h"
+#include <cstring>
+#include <iostream>
+#include "Server.h"
+#include "StateHash.h"
+
+/*This function writes a float with all its bits, so a keyframe restores the match exactly.*/
+static void writeFloat(BitWriter& writer, float value)
+{
+	sf::Uint32 bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	writeBits(writer, bits, 32);
+}
+
+static float readFloat(BitReader& reader)
+{
+	sf::Uint32 bits = readBits(reader, 32);
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/*This function drops the viewers that stopped subscribing.*/
+static void expireSpectators(SpectatorFanout& fanout, sf::Uint32 now)
+{
+	for (std::size_t i = 0; i < fanout.spectators.size();)
+	{
+		if (now - fanout.spectators[i].lastSeen <= static_cast<sf::Uint32>(SPECTATOR_TIMEOUT_TICKS)) {
+			++i;
+			continue;
+		}
+		fanout.spectators[i] = fanout.spectators.back();
+		fanout.spectators.pop_back();
+	}
+}
+
+/*This function takes a viewer's subscription. A known viewer is only kept alive; a new one is
+fed if there is room, otherwise it is sent to one of the relays fed here, in turn.*/
+void addSpectator(SpectatorFanout& fanout, sf::UdpSocket& socket, sf::Uint32 matchId, const sf::IpAddress& address,
+	unsigned short port, bool relay, sf::Uint32 now)
+{
+	expireSpectators(fanout, now);
+	for (std::size_t i = 0; i < fanout.spectators.size(); ++i)
+	{
+		Spectator& spectator = fanout.spectators[i];
+		if (spectator.address == address && spectator.port == port) {
+			spectator.relay = relay;
+			spectator.lastSeen = now;
+			return;
+		}
+	}
+
+	if (fanout.spectators.size() < static_cast<std::size_t>(SPECTATOR_FANOUT))
+	{
+		Spectator spectator;
+		spectator.address = address;
+		spectator.port = port;
+		spectator.relay = relay;
+		spectator.lastSeen = now;
+		fanout.spectators.push_back(spectator);
+		return;
+	}
+
+	for (std::size_t i = 0; i < fanout.spectators.size(); ++i)
+	{
+		const Spectator& target = fanout.spectators[(fanout.nextRedirect + i) % fanout.spectators.size()];
+		if (!target.relay)
+			continue;
+		fanout.nextRedirect = (fanout.nextRedirect + i + 1) % fanout.spectators.size();
+
+		sf::Uint8 buffer[11];
+		BitWriter writer;
+		startWriting(writer, buffer, sizeof(buffer));
+		writeBits(writer, redirectMessage, 8);
+		writeBits(writer, matchId, 32);
+		writeBits(writer, target.address.toInteger(), 32);
+		writeBits(writer, target.port, 16);
+		socket.send(buffer, sizeof(buffer), address, port);
+		fanout.redirects++;
+		return;
+	}
+	fanout.refused++;
+}
+
+/*This function sends one stream packet to every viewer fed here.*/
+void sendToSpectators(SpectatorFanout& fanout, sf::UdpSocket& socket, const sf::Uint8* data, std::size_t size, sf::Uint32 now)
+{
+	expireSpectators(fanout, now);
+	for (std::size_t i = 0; i < fanout.spectators.size(); ++i)
+	{
+		socket.send(data, size, fanout.spectators[i].address, fanout.spectators[i].port);
+		fanout.bytesSent += size;
+	}
+}
+
+/*This function writes the inputs both players played on the newest ticks, oldest first, and the
+hash of the match after the newest one. inputs holds them by tick modulo STREAM_REDUNDANCY,
+player 1 in the low bits. Returns the size.*/
+std::size_t writeInputStream(sf::Uint8* buffer, std::size_t capacity, sf::Uint32 matchId, sf::Uint32 newestTick,
+	const sf::Uint8* inputs, sf::Uint64 hash)
+{
+	sf::Uint32 count = (newestTick + 1 < static_cast<sf::Uint32>(STREAM_REDUNDANCY)) ? newestTick + 1 : STREAM_REDUNDANCY;
+	BitWriter writer;
+	startWriting(writer, buffer, capacity);
+	writeBits(writer, inputStreamMessage, 8);
+	writeBits(writer, matchId, 32);
+	writeBits(writer, newestTick, 32);
+	writeBits(writer, static_cast<sf::Uint32>(hash >> 32), 32);
+	writeBits(writer, static_cast<sf::Uint32>(hash), 32);
+	writeBits(writer, count, 8);
+	for (sf::Uint32 tick = newestTick - count + 1; tick != newestTick + 1; ++tick)
+		writeBits(writer, inputs[tick % STREAM_REDUNDANCY], 6);
+	return writer.overflow ? 0 : getWrittenBytes(writer);
+}
+
+/*This function writes the whole match as it is before a tick is simulated, every value exact (a
+fixed point match sends its integers in place of the floats). Returns the size, or 0 if it does not fit.*/
+std::size_t writeKeyframe(sf::Uint8* buffer, std::size_t capacity, sf::Uint32 matchId, sf::Uint32 tick, const Match& match)
+{
+	const World& world = match.world;
+	int count = world.archetypes[BULLET_ARCHETYPE].count;
+	if (count > MAX_KEYFRAME_BULLETS)
+		return 0;
+
+	BitWriter writer;
+	startWriting(writer, buffer, capacity);
+	writeBits(writer, keyframeMessage, 8);
+	writeBits(writer, matchId, 32);
+	writeBits(writer, tick, 32);
+	writeBits(writer, static_cast<sf::Uint32>(match.ticksOver), 32);
+	writeBits(writer, static_cast<sf::Uint32>(match.round), 32);
+	bool fixed = match.fixedPoint;
+	writeBits(writer, fixed, 1);
+	const Position* positions = getColumn<Position>(world, SHIP_ARCHETYPE);
+	const FixedPosition* fixedPositions = getColumn<FixedPosition>(world, SHIP_ARCHETYPE);
+	const Gun* guns = getColumn<Gun>(world, SHIP_ARCHETYPE);
+	const Health* health = getColumn<Health>(world, SHIP_ARCHETYPE);
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		if (fixed) {
+			writeBits(writer, static_cast<sf::Uint32>(fixedPositions[i].x), 32);
+			writeBits(writer, static_cast<sf::Uint32>(fixedPositions[i].y), 32);
+		}
+		else {
+			writeFloat(writer, positions[i].x);
+			writeFloat(writer, positions[i].y);
+		}
+		writeBits(writer, static_cast<sf::Uint32>(guns[i].ticksSinceShot), 32);
+		writeBits(writer, static_cast<sf::Uint32>(health[i].points), 32);
+		writeBits(writer, health[i].hit, 1);
+		if (fixed)
+			writeBits(writer, static_cast<sf::Uint32>(guns[i].cooldownTicks), 32);
+		else
+			writeFloat(writer, guns[i].cooldownRate);
+		writeBits(writer, guns[i].moved, 1);
+		writeBits(writer, guns[i].startTrigger, 1);
+	}
+	positions = getColumn<Position>(world, BULLET_ARCHETYPE);
+	fixedPositions = getColumn<FixedPosition>(world, BULLET_ARCHETYPE);
+	const Projectile* projectiles = getColumn<Projectile>(world, BULLET_ARCHETYPE);
+	writeBits(writer, static_cast<sf::Uint32>(count), 8);
+	for (int i = 0; i < count; ++i)
+	{
+		if (fixed) {
+			writeBits(writer, static_cast<sf::Uint32>(fixedPositions[i].x), 32);
+			writeBits(writer, static_cast<sf::Uint32>(fixedPositions[i].y), 32);
+		}
+		else {
+			writeFloat(writer, positions[i].x);
+			writeFloat(writer, positions[i].y);
+		}
+		writeBits(writer, projectiles[i].owner, 1);
+		writeBits(writer, projectiles[i].collided, 1);
+	}
+	return writer.overflow ? 0 : getWrittenBytes(writer);
+}
+
+/*This function reads a keyframe, after its header, into a match set up with initializeMatch.*/
+static bool readKeyframe(BitReader& reader, Match& match)
+{
+	match.ticksOver = static_cast<int>(readBits(reader, 32));
+	match.round = static_cast<int>(readBits(reader, 32));
+	match.fixedPoint = readBits(reader, 1) != 0;
+	bool fixed = match.fixedPoint;
+	World& world = match.world;
+	Position* positions = getColumn<Position>(world, SHIP_ARCHETYPE);
+	FixedPosition* fixedPositions = getColumn<FixedPosition>(world, SHIP_ARCHETYPE);
+	Gun* guns = getColumn<Gun>(world, SHIP_ARCHETYPE);
+	Health* health = getColumn<Health>(world, SHIP_ARCHETYPE);
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		if (fixed) {
+			fixedPositions[i].x = static_cast<Fixed>(readBits(reader, 32));
+			fixedPositions[i].y = static_cast<Fixed>(readBits(reader, 32));
+		}
+		else {
+			positions[i].x = readFloat(reader);
+			positions[i].y = readFloat(reader);
+		}
+		guns[i].ticksSinceShot = static_cast<int>(readBits(reader, 32));
+		health[i].points = static_cast<int>(readBits(reader, 32));
+		health[i].hit = readBits(reader, 1) != 0;
+		if (fixed)
+			guns[i].cooldownTicks = static_cast<Fixed>(readBits(reader, 32));
+		else
+			guns[i].cooldownRate = readFloat(reader);
+		guns[i].moved = readBits(reader, 1) != 0;
+		guns[i].startTrigger = readBits(reader, 1) != 0;
+	}
+	sf::Uint32 count = readBits(reader, 8);
+	if (count > static_cast<sf::Uint32>(MAX_KEYFRAME_BULLETS))
+		return false;
+	clearArchetype(world, BULLET_ARCHETYPE);
+	for (sf::Uint32 i = 0; i < count && !reader.overflow; ++i)
+	{
+		Fixed fixedX = 0, fixedY = 0;
+		sf::Vector2f position;
+		if (fixed) {
+			fixedX = static_cast<Fixed>(readBits(reader, 32));
+			fixedY = static_cast<Fixed>(readBits(reader, 32));
+		}
+		else {
+			position.x = readFloat(reader);
+			position.y = readFloat(reader);
+		}
+		sf::Uint8 owner = static_cast<sf::Uint8>(readBits(reader, 1));
+		bool collided = readBits(reader, 1) != 0;
+		int row = addBullet(world, position, owner);
+		if (row < 0)
+			return false;
+		getColumn<FixedPosition>(world, BULLET_ARCHETYPE)[row].x = fixedX;
+		getColumn<FixedPosition>(world, BULLET_ARCHETYPE)[row].y = fixedY;
+		getColumn<Projectile>(world, BULLET_ARCHETYPE)[row].collided = collided;
+	}
+	if (fixed)
+		syncFixedPositions(world);
+	return !reader.overflow;
+}
+
+/*This function asks the upstream to keep feeding this viewer.*/
+static void subscribe(SpectatorSession& session)
+{
+	sf::Uint8 buffer[6];
+	BitWriter writer;
+	startWriting(writer, buffer, sizeof(buffer));
+	writeBits(writer, subscribeMessage, 8);
+	writeBits(writer, session.matchId, 32);
+	writeBits(writer, session.relay, 8);
+	session.socket.send(buffer, sizeof(buffer), session.upstreamAddress, session.upstreamPort);
+}
+
+/*This function buffers the inputs of a stream packet until their tick is simulated.*/
+static void handleInputStream(SpectatorSession& session, BitReader& reader)
+{
+	sf::Uint32 newestTick = readBits(reader, 32);
+	sf::Uint64 hash = static_cast<sf::Uint64>(readBits(reader, 32)) << 32;
+	hash |= readBits(reader, 32);
+	sf::Uint32 count = readBits(reader, 8);
+	if (reader.overflow || count == 0 || count > newestTick + 1)
+		return;
+	if (!session.synced || (newestTick >= session.tick && newestTick < session.tick + STREAM_HISTORY)) {
+		session.hashes[newestTick & (STREAM_HISTORY - 1)] = hash;
+		session.hashTicks[newestTick & (STREAM_HISTORY - 1)] = newestTick;
+	}
+	for (sf::Uint32 tick = newestTick - count + 1; tick != newestTick + 1; ++tick)
+	{
+		sf::Uint8 input = static_cast<sf::Uint8>(readBits(reader, 6));
+		if (reader.overflow)
+			return;
+		if (session.synced && (tick < session.tick || tick >= session.tick + STREAM_HISTORY))
+			continue;
+		session.inputs[tick & (STREAM_HISTORY - 1)] = input;
+		session.inputTicks[tick & (STREAM_HISTORY - 1)] = tick;
+	}
+}
+
+/*This function simulates the ticks whose inputs arrived, in order, and checks them against the
+server's hashes where one arrived.*/
+static void simulateReadyTicks(SpectatorSession& session)
+{
+	while (session.synced && session.inputTicks[session.tick & (STREAM_HISTORY - 1)] == session.tick)
+	{
+		int slot = session.tick & (STREAM_HISTORY - 1);
+		simulateTick(session.match, session.inputs[slot] & 7, session.inputs[slot] >> 3);
+		if (session.hashTicks[slot] == session.tick)
+		{
+			session.checkedHashes++;
+			if (hashMatch(session.match) != session.hashes[slot])
+				session.badHashes++;
+		}
+		session.tick++;
+	}
+}
+
+/*This function uses a keyframe: it starts the match of a new viewer, checks the simulated match
+when both are at the same tick, and jumps ahead over inputs that were lost for good.*/
+static void handleKeyframe(SpectatorSession& session, BitReader& reader)
+{
+	sf::Uint32 tick = readBits(reader, 32);
+	simulateReadyTicks(session);
+	if (session.synced && tick < session.tick)
+		return;		// late
+	if (!readKeyframe(reader, session.keyframe))
+		return;
+	session.keyframes++;
+
+	if (session.synced && tick == session.tick)
+	{
+		if (isSameMatch(session.match, session.keyframe)) {
+			session.verified++;
+			return;
+		}
+		if (session.desyncs++ == 0) {
+			std::cout << "Out of sync at tick " << tick << " (simulated | keyframe):" << std::endl;
+			printMatchDiff(session.match, session.keyframe, std::cout);
+		}
+	}
+	else if (session.synced)
+		session.resyncs++;
+	session.match = session.keyframe;
+	session.tick = tick;
+	session.synced = true;
+}
+
+/*This function binds the socket (a relay on the port its viewers subscribe to, a viewer on any
+port) and prepares a session that has not seen a keyframe yet.*/
+bool startSpectator(SpectatorSession& session, unsigned short localPort, const sf::IpAddress& upstreamAddress,
+	unsigned short upstreamPort, sf::Uint32 matchId, bool relay)
+{
+	if (session.socket.bind(localPort) != sf::Socket::Done)
+		return false;
+	session.socket.setBlocking(false);
+	session.upstreamAddress = upstreamAddress;
+	session.upstreamPort = upstreamPort;
+	session.matchId = matchId;
+	session.relay = relay;
+	session.updates = 0;
+	session.synced = false;
+	initializeMatch(session.match);
+	initializeMatch(session.keyframe);
+	session.tick = 0;
+	for (int i = 0; i < STREAM_HISTORY; ++i) {
+		session.inputTicks[i] = 0xFFFFFFFF;
+		session.hashTicks[i] = 0xFFFFFFFF;
+	}
+	session.fanout.spectators.clear();
+	session.fanout.nextRedirect = 0;
+	session.fanout.bytesSent = 0;
+	session.fanout.redirects = 0;
+	session.fanout.refused = 0;
+	session.keyframes = 0;
+	session.verified = 0;
+	session.desyncs = 0;
+	session.resyncs = 0;
+	session.checkedHashes = 0;
+	session.badHashes = 0;
+	session.redirected = 0;
+	session.bytesReceived = 0;
+	return true;
+}
+
+/*This function runs once per tick: it keeps the subscription alive, reads the stream (a relay
+passes every packet on untouched first) and simulates the ticks whose inputs arrived.*/
+void updateSpectator(SpectatorSession& session)
+{
+	if (session.updates++ % SPECTATOR_RESUBSCRIBE_TICKS == 0)
+		subscribe(session);
+
+	std::size_t received;
+	sf::IpAddress sender;
+	unsigned short senderPort;
+	while (session.socket.receive(session.buffer, sizeof(session.buffer), received, sender, senderPort) == sf::Socket::Done)
+	{
+		session.bytesReceived += received;
+		BitReader reader;
+		startReading(reader, session.buffer, received);
+		sf::Uint32 type = readBits(reader, 8);
+		if (readBits(reader, 32) != session.matchId)
+			continue;
+
+		if (type == subscribeMessage)
+		{
+			bool relay = readBits(reader, 8) != 0;
+			if (session.relay && !reader.overflow)
+				addSpectator(session.fanout, session.socket, session.matchId, sender, senderPort, relay, session.updates);
+			continue;
+		}
+		if (sender != session.upstreamAddress || senderPort != session.upstreamPort)
+			continue;
+
+		if (type == redirectMessage)
+		{
+			sf::IpAddress address(readBits(reader, 32));
+			unsigned short port = static_cast<unsigned short>(readBits(reader, 16));
+			if (reader.overflow)
+				continue;
+			session.upstreamAddress = address;
+			session.upstreamPort = port;
+			session.redirected++;
+			subscribe(session);
+			continue;
+		}
+		if (session.relay)
+			sendToSpectators(session.fanout, session.socket, session.buffer, received, session.updates);
+		if (type == inputStreamMessage)
+			handleInputStream(session, reader);
+		else if (type == keyframeMessage)
+			handleKeyframe(session, reader);
+	}
+	simulateReadyTicks(session);
+}
+
+/*This function copies the simulated match into a match for drawing. Both are laid out the same,
+so the copy never allocates.*/
+void getSpectatorView(const SpectatorSession& session, Match& view)
+{
+	if (!session.synced)
+		return;
+	view = session.match;
+}
+
+/*This function prints how well the viewer kept up with the match, and what a relay passed on.*/
+void printSpectatorReport(const SpectatorSession& session, std::ostream& out)
+{
+	out << (session.relay ? "RELAY" : "SPECTATOR") << " (match " << session.matchId << ")" << std::endl;
+	if (!session.synced) {
+		out << "  no keyframe received" << std::endl;
+		return;
+	}
+	out << "  simulated up to tick " << session.tick << ", " << session.keyframes << " keyframes: "
+		<< session.verified << " matched, " << session.desyncs << " out of sync, "
+		<< session.resyncs << " skipped lost inputs" << std::endl;
+	out << "  " << session.checkedHashes << " ticks checked against the server's state hash, " << session.badHashes
+		<< " differed" << std::endl;
+	out << "  " << session.bytesReceived << " bytes received";
+	if (session.updates > 0)
+		out << " (" << session.bytesReceived / session.updates << " per tick)";
+	if (session.redirected > 0)
+		out << ", redirected " << session.redirected << " times";
+	out << std::endl;
+	if (session.relay)
+		out << "  " << session.fanout.spectators.size() << " viewers, " << session.fanout.bytesSent << " bytes sent, "
+			<< session.fanout.redirects << " redirected, " << session.fanout.refused << " refused" << std::endl;
+}
@@ -0,0 +1,81 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <SFML/Network.hpp>
+#include <ostream>
+#include <vector>
+#include "BitStream.h"
+#include "Simulation.h"
+
+// Spectator settings.
+const int KEYFRAME_TICKS = 2 * TICK_RATE;		// a viewer that joins or falls behind waits at most this long
+const int STREAM_REDUNDANCY = 8;				// each stream packet repeats the inputs of this many ticks
+const int STREAM_HISTORY = 64;					// inputs a viewer buffers ahead, must be a power of two
+const int SPECTATOR_FANOUT = 4;					// viewers fed by a server match or by a relay, the rest are redirected
+const int SPECTATOR_RESUBSCRIBE_TICKS = TICK_RATE;
+const int SPECTATOR_TIMEOUT_TICKS = 3 * TICK_RATE;	// a viewer that stops subscribing is dropped
+const int MAX_KEYFRAME_BULLETS = MAX_BULLETS;
+const int MAX_KEYFRAME_BYTES = 1024;			// worst case is about 580 bytes
+
+// A viewer or relay fed by a server match or by a relay.
+struct Spectator {
+	sf::IpAddress address;
+	unsigned short port;
+	bool relay;				// forwards the stream, new viewers may be redirected to it
+	sf::Uint32 lastSeen;	// tick of its last subscription
+};
+
+// The viewers one sender feeds. It never feeds more than SPECTATOR_FANOUT of them, so what a
+// match costs the server does not grow with its audience: the others are sent to a relay.
+struct SpectatorFanout {
+	std::vector<Spectator> spectators;
+	std::size_t nextRedirect;	// relay the next refused viewer is sent to
+	sf::Uint64 bytesSent;
+	sf::Uint32 redirects;
+	sf::Uint32 refused;			// full, and no relay to send them to
+};
+
+// A viewer of one match. It is sent only the inputs of both players and, now and then, a whole
+// keyframe of the match, and simulates the match itself. A relay is a viewer that also forwards
+// everything it receives to viewers of its own.
+struct SpectatorSession {
+	sf::UdpSocket socket;
+	sf::IpAddress upstreamAddress;
+	unsigned short upstreamPort;
+	sf::Uint32 matchId;
+	bool relay;
+	sf::Uint32 updates;			// calls to updateSpectator, the clock of subscriptions
+	bool synced;				// a keyframe arrived, the match is being simulated
+	Match match;
+	sf::Uint32 tick;			// next tick of the match to simulate
+	sf::Uint8 inputs[STREAM_HISTORY];	// by tick, both players' inputs
+	sf::Uint32 inputTicks[STREAM_HISTORY];
+	sf::Uint64 hashes[STREAM_HISTORY];	// by tick, the server's state after it
+	sf::Uint32 hashTicks[STREAM_HISTORY];
+	SpectatorFanout fanout;		// relay only
+	Match keyframe;
+	sf::Uint8 buffer[MAX_KEYFRAME_BYTES];
+	// Metrics
+	sf::Uint32 keyframes;
+	sf::Uint32 verified;		// keyframes that matched the simulated match
+	sf::Uint32 desyncs;			// keyframes that did not
+	sf::Uint32 resyncs;			// keyframes that had to skip lost inputs
+	sf::Uint32 checkedHashes;
+	sf::Uint32 badHashes;		// ticks simulated differently than on the server
+	sf::Uint32 redirected;
+	sf::Uint64 bytesReceived;
+};
+
+void addSpectator(SpectatorFanout& fanout, sf::UdpSocket& socket, sf::Uint32 matchId, const sf::IpAddress& address,
+	unsigned short port, bool relay, sf::Uint32 now);
+void sendToSpectators(SpectatorFanout& fanout, sf::UdpSocket& socket, const sf::Uint8* data, std::size_t size, sf::Uint32 now);
+std::size_t writeInputStream(sf::Uint8* buffer, std::size_t capacity, sf::Uint32 matchId, sf::Uint32 newestTick,
+	const sf::Uint8* inputs, sf::Uint64 hash);
+std::size_t writeKeyframe(sf::Uint8* buffer, std::size_t capacity, sf::Uint32 matchId, sf::Uint32 tick, const Match& match);
+bool startSpectator(SpectatorSession& session, unsigned short localPort, const sf::IpAddress& upstreamAddress,
+	unsigned short upstreamPort, sf::Uint32 matchId, bool relay);
+void updateSpectator(SpectatorSession& session);
+void getSpectatorView(const SpectatorSession& session, Match& view);
+void printSpectatorReport(const SpectatorSession& session, std::ostream& out);
+
+#endif
@@ -0,0 +1,47 @@
+#include "BulletKernel.h"
+#if BULLET_KERNEL_SSE2
+#include <emmintrin.h>
+#endif
+
+// A Position and a Velocity are two floats each with nothing in between, so a column of either is
+// one array of floats, x and y taking turns, and the n-th float of both is the same axis of the
+// same bullet.
+static_assert(sizeof(Position) == 2 * sizeof(float), "Position must be two packed floats");
+static_assert(sizeof(Velocity) == 2 * sizeof(float), "Velocity must be two packed floats");
+
+/*This function moves every bullet along its velocity. The two columns are added as flat float
+arrays, 16 floats (8 bullets) per loop with SSE2, the rest one float at a time. Columns are only
+8 byte aligned, so the loads are unaligned ones. The sums are the same as the scalar ones, bit for
+bit.*/
+void integrateBullets(Position positions[], const Velocity velocities[], int count)
+{
+	float* position = &positions[0].x;
+	const float* velocity = &velocities[0].x;
+	int floats = count * 2;
+	int i = 0;
+#if BULLET_KERNEL_SSE2
+	for (; i + 16 <= floats; i += 16)
+	{
+		__m128 a = _mm_add_ps(_mm_loadu_ps(position + i), _mm_loadu_ps(velocity + i));
+		__m128 b = _mm_add_ps(_mm_loadu_ps(position + i + 4), _mm_loadu_ps(velocity + i + 4));
+		__m128 c = _mm_add_ps(_mm_loadu_ps(position + i + 8), _mm_loadu_ps(velocity + i + 8));
+		__m128 d = _mm_add_ps(_mm_loadu_ps(position + i + 12), _mm_loadu_ps(velocity + i + 12));
+		_mm_storeu_ps(position + i, a);
+		_mm_storeu_ps(position + i + 4, b);
+		_mm_storeu_ps(position + i + 8, c);
+		_mm_storeu_ps(position + i + 12, d);
+	}
+#endif
+	for (; i < floats; ++i)
+		position[i] += velocity[i];
+}
+
+/*This function is integrateBullets one bullet at a time, to measure the kernel against.*/
+void integrateBulletsScalar(Position positions[], const Velocity velocities[], int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		positions[i].x += velocities[i].x;
+		positions[i].y += velocities[i].y;
+	}
+}
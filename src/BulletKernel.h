@@ -0,0 +1,16 @@
+#ifndef BULLET_KERNEL_H
+#define BULLET_KERNEL_H
+
+#include "Components.h"
+
+// Where the SSE2 kernel is built: every x64 target, and 32 bit ones compiled for SSE2.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BULLET_KERNEL_SSE2 1
+#else
+#define BULLET_KERNEL_SSE2 0
+#endif
+
+void integrateBullets(Position positions[], const Velocity velocities[], int count);
+void integrateBulletsScalar(Position positions[], const Velocity velocities[], int count);
+
+#endif
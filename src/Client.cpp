@@ -0,0 +1,276 @@
+#include "Client.h"
+#include <cmath>
+#include "Server.h"
+
+/*This function puts the local ship where the server has it, with a fresh cooldown.*/
+static void placeShip(Position& ship, Gun& gun, sf::Vector2f position)
+{
+	ship.x = position.x;
+	ship.y = position.y;
+	gun.cooldownRate = MIN_SHOT_COOLDOWN;
+	gun.cooldownTicks = MIN_SHOT_COOLDOWN_TICKS;
+	gun.ticksSinceShot = TICK_RATE;
+	gun.moved = false;
+	gun.startTrigger = false;
+}
+
+/*This function returns where a snapshot has a ship, in pixels.*/
+static sf::Vector2f getSnapshotPosition(const SnapshotShip& ship)
+{
+	return sf::Vector2f(static_cast<float>(ship.x) / POSITION_SCALE, static_cast<float>(ship.y) / POSITION_SCALE);
+}
+
+/*This function applies one input to the local ship with the same code the server runs, and
+records the result in the history entry of that tick.*/
+static void predictInput(const ClientSession& client, Position& ship, Gun& gun, PredictedTick& entry)
+{
+	moveShip(ship, gun, entry.input);
+	entry.fired = fireShip(gun, entry.input);
+	if (entry.fired)
+		entry.muzzle = getMuzzlePosition(ship, client.player == 2);
+	updateCooldownRate(gun);
+	entry.ship = ship;
+	entry.gun = gun;
+}
+
+/*This function returns where a ship is, in pixels.*/
+static sf::Vector2f getShipPosition(const Position& ship)
+{
+	return sf::Vector2f(ship.x, ship.y);
+}
+
+/*This function checks the newest snapshot against what was predicted for the input the server
+applied last. If they differ, the ship is moved to the server's position at that input and the
+inputs after it are played again. The jump is drawn smoothed over the next ticks.*/
+static void reconcile(ClientSession& client)
+{
+	sf::Vector2f authoritative = getSnapshotPosition(client.latest.ships[client.player - 1]);
+	if (!client.predicting) {
+		placeShip(client.ship, client.gun, authoritative);
+		client.predicting = true;
+		return;
+	}
+
+	sf::Uint32 applied = client.appliedTick;
+	PredictedTick& base = client.history[applied & (CLIENT_HISTORY - 1)];
+	bool known = (applied != 0 && base.tick == applied);
+	sf::Vector2f predicted = getShipPosition(known ? base.ship : client.ship);
+	sf::Vector2f error = authoritative - predicted;
+	float distance = std::sqrt(error.x * error.x + error.y * error.y);
+	if (distance < 1.f / POSITION_SCALE)	// only quantization apart
+		return;
+
+	sf::Vector2f before = getShipPosition(client.ship);
+	if (!known) {
+		client.ship.x = authoritative.x;
+		client.ship.y = authoritative.y;
+	}
+	else
+	{
+		Position ship = base.ship;
+		Gun gun = base.gun;
+		ship.x = authoritative.x;
+		ship.y = authoritative.y;
+		base.ship = ship;
+		for (sf::Uint32 tick = applied + 1; tick <= client.tick; ++tick)
+		{
+			PredictedTick& entry = client.history[tick & (CLIENT_HISTORY - 1)];
+			if (entry.tick != tick)
+				break;
+			predictInput(client, ship, gun, entry);
+		}
+		client.ship = ship;
+		client.gun = gun;
+	}
+	client.smoothing += before - getShipPosition(client.ship);
+
+	client.corrections++;
+	client.correctionTotal += distance;
+	if (distance > client.correctionMax)
+		client.correctionMax = distance;
+}
+
+/*This function reads the welcome and the snapshots the server sent.*/
+static void receiveServerPackets(ClientSession& client)
+{
+	sf::Uint8 buffer[STATE_HEADER_SIZE + MAX_SNAPSHOT_BYTES];
+	std::size_t received;
+	sf::IpAddress sender;
+	unsigned short senderPort;
+	while (shimReceive(client.shim, buffer, sizeof(buffer), received, sender, senderPort) == sf::Socket::Done)
+	{
+		if (sender != client.serverAddress || senderPort != client.serverPort)
+			continue;
+		BitReader reader;
+		startReading(reader, buffer, received);
+		sf::Uint32 type = readBits(reader, 8);
+		if (readBits(reader, 32) != client.id)
+			continue;
+
+		if (type == welcomeMessage && !client.joined)
+		{
+			client.match = readBits(reader, 32);
+			client.player = static_cast<sf::Uint8>(readBits(reader, 8));
+			client.joined = !reader.overflow && (client.player == 1 || client.player == 2);
+		}
+		else if (type == stateMessage && client.joined)
+		{
+			sf::Uint32 applied = readBits(reader, 32);
+			if (!decodeSnapshot(reader, client.decoded, client.received))
+				continue;
+			client.received[client.decoded.tick & (SNAPSHOT_HISTORY - 1)] = client.decoded;
+			if (client.snapshots > 0 && client.decoded.tick <= client.latest.tick)
+				continue;	// late or duplicate
+			client.latest = client.decoded;
+			client.ackedTick = client.decoded.tick;
+			client.appliedTick = applied;
+			client.snapshots++;
+			reconcile(client);
+		}
+	}
+}
+
+/*This function sends the newest inputs, repeating a few older ones in case a packet was lost.*/
+static void sendClientInputs(ClientSession& client)
+{
+	sf::Uint8 buffer[32];
+	sf::Uint32 count = client.tick < static_cast<sf::Uint32>(INPUT_REDUNDANCY) ? client.tick : INPUT_REDUNDANCY;
+	BitWriter writer;
+	startWriting(writer, buffer, sizeof(buffer));
+	writeBits(writer, inputMessage, 8);
+	writeBits(writer, client.match, 32);
+	writeBits(writer, client.player, 8);
+	writeBits(writer, client.tick, 32);
+	writeBits(writer, count, 8);
+	for (sf::Uint32 tick = client.tick - count + 1; tick <= client.tick; ++tick)
+		writeBits(writer, client.history[tick & (CLIENT_HISTORY - 1)].input, 8);
+	writeBits(writer, client.ackedTick, 32);
+	shimSend(client.shim, buffer, getWrittenBytes(writer), client.serverAddress, client.serverPort);
+}
+
+/*This function binds a local port and prepares a session that has not joined yet. conditions is
+NULL unless testing over a simulated network.*/
+bool startClient(ClientSession& client, const sf::IpAddress& serverAddress, unsigned short serverPort,
+	sf::Uint32 id, const NetworkConditions* conditions)
+{
+	if (client.socket.bind(sf::Socket::AnyPort) != sf::Socket::Done)
+		return false;
+	client.socket.setBlocking(false);
+	startShim(client.shim, client.socket, conditions);
+	client.serverAddress = serverAddress;
+	client.serverPort = serverPort;
+	client.id = id;
+	client.joined = false;
+	client.joinTicks = 0;
+	client.match = 0;
+	client.player = 0;
+	client.tick = 0;
+	client.appliedTick = 0;
+	client.predicting = false;
+	placeShip(client.ship, client.gun, sf::Vector2f(0, 0));
+	for (int i = 0; i < CLIENT_HISTORY; ++i)
+		client.history[i].tick = 0;
+	for (int i = 0; i < SNAPSHOT_HISTORY; ++i)
+		clearSnapshot(client.received[i]);
+	client.ackedTick = 0;
+	clearSnapshot(client.latest);
+	client.smoothing = sf::Vector2f(0, 0);
+	client.snapshots = 0;
+	client.corrections = 0;
+	client.correctionTotal = 0;
+	client.correctionMax = 0;
+	return true;
+}
+
+/*This function runs one client tick: it reads the server, predicts the local ship with this tick's
+input and sends the input.*/
+void advanceClient(ClientSession& client, sf::Uint8 input)
+{
+	receiveServerPackets(client);
+	client.smoothing *= CORRECTION_SMOOTHING;
+
+	if (!client.joined)
+	{
+		if (client.joinTicks++ % CLIENT_JOIN_RETRY_TICKS == 0)
+		{
+			sf::Uint8 buffer[5];
+			BitWriter writer;
+			startWriting(writer, buffer, sizeof(buffer));
+			writeBits(writer, joinMessage, 8);
+			writeBits(writer, client.id, 32);
+			shimSend(client.shim, buffer, sizeof(buffer), client.serverAddress, client.serverPort);
+		}
+		return;
+	}
+
+	client.tick++;
+	PredictedTick& entry = client.history[client.tick & (CLIENT_HISTORY - 1)];
+	entry.tick = client.tick;
+	entry.input = input;
+	entry.fired = false;
+
+	// A finished match stands still on the server until the rematch
+	bool over = client.latest.ships[0].health == 0 || client.latest.ships[1].health == 0;
+	if (client.predicting && !over)
+		predictInput(client, client.ship, client.gun, entry);
+	else {
+		entry.ship = client.ship;
+		entry.gun = client.gun;
+	}
+	sendClientInputs(client);
+}
+
+/*This function fills a match for drawing: the local ship where it was predicted, the other ship
+and the bullets from the newest snapshot. The local player's bullets are moved ahead to the
+predicted tick and those it fired since the last applied input are added.*/
+void getClientView(const ClientSession& client, Match& view)
+{
+	if (client.snapshots == 0)
+		return;
+
+	World& world = view.world;
+	Position* ships = getColumn<Position>(world, SHIP_ARCHETYPE);
+	Health* health = getColumn<Health>(world, SHIP_ARCHETYPE);
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		sf::Vector2f position = getSnapshotPosition(client.latest.ships[i]);
+		if (client.predicting && i == client.player - 1)
+			position = getShipPosition(client.ship) + client.smoothing;
+		ships[i].x = position.x;
+		ships[i].y = position.y;
+		health[i].points = client.latest.ships[i].health;
+	}
+
+	bool ownUp = (client.player == 2);
+	float ownStep = ownUp ? -BULLET_VELOCITY : BULLET_VELOCITY;
+	clearArchetype(world, BULLET_ARCHETYPE);
+	for (int i = 0; i < client.latest.bulletCount; ++i)
+	{
+		const SnapshotBullet& bullet = client.latest.bullets[i];
+		sf::Vector2f position(static_cast<float>(bullet.x) / POSITION_SCALE, static_cast<float>(bullet.y) / POSITION_SCALE);
+		if (bullet.facingUp == ownUp)
+			position.y += ownStep * (client.tick - client.appliedTick);
+		addBullet(world, position, bullet.facingUp ? OWNER_PLAYER2 : OWNER_PLAYER1);
+	}
+	for (sf::Uint32 tick = client.appliedTick + 1; tick <= client.tick; ++tick)
+	{
+		const PredictedTick& entry = client.history[tick & (CLIENT_HISTORY - 1)];
+		if (entry.tick != tick || !entry.fired)
+			continue;
+		sf::Vector2f position = entry.muzzle + sf::Vector2f(0, ownStep * (client.tick - tick + 1));
+		addBullet(world, position, ownUp ? OWNER_PLAYER2 : OWNER_PLAYER1);
+	}
+}
+
+/*This function prints how often the server disagreed with the prediction, and by how much.*/
+void printClientReport(const ClientSession& client, std::ostream& out)
+{
+	out << "PREDICTION (player " << static_cast<int>(client.player) << ")" << std::endl;
+	out << "  " << client.snapshots << " snapshots, " << client.corrections << " corrections";
+	if (client.snapshots > 0)
+		out << " (" << 100.0 * client.corrections / client.snapshots << "% of snapshots)";
+	out << std::endl;
+	if (client.corrections > 0)
+		out << "  correction: mean " << client.correctionTotal / client.corrections << "px, max "
+			<< client.correctionMax << "px" << std::endl;
+}
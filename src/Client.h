@@ -0,0 +1,63 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <SFML/Network.hpp>
+#include <ostream>
+#include "NetworkShim.h"
+#include "Simulation.h"
+#include "Snapshot.h"
+
+const int CLIENT_HISTORY = 64;				// predicted ticks kept for replay, must be a power of two
+const int CLIENT_JOIN_RETRY_TICKS = 15;		// ticks between join requests until the server answers
+const int INPUT_REDUNDANCY = 4;				// each input packet repeats this many of the newest inputs
+const float CORRECTION_SMOOTHING = 0.8f;	// share of a correction still drawn one tick later
+
+// The local ship after the input of one client tick.
+struct PredictedTick {
+	sf::Uint32 tick;
+	sf::Uint8 input;
+	Position ship;
+	Gun gun;
+	bool fired;
+	sf::Vector2f muzzle;	// where the bullet fired on this tick spawned
+};
+
+// A player of a match hosted by the server. The server is the authority, but the local ship and
+// its bullets are predicted from the local input so they react on the next frame. Every snapshot
+// says which input the server applied last: the ship is put where the server had it then, and the
+// inputs the server has not applied yet are replayed on top.
+struct ClientSession {
+	sf::UdpSocket socket;
+	NetworkShim shim;
+	sf::IpAddress serverAddress;
+	unsigned short serverPort;
+	sf::Uint32 id;
+	bool joined;
+	sf::Uint32 joinTicks;			// ticks spent asking to join
+	sf::Uint32 match;
+	sf::Uint8 player;				// 1 or 2, once joined
+	sf::Uint32 tick;				// client tick of the newest input
+	sf::Uint32 appliedTick;			// newest input the server has applied
+	bool predicting;				// a snapshot placed the ship, prediction can start
+	Position ship;					// the local ship, predicted up to tick
+	Gun gun;
+	PredictedTick history[CLIENT_HISTORY];
+	Snapshot received[SNAPSHOT_HISTORY];	// by tick, baselines of the next snapshots
+	sf::Uint32 ackedTick;			// newest snapshot received, 0 for none
+	Snapshot latest;				// the other ship and the bullets are drawn from it
+	Snapshot decoded;
+	sf::Vector2f smoothing;			// the ship is drawn this far from its prediction, shrinks every tick
+	// Metrics
+	sf::Uint32 snapshots;
+	sf::Uint32 corrections;
+	float correctionTotal;			// pixels
+	float correctionMax;
+};
+
+bool startClient(ClientSession& client, const sf::IpAddress& serverAddress, unsigned short serverPort,
+	sf::Uint32 id, const NetworkConditions* conditions);
+void advanceClient(ClientSession& client, sf::Uint8 input);
+void getClientView(const ClientSession& client, Match& view);
+void printClientReport(const ClientSession& client, std::ostream& out);
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <SFML/Graphics.hpp>
+#include "Fixed.h"
+#include "World.h"
+
+// Component ids, the bit of each in a ComponentMask.
+enum componentId {
+	positionComponent,
+	fixedPositionComponent,
+	gunComponent,
+	healthComponent,
+	healthBarComponent,
+	projectileComponent,
+	appearanceComponent,
+	velocityComponent,
+	emitterComponent,
+	COMPONENT_TYPES
+};
+
+// Top left corner, in pixels. Simulated in float matches, follows FixedPosition in fixed point ones.
+struct Position {
+	enum { COMPONENT = positionComponent };
+	float x;
+	float y;
+};
+
+// Top left corner in Q16.16, simulated in fixed point matches only.
+struct FixedPosition {
+	enum { COMPONENT = fixedPositionComponent };
+	Fixed x;
+	Fixed y;
+};
+
+// A ship's steering and shooting state. The cooldown is cooldownRate in float matches and
+// cooldownTicks in fixed point ones.
+struct Gun {
+	enum { COMPONENT = gunComponent };
+	int ticksSinceShot;	// counted in ticks, not wall time, so every peer agrees on it
+	float cooldownRate;	// time between bullets spawned.
+	Fixed cooldownTicks;
+	bool moved;
+	bool startTrigger;	// Decay triggered when bullets are spawned.
+};
+
+struct Health {
+	enum { COMPONENT = healthComponent };
+	int points;
+	bool hit;
+};
+
+// Where the health of an entity is drawn, one HEALTH_BAR_WIDTH per point.
+struct HealthBar {
+	enum { COMPONENT = healthBarComponent };
+	sf::Vector2f position;
+	sf::Color color;
+};
+
+struct Projectile {
+	enum { COMPONENT = projectileComponent };
+	sf::Uint8 owner;	// row of the ship that fired it
+	bool collided;
+};
+
+// Pixels per tick, for things that do not just fly up or down (free for all bullets).
+struct Velocity {
+	enum { COMPONENT = velocityComponent };
+	float x;
+	float y;
+};
+
+// Looks, an index into the sprite types of the renderer, and into SPRITE_MASKS: hit tests read it
+// to pick the solid pixels of each sprite.
+enum appearanceType {
+	shipAppearance,
+	bulletDownAppearance,
+	bulletUpAppearance,
+	APPEARANCE_TYPES
+};
+
+struct Appearance {
+	enum { COMPONENT = appearanceComponent };
+	sf::Uint8 type;
+};
+
+// How an emitter spreads a volley.
+enum emitterPattern {
+	radialPattern,		// evenly around a full turn
+	spiralPattern,		// spread apart, the whole volley turning by spin after each one
+	aimedPattern,		// spread apart, centered on the nearest ship
+	scriptedPattern		// spread apart like a spiral, each bullet then running script (see Pattern.h)
+};
+
+// Fires a volley of bullets every interval ticks, from its Position. Angles are in radians, 0 is
+// right and PI / 2 is down.
+struct Emitter {
+	enum { COMPONENT = emitterComponent };
+	sf::Uint8 pattern;
+	sf::Uint8 bullets;	// per volley
+	sf::Uint16 interval;
+	sf::Uint16 ticksLeft;	// until the next volley
+	float angle;		// of the first bullet of the next volley
+	float spin;
+	float spread;		// between two bullets of a volley, radial ones ignore it
+	float speed;		// pixels per tick
+	sf::Uint8 script;	// of a scripted pattern, in the patterns of the game
+};
+
+const std::size_t COMPONENT_SIZES[COMPONENT_TYPES] = {
+	sizeof(Position),
+	sizeof(FixedPosition),
+	sizeof(Gun),
+	sizeof(Health),
+	sizeof(HealthBar),
+	sizeof(Projectile),
+	sizeof(Appearance),
+	sizeof(Velocity),
+	sizeof(Emitter)
+};
+
+#endif
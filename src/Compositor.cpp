@@ -0,0 +1,238 @@
+#include "Compositor.h"
+#include <iostream>
+
+/*This function returns the batch of a layer that draws with the given texture, creating it
+the first time the texture is seen. Batches keep their vertex storage between frames.*/
+static LayerBatch& getBatch(Layer& layer, const sf::Texture* texture)
+{
+	for (std::vector<LayerBatch>::iterator it = layer.batches.begin(); it != layer.batches.end(); ++it)
+	{
+		if (it->texture == texture)
+			return *it;
+	}
+	LayerBatch batch;
+	batch.texture = texture;
+	batch.vertices.setPrimitiveType(sf::Triangles);
+	layer.batches.push_back(batch);
+	return layer.batches.back();
+}
+
+static void appendQuad(sf::VertexArray& vertices, const sf::Vector2f corners[4], const sf::FloatRect& texRect, sf::Color color)
+{
+	float u1 = texRect.left;
+	float v1 = texRect.top;
+	float u2 = texRect.left + texRect.width;
+	float v2 = texRect.top + texRect.height;
+
+	// corners are top-left, top-right, bottom-left, bottom-right
+	vertices.append(sf::Vertex(corners[0], color, sf::Vector2f(u1, v1)));
+	vertices.append(sf::Vertex(corners[1], color, sf::Vector2f(u2, v1)));
+	vertices.append(sf::Vertex(corners[2], color, sf::Vector2f(u1, v2)));
+	vertices.append(sf::Vertex(corners[2], color, sf::Vector2f(u1, v2)));
+	vertices.append(sf::Vertex(corners[1], color, sf::Vector2f(u2, v1)));
+	vertices.append(sf::Vertex(corners[3], color, sf::Vector2f(u2, v2)));
+}
+
+static int countDrawCalls(const Layer& layer)
+{
+	int calls = 0;
+	for (std::vector<LayerBatch>::const_iterator it = layer.batches.begin(); it != layer.batches.end(); ++it)
+		calls += (it->vertices.getVertexCount() > 0) ? 1 : 0;
+	return calls;
+}
+
+static void drawBatches(sf::RenderTarget& target, Layer& layer)
+{
+	for (std::vector<LayerBatch>::iterator it = layer.batches.begin(); it != layer.batches.end(); ++it)
+	{
+		if (it->vertices.getVertexCount() == 0)
+			continue;
+		target.draw(it->vertices, sf::RenderStates(it->texture));
+		layer.cost.drawCalls++;
+	}
+}
+
+/*This function sets up an empty compositor for a target of the given size.*/
+void initializeCompositor(Compositor& compositor, unsigned int width, unsigned int height)
+{
+	compositor.layerCount = 0;
+	compositor.width = width;
+	compositor.height = height;
+	compositor.reportClock.restart();
+}
+
+/*This function adds a layer on top of the existing ones and returns its index.*/
+int addLayer(Compositor& compositor, const char* name, bool isStatic)
+{
+	int index = compositor.layerCount++;
+	Layer& layer = compositor.layers[index];
+	layer.name = name;
+	layer.isStatic = isStatic;
+	layer.dirty = true;
+	layer.batches.clear();
+	layer.framePixels = 0;
+	layer.cost = LayerCost();
+	return index;
+}
+
+/*This function empties the dynamic layers so they can be rebuilt for the next frame.
+Static layers keep their content until invalidated.*/
+void beginFrame(Compositor& compositor)
+{
+	for (int i = 0; i < compositor.layerCount; ++i)
+	{
+		Layer& layer = compositor.layers[i];
+		if (layer.isStatic)
+			continue;
+		for (std::vector<LayerBatch>::iterator it = layer.batches.begin(); it != layer.batches.end(); ++it)
+			it->vertices.clear();
+		layer.framePixels = 0;
+	}
+}
+
+/*This function drops the content of a static layer so it can be refilled.*/
+void invalidateLayer(Compositor& compositor, int layer)
+{
+	Layer& l = compositor.layers[layer];
+	for (std::vector<LayerBatch>::iterator it = l.batches.begin(); it != l.batches.end(); ++it)
+		it->vertices.clear();
+	l.framePixels = 0;
+	l.dirty = true;
+}
+
+/*This function adds a sprite to a layer, batched with every other sprite using the same texture.*/
+void addSprite(Compositor& compositor, int layer, const sf::Sprite& sprite)
+{
+	Layer& l = compositor.layers[layer];
+	sf::FloatRect local = sprite.getLocalBounds();
+	const sf::Transform& transform = sprite.getTransform();
+	sf::Vector2f corners[4] = {
+		transform.transformPoint(0, 0),
+		transform.transformPoint(local.width, 0),
+		transform.transformPoint(0, local.height),
+		transform.transformPoint(local.width, local.height)
+	};
+	sf::IntRect rect = sprite.getTextureRect();
+	appendQuad(getBatch(l, sprite.getTexture()).vertices, corners, sf::FloatRect(rect), sprite.getColor());
+
+	sf::FloatRect bounds = sprite.getGlobalBounds();
+	l.framePixels += bounds.width * bounds.height;
+}
+
+/*This function adds a solid rectangle to a layer.*/
+void addRectangle(Compositor& compositor, int layer, const sf::FloatRect& rect, sf::Color color)
+{
+	Layer& l = compositor.layers[layer];
+	sf::Vector2f corners[4] = {
+		sf::Vector2f(rect.left, rect.top),
+		sf::Vector2f(rect.left + rect.width, rect.top),
+		sf::Vector2f(rect.left, rect.top + rect.height),
+		sf::Vector2f(rect.left + rect.width, rect.top + rect.height)
+	};
+	appendQuad(getBatch(l, NULL).vertices, corners, sf::FloatRect(), color);
+	l.framePixels += rect.width * rect.height;
+}
+
+/*This function adds an unrotated textured rectangle to a layer, for things drawn without a sprite.*/
+void addTexturedRectangle(Compositor& compositor, int layer, const sf::Texture* texture, const sf::IntRect& textureRect, const sf::FloatRect& rect)
+{
+	Layer& l = compositor.layers[layer];
+	sf::Vector2f corners[4] = {
+		sf::Vector2f(rect.left, rect.top),
+		sf::Vector2f(rect.left + rect.width, rect.top),
+		sf::Vector2f(rect.left, rect.top + rect.height),
+		sf::Vector2f(rect.left + rect.width, rect.top + rect.height)
+	};
+	appendQuad(getBatch(l, texture).vertices, corners, sf::FloatRect(textureRect), sf::Color::White);
+	l.framePixels += rect.width * rect.height;
+}
+
+/*This function adds the sorted commands of a buffer to their layers (see sortRenderCommands).
+The batch of a layer and texture is looked up once per run of keys, not once per quad.*/
+void addRenderCommands(Compositor& compositor, const RenderCommandBuffer& commands)
+{
+	sf::VertexArray* vertices = NULL;
+	Layer* layer = NULL;
+	sf::Uint64 state = 0;
+	for (std::size_t i = 0; i < commands.sorted.size(); ++i)
+	{
+		sf::Uint64 key = commands.sorted[i];
+		if (!vertices || (key & RENDER_KEY_STATE_MASK) != state)
+		{
+			state = key & RENDER_KEY_STATE_MASK;
+			layer = &compositor.layers[getRenderLayer(key)];
+			vertices = &getBatch(*layer, getRenderTexture(commands, key)).vertices;
+		}
+		const RenderCommand &command = getRenderCommand(commands, key);
+		sf::Vector2f corners[4] = {
+			sf::Vector2f(command.x, command.y),
+			sf::Vector2f(command.x + command.width, command.y),
+			sf::Vector2f(command.x, command.y + command.height),
+			sf::Vector2f(command.x + command.width, command.y + command.height)
+		};
+		appendQuad(*vertices, corners, sf::FloatRect(command.u, command.v, command.uWidth, command.vHeight), command.color);
+		layer->framePixels += command.width * command.height;
+	}
+}
+
+/*This function draws all layers bottom to top. A static layer of several draw calls is rendered
+into its cache the first time (or after invalidateLayer) and then drawn as a single full screen
+quad. That saves draw calls, not fill: the cache covers the whole screen however little the layer
+did. A static layer of one draw call is drawn as it is, its cache would save nothing.*/
+void composite(sf::RenderTarget& target, Compositor& compositor)
+{
+	sf::Clock submitClock;
+	for (int i = 0; i < compositor.layerCount; ++i)
+	{
+		Layer& layer = compositor.layers[i];
+		submitClock.restart();
+
+		if (layer.isStatic && countDrawCalls(layer) > 1)
+		{
+			if (layer.cache.getSize() != sf::Vector2u(compositor.width, compositor.height)) {
+				layer.cache.create(compositor.width, compositor.height);
+				layer.dirty = true;
+			}
+			if (layer.dirty)
+			{
+				layer.cache.clear(sf::Color::Transparent);
+				drawBatches(layer.cache, layer);
+				layer.cache.display();
+				layer.dirty = false;
+			}
+			target.draw(sf::Sprite(layer.cache.getTexture()));
+			layer.cost.drawCalls++;
+			layer.cost.pixelsFilled += static_cast<double>(compositor.width) * compositor.height;
+		}
+		else
+		{
+			drawBatches(target, layer);
+			layer.cost.pixelsFilled += layer.framePixels;
+		}
+
+		layer.cost.submitMicroseconds += submitClock.getElapsedTime().asMicroseconds();
+		layer.cost.frames++;
+	}
+}
+
+/*This function prints the average per-frame cost of each layer every intervalSeconds.*/
+void reportLayerCosts(Compositor& compositor, float intervalSeconds)
+{
+	if (compositor.reportClock.getElapsedTime().asSeconds() < intervalSeconds)
+		return;
+	compositor.reportClock.restart();
+
+	std::cout << "layer        draws/frame   pixels/frame   submit us/frame" << std::endl;
+	for (int i = 0; i < compositor.layerCount; ++i)
+	{
+		Layer& layer = compositor.layers[i];
+		if (layer.cost.frames == 0)
+			continue;
+		double frames = layer.cost.frames;
+		std::cout << layer.name << "\t\t"
+			<< layer.cost.drawCalls / frames << "\t\t"
+			<< static_cast<sf::Int64>(layer.cost.pixelsFilled / frames) << "\t\t"
+			<< layer.cost.submitMicroseconds / frames << std::endl;
+		layer.cost = LayerCost();
+	}
+}
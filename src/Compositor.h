@@ -0,0 +1,53 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "RenderCommands.h"
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+const int MAX_LAYERS = 8;
+
+// Vertices of one layer that share a texture (NULL for untextured shapes).
+struct LayerBatch {
+	const sf::Texture* texture;
+	sf::VertexArray vertices;
+};
+
+// What a layer cost to put on screen, accumulated between reports.
+struct LayerCost {
+	sf::Int64 submitMicroseconds;	// CPU time spent issuing the layer's draw calls
+	unsigned int drawCalls;
+	double pixelsFilled;			// area covered by the layer's quads, i.e. its fill rate
+	unsigned int frames;
+};
+
+struct Layer {
+	const char* name;
+	bool isStatic;		// static layers keep their content between frames, see composite
+	bool dirty;			// static layer content changed and cache must be rebuilt
+	sf::RenderTexture cache;	// created the first time a static layer takes more than one draw call
+	std::vector<LayerBatch> batches;
+	double framePixels;
+	LayerCost cost;
+};
+
+struct Compositor {
+	Layer layers[MAX_LAYERS];
+	int layerCount;
+	unsigned int width;
+	unsigned int height;
+	sf::Clock reportClock;
+};
+
+void initializeCompositor(Compositor& compositor, unsigned int width, unsigned int height);
+int addLayer(Compositor& compositor, const char* name, bool isStatic);
+void beginFrame(Compositor& compositor);
+void invalidateLayer(Compositor& compositor, int layer);
+void addSprite(Compositor& compositor, int layer, const sf::Sprite& sprite);
+void addRectangle(Compositor& compositor, int layer, const sf::FloatRect& rect, sf::Color color);
+void addTexturedRectangle(Compositor& compositor, int layer, const sf::Texture* texture, const sf::IntRect& textureRect, const sf::FloatRect& rect);
+void addRenderCommands(Compositor& compositor, const RenderCommandBuffer& commands);
+void composite(sf::RenderTarget& target, Compositor& compositor);
+void reportLayerCosts(Compositor& compositor, float intervalSeconds);
+
+#endif
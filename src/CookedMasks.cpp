@@ -0,0 +1,92 @@
+// Written by ToastyDuels --cook-masks from the sprite textures, do not edit.
+#include "PixelMask.h"
+
+const PixelMask SPRITE_MASKS[] = {
+	{ 111, 124, 2, {	// shipAppearance
+		0x00f0000000000000ULL, 0x01f8000000000000ULL, 0x01fc000000000000ULL, 0x0fff000000000000ULL,
+		0x3fffe00000000000ULL, 0x7ffff00000000000ULL, 0xfffff80000000000ULL, 0xfffffc0000000020ULL,
+		0xfffffe0000000000ULL, 0xfffffe0000000000ULL, 0xfffffe0000000000ULL, 0xffffff0000000000ULL,
+		0xffffff0000000000ULL, 0xffffff0000000000ULL, 0xffffff0000000000ULL, 0xffffff0000000000ULL,
+		0xffffff0000000000ULL, 0xffffff0000000000ULL, 0xffffff0000000000ULL, 0xffffff0000000000ULL,
+		0xffffff0000000000ULL, 0xffffff0000000000ULL, 0xffffff0000000000ULL, 0xffffff0000000000ULL,
+		0xffffff0000000000ULL, 0xffffff007fc00000ULL, 0xffffff07fff80000ULL, 0xfffffffffffc0000ULL,
+		0xfffffffffffe0000ULL, 0xffffffffffff0000ULL, 0xffffffffffff0000ULL, 0xffffffffffff8000ULL,
+		0xffffffffffff8000ULL, 0xffffffffffff8000ULL, 0xffffffffffffc000ULL, 0xffffffffffffc000ULL,
+		0xffffffffffffc000ULL, 0xffffffffffffc000ULL, 0xffffffffffff8000ULL, 0xffffffffffff8000ULL,
+		0xffffffffffff8100ULL, 0xffffffffffff0000ULL, 0xffffffffffff0000ULL, 0xfffffffffffe0000ULL,
+		0xfffffffffffc0000ULL, 0xfffffffffff80000ULL, 0xfffffffffff00000ULL, 0xffffffffffe00000ULL,
+		0xffffffffff800018ULL, 0xfffffffffe000038ULL, 0xfffffffff8000038ULL, 0xffffffffc000003eULL,
+		0xfffffffe0000007eULL, 0xfffffff8000000ffULL, 0xfffffff0000001ffULL, 0xffffffc0000007feULL,
+		0xffffffc000000ffeULL, 0xffffffc000001ffcULL, 0xffffff8000007fe0ULL, 0xffffff800003ffc0ULL,
+		0xffffff00000fff00ULL, 0xffffff00001ffe00ULL, 0xffffff00003fff00ULL, 0xffffff000e7ffe00ULL,
+		0xffffff003ffff800ULL, 0xffffff603ffff800ULL, 0xffffffe007fff800ULL, 0xffffff8003fff000ULL,
+		0xffffff8007fff000ULL, 0xffffffc007ffe000ULL, 0xffffffc007ff8000ULL, 0xffffffc007ff8000ULL,
+		0xffffff000fff8000ULL, 0xfffffc003fff0000ULL, 0xfffffe007ffc0000ULL, 0xfffffd007ffc0800ULL,
+		0xfffffa00fff81000ULL, 0xfffff180fffc0000ULL, 0xfffff4807ffc0000ULL, 0xffffec007ff80000ULL,
+		0xffffce407ff80000ULL, 0xffffce00fff80040ULL, 0xffff866ffff80000ULL, 0xfffe265ffff00004ULL,
+		0xfff80edffff00002ULL, 0xfff00fbffff00000ULL, 0xfff00fbfffe00000ULL, 0x1ff10f3fff800000ULL,
+		0x0ff14f7ffc000000ULL, 0x0ff14ffff0000000ULL, 0x0fe00ffff0000000ULL, 0x0fe29f9ff0000000ULL,
+		0x07c09f9fe0000000ULL, 0x07801f0fc0000000ULL, 0x07813e0600000000ULL, 0x77013e0000000000ULL,
+		0xffe1ff0000000000ULL, 0xffffff0000000000ULL, 0xffffff3800000000ULL, 0xffffffff00000000ULL,
+		0xffffffff80000000ULL, 0xffffffff80000000ULL, 0xefffffff00000000ULL, 0x0007fffc00000000ULL,
+		0x0000fffc00000000ULL, 0x00003ffc00000000ULL, 0x00003ff800000000ULL, 0x00001ff000000000ULL,
+		0x00001fe000000000ULL, 0x00000fe000000000ULL, 0x00001fe000000000ULL, 0x00001fe000000000ULL,
+		0x00001fc000000000ULL, 0x00001fc000000000ULL, 0x00001f8000000000ULL, 0x00001f8000000000ULL,
+		0x00003f81c0000000ULL, 0x00003fc7e0000000ULL, 0x00007ffff0000000ULL, 0x00007ffff0000000ULL,
+		0x0000ffffe0000000ULL, 0x00003bff80000000ULL, 0x000001fc00000000ULL, 0x0000000000000000ULL,
+		0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+		0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000020000ULL,
+		0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+		0x0000000000000000ULL, 0x0000000000000001ULL, 0x0000000000000001ULL, 0x0000000000000001ULL,
+		0x0000000000000001ULL, 0x0000000000000001ULL, 0x0000000000000001ULL, 0x0000000000000001ULL,
+		0x0000000000000001ULL, 0x0000000000000001ULL, 0x0000000000000001ULL, 0x0000000000000001ULL,
+		0x0000000000000001ULL, 0x0000000000000001ULL, 0x00000000003fe001ULL, 0x0000000000fffc01ULL,
+		0x0000000003ffff01ULL, 0x0000000007ffffc1ULL, 0x000000000fffffffULL, 0x000000001fffffffULL,
+		0x000000001fffffffULL, 0x000000003fffffffULL, 0x000000003fffffffULL, 0x000000007fffffffULL,
+		0x000000007fffffffULL, 0x000000007fffffffULL, 0x00000000ffffffffULL, 0x00000000ffffffffULL,
+		0x00000000ffffffffULL, 0x00000000ffffffffULL, 0x000000007fffffffULL, 0x000000007fffffffULL,
+		0x000000007fffffffULL, 0x000000007fffffffULL, 0x000000003fffffffULL, 0x000000001fffffffULL,
+		0x000000001fffffffULL, 0x000000000fffffffULL, 0x0000000003ffffffULL, 0x0000000001ffffffULL,
+		0x00000000007fffffULL, 0x00000000000fffffULL, 0x000008000000ffffULL, 0x00001c00000001ffULL,
+		0x00001e00000000ffULL, 0x00003e00000000ffULL, 0x00003f000000007fULL, 0x00007f800000007fULL,
+		0x00007fc00000007fULL, 0x00003ff00000007fULL, 0x00003ff80000007fULL, 0x00001ffe000000ffULL,
+		0x000003ffe00001ffULL, 0x000001fff00001ffULL, 0x0000007ff80003ffULL, 0x0000003ffc0003ffULL,
+		0x0000003ffe7c03ffULL, 0x0000003ffffc01ffULL, 0x0000000fffe000ffULL, 0x0000000fffe000ffULL,
+		0x00000007ffe0007fULL, 0x00000007fff0003fULL, 0x00000003fff0003fULL, 0x00000001fff0003fULL,
+		0x000000007ff8003fULL, 0x000000007ffe003fULL, 0x000000007fff005fULL, 0x000000003fff009fULL,
+		0x000000000fff801fULL, 0x0000000007ff800fULL, 0x000000000fff0027ULL, 0x000000000fff0167ULL,
+		0x000000000fff0167ULL, 0x0000000007ff80efULL, 0x0000000007ffbfefULL, 0x0000000007ffffcfULL,
+		0x0000000003ffffcfULL, 0x0000000003ffffcfULL, 0x0000000003ffffcfULL, 0x0000000000ffffceULL,
+		0x00000000001fffc0ULL, 0x000000000003ffc0ULL, 0x000000000003ffc4ULL, 0x000000000003fe46ULL,
+		0x000000000001fc47ULL, 0x000000000000fc43ULL, 0x0000000000003821ULL, 0x000000000000002fULL,
+		0x000000000000079fULL, 0x0000000000000fdfULL, 0x0000000000000fffULL, 0x0000000000000fffULL,
+		0x0000000000000fffULL, 0x00000000000003ffULL, 0x00000000000003ffULL, 0x00000000000003ffULL,
+		0x00000000000003feULL, 0x00000000000001fcULL, 0x00000000000007f8ULL, 0x00000000000007f0ULL,
+		0x00000000000007f0ULL, 0x00000000000007e0ULL, 0x00000000000007e0ULL, 0x00000000000003f0ULL,
+		0x00000000000181f0ULL, 0x000000000003d9f0ULL, 0x00000000002ffff8ULL, 0x00000000001ffff8ULL,
+		0x00000000000ffffcULL, 0x000000000007fffcULL, 0x000000000001ffdeULL, 0x000000000000ffbeULL,
+		0x0000000000003e1cULL,
+	} },
+	{ 32, 34, 1, {	// bulletDownAppearance
+		0x000000000000003eULL, 0x000000001ffffffeULL, 0x000000003fffffffULL, 0x000000003fffffffULL,
+		0x000000003fffffffULL, 0x000000003fffffffULL, 0x000000007fffffffULL, 0x000000007fffffffULL,
+		0x000000007fffffffULL, 0x000000007fffffffULL, 0x000000007fffffffULL, 0x000000007fffffffULL,
+		0x000000007fffffffULL, 0x000000007fffffffULL, 0x000000007ffffffeULL, 0x000000007fffffffULL,
+		0x000000003fffffffULL, 0x000000007fffffffULL, 0x000000007fffffffULL, 0x000000007fffffffULL,
+		0x000000007fffffffULL, 0x000000007fffffffULL, 0x000000007ffffffeULL, 0x000000003ffffffeULL,
+		0x000000003ffffffeULL, 0x000000003ffffffeULL, 0x000000003ffffffeULL, 0x000000003ffffffeULL,
+		0x000000001ffffffeULL, 0x000000000ffffffcULL, 0x0000000007fffff8ULL, 0x0000000003fffff0ULL,
+		0x00000000007fff00ULL,
+	} },
+	{ 32, 34, 1, {	// bulletUpAppearance
+		0x00000000001f8000ULL, 0x0000000000fffe00ULL, 0x0000000003ffffc0ULL, 0x0000000007fffff0ULL,
+		0x000000000ffffff8ULL, 0x000000001ffffffcULL, 0x000000001ffffffeULL, 0x000000003ffffffeULL,
+		0x000000003ffffffeULL, 0x000000003ffffffeULL, 0x000000003ffffffeULL, 0x000000001ffffffcULL,
+		0x000000000ffffffeULL, 0x000000001ffffffeULL, 0x000000001ffffffeULL, 0x000000003ffffffeULL,
+		0x000000003ffffffeULL, 0x000000003ffffffeULL, 0x000000003ffffffeULL, 0x000000003ffffffeULL,
+		0x000000003ffffffeULL, 0x000000003fffffffULL, 0x000000003ffffffeULL, 0x000000003fffffffULL,
+		0x000000003ffffffeULL, 0x000000003fffffffULL, 0x000000003ffffffeULL, 0x000000007ffffffeULL,
+		0x000000007ffffffeULL, 0x000000007ffffffeULL, 0x000000007ffffffeULL, 0x000000003ffffffcULL,
+		0x000000003ffffffcULL, 0x0000000000000080ULL,
+	} },
+};
@@ -0,0 +1,30 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <SFML/Config.hpp>
+
+// Q16.16 fixed point: 16 bits of whole pixels (or ticks), 16 bits of fraction. Only integer adds,
+// compares and shifts touch it, so every compiler and CPU gets the same bits.
+typedef sf::Int32 Fixed;
+
+const int FIXED_SHIFT = 16;
+const Fixed FIXED_ONE = 1 << FIXED_SHIFT;
+
+inline Fixed toFixed(int value)
+{
+	return value * FIXED_ONE;
+}
+
+/*This function returns the whole part, rounded down.*/
+inline int fixedFloor(Fixed value)
+{
+	return value >> FIXED_SHIFT;
+}
+
+/*This function converts for drawing only, nothing simulated may depend on the result.*/
+inline float fixedToFloat(Fixed value)
+{
+	return static_cast<float>(value) / FIXED_ONE;
+}
+
+#endif
@@ -0,0 +1,208 @@
+#include "Simulation.h"
+#include "PixelMask.h"
+
+// The tick of a fixed point match. Same rules as movePlayers, checkCollisions and removeBullets,
+// but positions, sizes and cooldowns are Q16.16 integers and the float positions only mirror them.
+
+const Fixed SHIP_VELOCITY_FIXED = static_cast<int>(SHIP_VELOCITY) * FIXED_ONE;
+const Fixed BULLET_VELOCITY_FIXED = static_cast<int>(BULLET_VELOCITY) * FIXED_ONE;
+const int SHOT_DECAY_MULTIPLIER_FIXED = static_cast<int>(SHOT_DECAY_MULTIPLIER);
+
+/*This function checks if a box stays within the screen after moving by an offset, like isInBounds.*/
+static bool isInBoundsFixed(Fixed left, Fixed top, Fixed width, Fixed height, Fixed offsetX, Fixed offsetY)
+{
+	if (top + offsetY < 0)
+		return false;
+	if (left + offsetX < 0)
+		return false;
+	if (left + width + offsetX > toFixed(VIDEO_WIDTH))
+		return false;
+	if (top + height + offsetY > toFixed(VIDEO_HEIGHT))
+		return false;
+	return true;
+}
+
+/*This function checks if two boxes touch or intersect, like overlap.*/
+static bool overlapFixed(Fixed x1, Fixed y1, Fixed width1, Fixed height1, Fixed x2, Fixed y2, Fixed width2, Fixed height2)
+{
+	Fixed left = (x1 > x2) ? x1 : x2;
+	Fixed top = (y1 > y2) ? y1 : y2;
+	Fixed right = (x1 + width1 < x2 + width2) ? x1 + width1 : x2 + width2;
+	Fixed bottom = (y1 + height1 < y2 + height2) ? y1 + height1 : y2 + height2;
+	return left <= right && top <= bottom;
+}
+
+/*This function checks if the solid pixels of two sprites touch, like pixelsOverlap, with the
+offset rounded to whole pixels in fixed point.*/
+static bool pixelsOverlapFixed(int appearance1, const FixedPosition &position1, int appearance2, const FixedPosition &position2)
+{
+	int dx = fixedFloor(position2.x - position1.x + FIXED_ONE / 2);
+	int dy = fixedFloor(position2.y - position1.y + FIXED_ONE / 2);
+	return masksOverlap(SPRITE_MASKS[appearance1], SPRITE_MASKS[appearance2], dx, dy);
+}
+
+static void moveShipFixed(FixedPosition &position, Gun &gun, sf::Uint8 input)
+{
+	gun.moved = false;
+	gun.ticksSinceShot++;
+
+	if ((input & INPUT_LEFT) && isInBoundsFixed(position.x, position.y, SHIP_WIDTH_FIXED, SHIP_HEIGHT_FIXED, -SHIP_VELOCITY_FIXED, 0))
+	{
+		position.x -= SHIP_VELOCITY_FIXED;
+		gun.moved = true;
+	}
+	if ((input & INPUT_RIGHT) && isInBoundsFixed(position.x, position.y, SHIP_WIDTH_FIXED, SHIP_HEIGHT_FIXED, SHIP_VELOCITY_FIXED, 0))
+	{
+		position.x += SHIP_VELOCITY_FIXED;
+		gun.moved = true;
+	}
+	if ((input & INPUT_LEFT) && (input & INPUT_RIGHT))
+	{
+		gun.moved = false;
+	}
+}
+
+/*This function checks if a ship shoots this tick. ticksSinceShot is whole ticks, so comparing it
+to the whole part of the cooldown is the same as comparing it to the exact cooldown.*/
+static bool fireShipFixed(Gun &gun, sf::Uint8 input)
+{
+	if (!(input & INPUT_FIRE) || gun.ticksSinceShot <= fixedFloor(gun.cooldownTicks))
+		return false;
+	gun.ticksSinceShot = 0;
+	gun.startTrigger = true;
+	return true;
+}
+
+static void updateCooldownFixed(Gun &gun)
+{
+	if (gun.moved && gun.cooldownTicks > MIN_SHOT_COOLDOWN_TICKS)
+		gun.cooldownTicks -= SHOT_COOLDOWN_INC_TICKS * SHOT_DECAY_MULTIPLIER_FIXED;
+	if (gun.startTrigger && gun.cooldownTicks < MAX_SHOT_COOLDOWN_TICKS)
+		gun.cooldownTicks += SHOT_COOLDOWN_INC_TICKS;
+}
+
+/*This function spawns a bullet at the middle of a ship's front edge, on a whole pixel like getMuzzlePosition.*/
+static void spawnBulletFixed(World &world, const FixedPosition &ship, sf::Uint8 owner)
+{
+	bool facingUp = (owner == OWNER_PLAYER2);
+	Fixed x = toFixed(fixedFloor(ship.x + SHIP_WIDTH_FIXED / 2));
+	Fixed y = facingUp ? ship.y : ship.y + SHIP_HEIGHT_FIXED;
+	int row = addBullet(world, sf::Vector2f(fixedToFloat(x), fixedToFloat(y)), owner);
+	if (row < 0)
+		return;
+	FixedPosition &position = getColumn<FixedPosition>(world, BULLET_ARCHETYPE)[row];
+	position.x = x;
+	position.y = y;
+}
+
+static void checkCollisionsFixed(World &world)
+{
+	int count = world.archetypes[BULLET_ARCHETYPE].count;
+	FixedPosition* positions = getColumn<FixedPosition>(world, BULLET_ARCHETYPE);
+	Projectile* projectiles = getColumn<Projectile>(world, BULLET_ARCHETYPE);
+	const Appearance* appearances = getColumn<Appearance>(world, BULLET_ARCHETYPE);
+	const FixedPosition* ships = getColumn<FixedPosition>(world, SHIP_ARCHETYPE);
+	Health* health = getColumn<Health>(world, SHIP_ARCHETYPE);
+
+	for (int i = 0; i < count; ++i)
+		positions[i].y += isFacingUp(projectiles[i]) ? -BULLET_VELOCITY_FIXED : BULLET_VELOCITY_FIXED;
+
+	for (int i = 0; i < count; ++i)
+	{
+		int target = (projectiles[i].owner == OWNER_PLAYER1) ? OWNER_PLAYER2 : OWNER_PLAYER1;
+		if (overlapFixed(positions[i].x, positions[i].y, BULLET_WIDTH_FIXED, BULLET_HEIGHT_FIXED,
+			ships[target].x, ships[target].y, SHIP_WIDTH_FIXED, SHIP_HEIGHT_FIXED) &&
+			pixelsOverlapFixed(shipAppearance, ships[target], appearances[i].type, positions[i])) {
+			projectiles[i].collided = true;
+			health[target].hit = true;
+			health[target].points--;
+			continue;
+		}
+
+		// Same early exits as checkCollisions
+		for (int j = 0; j < count; ++j) {
+			if (i == j)
+				break;
+			if (projectiles[i].owner == projectiles[j].owner)
+				break;
+			if (overlapFixed(positions[i].x, positions[i].y, BULLET_WIDTH_FIXED, BULLET_HEIGHT_FIXED,
+				positions[j].x, positions[j].y, BULLET_WIDTH_FIXED, BULLET_HEIGHT_FIXED) &&
+				pixelsOverlapFixed(appearances[i].type, positions[i], appearances[j].type, positions[j])) {
+				projectiles[i].collided = true;
+				projectiles[j].collided = true;
+			}
+		}
+	}
+}
+
+/*This function removes bullets exactly as removeBullets does, at most one collided and one
+leaving the screen per tick.*/
+static void removeBulletsFixed(World &world)
+{
+	const Archetype &bullets = world.archetypes[BULLET_ARCHETYPE];
+	FixedPosition* positions = getColumn<FixedPosition>(world, BULLET_ARCHETYPE);
+	Projectile* projectiles = getColumn<Projectile>(world, BULLET_ARCHETYPE);
+
+	for (int i = 0; i < bullets.count; ++i)
+	{
+		if (projectiles[i].collided) {
+			positions[i].x = toFixed(1200);
+			positions[i].y = toFixed(1200);
+		}
+	}
+
+	if (bullets.count > 0 && projectiles[0].collided)
+		removeRow(world, BULLET_ARCHETYPE, 0);
+
+	for (int i = 0; i < bullets.count; ++i)
+	{
+		Fixed step = isFacingUp(projectiles[i]) ? -BULLET_VELOCITY_FIXED : BULLET_VELOCITY_FIXED;
+		if (!isInBoundsFixed(positions[i].x, positions[i].y, BULLET_WIDTH_FIXED, BULLET_HEIGHT_FIXED, 0, step))
+		{
+			removeRow(world, BULLET_ARCHETYPE, i);
+			break;
+		}
+	}
+}
+
+/*This function advances a fixed point match that is not over by one tick.*/
+void simulateFixedTick(Match &match, sf::Uint8 input1, sf::Uint8 input2)
+{
+	World &world = match.world;
+	FixedPosition* positions = getColumn<FixedPosition>(world, SHIP_ARCHETYPE);
+	Gun* guns = getColumn<Gun>(world, SHIP_ARCHETYPE);
+	const sf::Uint8 inputs[] = { input1, input2 };
+	const sf::Uint8 owners[] = { OWNER_PLAYER1, OWNER_PLAYER2 };
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		moveShipFixed(positions[i], guns[i], inputs[i]);
+		if (fireShipFixed(guns[i], inputs[i]))
+			spawnBulletFixed(world, positions[i], owners[i]);
+	}
+	for (int i = 0; i < SHIPS; ++i)
+		updateCooldownFixed(guns[i]);
+
+	checkCollisionsFixed(world);
+	removeBulletsFixed(world);
+	syncFixedPositions(world);
+}
+
+/*This function moves the float positions to the fixed point ones, and the cooldown rates to the
+cooldown ticks, for drawing and snapshots.*/
+void syncFixedPositions(World &world)
+{
+	const int archetypes[] = { SHIP_ARCHETYPE, BULLET_ARCHETYPE };
+	for (int a = 0; a < 2; ++a)
+	{
+		Position* positions = getColumn<Position>(world, archetypes[a]);
+		const FixedPosition* fixedPositions = getColumn<FixedPosition>(world, archetypes[a]);
+		for (int i = 0; i < world.archetypes[archetypes[a]].count; ++i)
+		{
+			positions[i].x = fixedToFloat(fixedPositions[i].x);
+			positions[i].y = fixedToFloat(fixedPositions[i].y);
+		}
+	}
+	Gun* guns = getColumn<Gun>(world, SHIP_ARCHETYPE);
+	for (int i = 0; i < SHIPS; ++i)
+		guns[i].cooldownRate = fixedToFloat(guns[i].cooldownTicks) / TICK_RATE;
+}
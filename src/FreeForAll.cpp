@@ -0,0 +1,526 @@
+#include "FreeForAll.h"
+#include <cmath>
+#include "BulletKernel.h"
+#include "Overlap.h"
+
+// Components of each archetype of a free for all.
+const ComponentMask FREE_FOR_ALL_SHIP_COMPONENTS = (1 << positionComponent) | (1 << gunComponent) | (1 << healthComponent)
+	| (1 << appearanceComponent);
+const ComponentMask FREE_FOR_ALL_BULLET_COMPONENTS = (1 << positionComponent) | (1 << velocityComponent)
+	| (1 << projectileComponent) | (1 << appearanceComponent);
+const ComponentMask FREE_FOR_ALL_EMITTER_COMPONENTS = (1 << positionComponent) | (1 << emitterComponent);
+const int FREE_FOR_ALL_SPAWN_COLUMNS = 8;	/* ships start on a lattice of this many columns, at most */
+const float PI = 3.14159265f;
+// Bullet hell settings, see addBulletHellEmitters.
+const float BULLET_HELL_RING = FREE_FOR_ALL_HEIGHT * .35f;	/* emitters stand on a circle this wide around the middle */
+const Emitter BULLET_HELL_PATTERNS[] = {
+	// pattern, bullets, interval, ticksLeft, angle, spin, spread, speed, script
+	{ radialPattern, 32, 40, 0, 0, .1f, 0, 4, 0 },
+	{ spiralPattern, 4, 3, 0, 0, .15f, PI / 2, 5, 0 },
+	{ aimedPattern, 5, 30, 0, 0, 0, .12f, 6, 0 }
+};
+const int BULLET_HELL_PATTERN_COUNT = sizeof(BULLET_HELL_PATTERNS) / sizeof(BULLET_HELL_PATTERNS[0]);
+const Emitter BULLET_HELL_SCRIPTED = { scriptedPattern, 12, 45, 0, 0, .2f, PI / 6, 3, 0 };	/* one per script */
+
+/*This function lays out the world of a free for all of some ships (at most MAX_FREE_FOR_ALL_SHIPS)
+and starts the first round. It has no emitters until they are added.*/
+void initializeFreeForAll(FreeForAll& game, int ships, int health)
+{
+	if (ships > MAX_FREE_FOR_ALL_SHIPS)
+		ships = MAX_FREE_FOR_ALL_SHIPS;
+	if (ships < 1)
+		ships = 1;
+	clearWorld(game.world);
+	addArchetype(game.world, FREE_FOR_ALL_SHIP_COMPONENTS, MAX_FREE_FOR_ALL_SHIPS, COMPONENT_SIZES);
+	addArchetype(game.world, FREE_FOR_ALL_BULLET_COMPONENTS, MAX_FREE_FOR_ALL_BULLETS, COMPONENT_SIZES);
+	addArchetype(game.world, FREE_FOR_ALL_EMITTER_COMPONENTS, MAX_FREE_FOR_ALL_EMITTERS, COMPONENT_SIZES);
+	initializePatternVM(game.patterns, NULL, 0);
+	game.regions.bullets.assign(MAX_FREE_FOR_ALL_BULLETS, 0);
+	game.regions.regionOf.assign(MAX_FREE_FOR_ALL_BULLETS, 0);
+	game.regions.hits.assign(MAX_FREE_FOR_ALL_BULLETS, -1);
+	game.jobs = NULL;
+	game.ships = ships;
+	game.health = health;
+	game.round = 0;
+	restartFreeForAll(game);
+}
+
+/*This function puts every ship back on its start, with full health, and clears the bullets.
+Emitters stay where they are.*/
+void restartFreeForAll(FreeForAll& game)
+{
+	World& world = game.world;
+	int spawnColumns = (game.ships < FREE_FOR_ALL_SPAWN_COLUMNS) ? game.ships : FREE_FOR_ALL_SPAWN_COLUMNS;
+	int spawnRows = (game.ships + spawnColumns - 1) / spawnColumns;
+	float spacingX = static_cast<float>(FREE_FOR_ALL_WIDTH) / spawnColumns;
+	float spacingY = static_cast<float>(FREE_FOR_ALL_HEIGHT) / spawnRows;
+
+	clearArchetype(world, SHIP_ARCHETYPE);
+	for (int i = 0; i < game.ships; ++i)
+	{
+		int row = addRow(world, SHIP_ARCHETYPE);
+		Position& position = getColumn<Position>(world, SHIP_ARCHETYPE)[row];
+		position.x = (i % spawnColumns + .5f) * spacingX - SHIP_WIDTH / 2;
+		position.y = (i / spawnColumns + .5f) * spacingY - SHIP_HEIGHT / 2;
+		Gun& gun = getColumn<Gun>(world, SHIP_ARCHETYPE)[row];
+		gun.ticksSinceShot = TICK_RATE;
+		gun.cooldownRate = MIN_SHOT_COOLDOWN;
+		gun.moved = false;
+		gun.startTrigger = false;
+		Health& health = getColumn<Health>(world, SHIP_ARCHETYPE)[row];
+		health.points = game.health;
+		health.hit = false;
+		getColumn<Appearance>(world, SHIP_ARCHETYPE)[row].type = shipAppearance;
+	}
+	clearArchetype(world, BULLET_ARCHETYPE);
+	clearPatternBullets(game.patterns);
+	game.ticksOver = 0;
+}
+
+/*This function checks if a box is entirely within the arena.*/
+static bool isInArena(float x, float y, float width, float height)
+{
+	return x >= 0 && y >= 0 && x + width <= FREE_FOR_ALL_WIDTH && y + height <= FREE_FOR_ALL_HEIGHT;
+}
+
+/*This function returns the first and last grid column and row a box overlaps, clamped to the grid.*/
+static void getCellRange(const sf::FloatRect& box, int& column0, int& column1, int& row0, int& row1)
+{
+	column0 = static_cast<int>(box.left) / FREE_FOR_ALL_CELL;
+	column1 = static_cast<int>(box.left + box.width) / FREE_FOR_ALL_CELL;
+	row0 = static_cast<int>(box.top) / FREE_FOR_ALL_CELL;
+	row1 = static_cast<int>(box.top + box.height) / FREE_FOR_ALL_CELL;
+	column0 = (column0 < 0) ? 0 : (column0 >= FREE_FOR_ALL_COLUMNS ? FREE_FOR_ALL_COLUMNS - 1 : column0);
+	column1 = (column1 < 0) ? 0 : (column1 >= FREE_FOR_ALL_COLUMNS ? FREE_FOR_ALL_COLUMNS - 1 : column1);
+	row0 = (row0 < 0) ? 0 : (row0 >= FREE_FOR_ALL_ROWS ? FREE_FOR_ALL_ROWS - 1 : row0);
+	row1 = (row1 < 0) ? 0 : (row1 >= FREE_FOR_ALL_ROWS ? FREE_FOR_ALL_ROWS - 1 : row1);
+}
+
+/*This function moves a living ship in any of four directions, within the arena, and fires a
+bullet along its aim if its cooldown allows. The cooldown rules are the ones of a duel.*/
+static void moveAndFire(FreeForAll& game, int ship, const FreeForAllInput& input)
+{
+	World& world = game.world;
+	Position& position = getColumn<Position>(world, SHIP_ARCHETYPE)[ship];
+	Gun& gun = getColumn<Gun>(world, SHIP_ARCHETYPE)[ship];
+
+	gun.moved = false;
+	gun.ticksSinceShot++;
+	float dx = 0, dy = 0;
+	if (input.buttons & INPUT_LEFT)
+		dx -= SHIP_VELOCITY;
+	if (input.buttons & INPUT_RIGHT)
+		dx += SHIP_VELOCITY;
+	if (input.buttons & INPUT_UP)
+		dy -= SHIP_VELOCITY;
+	if (input.buttons & INPUT_DOWN)
+		dy += SHIP_VELOCITY;
+	if ((dx != 0 || dy != 0) && isInArena(position.x + dx, position.y + dy, SHIP_WIDTH, SHIP_HEIGHT)) {
+		position.x += dx;
+		position.y += dy;
+		gun.moved = true;
+	}
+
+	if (fireShip(gun, input.buttons))
+	{
+		// From the middle of the ship, so it can fire any way
+		sf::Vector2f muzzle(position.x + (SHIP_WIDTH - BULLET_WIDTH) / 2, position.y + (SHIP_HEIGHT - BULLET_HEIGHT) / 2);
+		float angle = input.aim * (2 * PI / 256);
+		addFreeForAllBullet(game, muzzle, sf::Vector2f(std::cos(angle) * BULLET_VELOCITY, std::sin(angle) * BULLET_VELOCITY), ship);
+	}
+	updateCooldownRate(gun);
+}
+
+/*This function spawns a bullet fired by a ship, and returns its row (-1 if the arena has
+MAX_FREE_FOR_ALL_BULLETS already, the shot is lost).*/
+int addFreeForAllBullet(FreeForAll& game, sf::Vector2f position, sf::Vector2f velocity, int owner)
+{
+	World& world = game.world;
+	int row = addRow(world, BULLET_ARCHETYPE);
+	if (row < 0)
+		return row;
+	Position& bullet = getColumn<Position>(world, BULLET_ARCHETYPE)[row];
+	bullet.x = position.x;
+	bullet.y = position.y;
+	Velocity& bulletVelocity = getColumn<Velocity>(world, BULLET_ARCHETYPE)[row];
+	bulletVelocity.x = velocity.x;
+	bulletVelocity.y = velocity.y;
+	Projectile& projectile = getColumn<Projectile>(world, BULLET_ARCHETYPE)[row];
+	projectile.owner = static_cast<sf::Uint8>(owner);
+	projectile.collided = false;
+	getColumn<Appearance>(world, BULLET_ARCHETYPE)[row].type = (velocity.y < 0) ? bulletUpAppearance : bulletDownAppearance;
+	return row;
+}
+
+/*This function gives a free for all the scripts its scripted emitters run, with room for
+MAX_FREE_FOR_ALL_PATTERN_BULLETS bullets of each. The library must outlive the game.*/
+void setFreeForAllPatterns(FreeForAll& game, const PatternLibrary* library)
+{
+	initializePatternVM(game.patterns, library, library ? MAX_FREE_FOR_ALL_PATTERN_BULLETS : 0);
+}
+
+/*This function has the hit test of a free for all run on a job system (NULL for none). The hits
+are the same either way, only the time they take changes.*/
+void setFreeForAllJobs(FreeForAll& game, JobSystem* jobs)
+{
+	game.jobs = jobs;
+}
+
+/*This function adds an emitter, centered on a position, and returns its row (-1 if the arena has
+MAX_FREE_FOR_ALL_EMITTERS already).*/
+int addEmitter(FreeForAll& game, sf::Vector2f position, const Emitter& emitter)
+{
+	World& world = game.world;
+	int row = addRow(world, EMITTER_ARCHETYPE);
+	if (row < 0)
+		return row;
+	Position& center = getColumn<Position>(world, EMITTER_ARCHETYPE)[row];
+	center.x = position.x;
+	center.y = position.y;
+	getColumn<Emitter>(world, EMITTER_ARCHETYPE)[row] = emitter;
+	return row;
+}
+
+/*This function adds emitters on a circle around the middle of the arena, taking turns between the
+patterns of BULLET_HELL_PATTERNS and one scripted pattern per script of the game, each one
+starting at its own angle and tick.*/
+void addBulletHellEmitters(FreeForAll& game, int emitters)
+{
+	int patterns = BULLET_HELL_PATTERN_COUNT + static_cast<int>(game.patterns.groups.size());
+	for (int i = 0; i < emitters; ++i)
+	{
+		float around = i * (2 * PI / emitters);
+		sf::Vector2f position(FREE_FOR_ALL_WIDTH / 2 + std::cos(around) * BULLET_HELL_RING,
+			FREE_FOR_ALL_HEIGHT / 2 + std::sin(around) * BULLET_HELL_RING);
+		Emitter emitter = BULLET_HELL_SCRIPTED;
+		if (i % patterns < BULLET_HELL_PATTERN_COUNT)
+			emitter = BULLET_HELL_PATTERNS[i % patterns];
+		else
+			emitter.script = static_cast<sf::Uint8>(i % patterns - BULLET_HELL_PATTERN_COUNT);
+		emitter.angle = around;
+		emitter.ticksLeft = static_cast<sf::Uint16>(i % emitter.interval);
+		if (addEmitter(game, position, emitter) < 0)
+			return;
+	}
+}
+
+/*This function returns the living ship whose middle is closest to a point, or -1 if none is left.*/
+static int getNearestShipTo(const FreeForAll& game, float x, float y)
+{
+	const Position* positions = getColumn<Position>(game.world, SHIP_ARCHETYPE);
+	const Health* health = getColumn<Health>(game.world, SHIP_ARCHETYPE);
+	int nearest = -1;
+	float nearestDistance = 0;
+	for (int ship = 0; ship < game.ships; ++ship)
+	{
+		if (health[ship].points <= 0)
+			continue;
+		float dx = positions[ship].x + SHIP_WIDTH / 2 - x;
+		float dy = positions[ship].y + SHIP_HEIGHT / 2 - y;
+		float distance = dx * dx + dy * dy;
+		if (nearest < 0 || distance < nearestDistance) {
+			nearest = ship;
+			nearestDistance = distance;
+		}
+	}
+	return nearest;
+}
+
+/*This function fires the volley of every emitter whose interval is up. Radial volleys go evenly
+around, spiral and scripted ones spread bullets from the emitter's angle, which then turns by
+spin, and aimed ones spread them around the way to the nearest ship. Scripted bullets go to the
+pattern VM, with their place in the volley as parameter. With the arena full of bullets, volleys
+are cut short; scripted emitters fire regardless, their bullets live elsewhere.*/
+static void fireEmitters(FreeForAll& game)
+{
+	World& world = game.world;
+	int count = world.archetypes[EMITTER_ARCHETYPE].count;
+	const Position* positions = getColumn<Position>(world, EMITTER_ARCHETYPE);
+	Emitter* emitters = getColumn<Emitter>(world, EMITTER_ARCHETYPE);
+	for (int i = 0; i < count; ++i)
+	{
+		Emitter& emitter = emitters[i];
+		if (emitter.ticksLeft > 0) {
+			emitter.ticksLeft--;
+			continue;
+		}
+		emitter.ticksLeft = emitter.interval;
+
+		float first = emitter.angle, step = emitter.spread;
+		if (emitter.pattern == radialPattern)
+			step = 2 * PI / emitter.bullets;
+		else if (emitter.pattern == aimedPattern) {
+			int target = getNearestShipTo(game, positions[i].x, positions[i].y);
+			if (target < 0)
+				continue;
+			const Position& ship = getColumn<Position>(world, SHIP_ARCHETYPE)[target];
+			first = std::atan2(ship.y + SHIP_HEIGHT / 2 - positions[i].y, ship.x + SHIP_WIDTH / 2 - positions[i].x)
+				- step * (emitter.bullets - 1) / 2;
+		}
+		sf::Vector2f muzzle(positions[i].x - BULLET_WIDTH / 2, positions[i].y - BULLET_HEIGHT / 2);
+		for (int bullet = 0; bullet < emitter.bullets; ++bullet)
+		{
+			float angle = first + bullet * step;
+			sf::Vector2f velocity(std::cos(angle) * emitter.speed, std::sin(angle) * emitter.speed);
+			if (emitter.pattern == scriptedPattern)
+				addPatternBullet(game.patterns, emitter.script, muzzle, velocity, static_cast<float>(bullet));
+			else if (addFreeForAllBullet(game, muzzle, velocity, EMITTER_OWNER) < 0)
+				break;	// the arena is full, the rest of this volley is lost but the other emitters still fire
+		}
+		emitter.angle = std::fmod(emitter.angle + emitter.spin, 2 * PI);
+	}
+}
+
+/*This function sorts the living ships into the cells they overlap: count per cell, prefix sum, fill.*/
+static void buildShipGrid(FreeForAll& game)
+{
+	ShipGrid& grid = game.grid;
+	const Position* positions = getColumn<Position>(game.world, SHIP_ARCHETYPE);
+	const Health* health = getColumn<Health>(game.world, SHIP_ARCHETYPE);
+	int column0, column1, row0, row1;
+
+	for (int cell = 0; cell <= FREE_FOR_ALL_CELLS; ++cell)
+		grid.cellStart[cell] = 0;
+	for (int ship = 0; ship < game.ships; ++ship)
+	{
+		if (health[ship].points <= 0)
+			continue;
+		getCellRange(getShipBounds(positions[ship]), column0, column1, row0, row1);
+		for (int row = row0; row <= row1; ++row)
+			for (int column = column0; column <= column1; ++column)
+				grid.cellStart[row * FREE_FOR_ALL_COLUMNS + column + 1]++;
+	}
+	for (int cell = 0; cell < FREE_FOR_ALL_CELLS; ++cell)
+	{
+		grid.cellStart[cell + 1] += grid.cellStart[cell];
+		grid.cellFill[cell] = grid.cellStart[cell];
+	}
+	for (int ship = 0; ship < game.ships; ++ship)
+	{
+		if (health[ship].points <= 0)
+			continue;
+		getCellRange(getShipBounds(positions[ship]), column0, column1, row0, row1);
+		for (int row = row0; row <= row1; ++row)
+			for (int column = column0; column <= column1; ++column)
+				grid.entries[grid.cellFill[row * FREE_FOR_ALL_COLUMNS + column]++] = static_cast<sf::Uint8>(ship);
+	}
+}
+
+/*This function returns the first ship a bullet of the given appearance hits, or -1. Only the ships
+in the cells the bullet overlaps are tested, and never the one that fired it, their solid pixels
+only once their boxes overlap.*/
+static int findHitShip(const FreeForAll& game, const Position& position, int appearance, int owner)
+{
+	const ShipGrid& grid = game.grid;
+	const Position* positions = getColumn<Position>(game.world, SHIP_ARCHETYPE);
+	sf::FloatRect bullet = getBulletBounds(position);
+	int column0, column1, row0, row1;
+	getCellRange(bullet, column0, column1, row0, row1);
+	for (int row = row0; row <= row1; ++row)
+	{
+		for (int column = column0; column <= column1; ++column)
+		{
+			int cell = row * FREE_FOR_ALL_COLUMNS + column;
+			for (int i = grid.cellStart[cell]; i < grid.cellStart[cell + 1]; ++i)
+			{
+				int ship = grid.entries[i];
+				if (ship != owner && overlap(bullet, getShipBounds(positions[ship])) &&
+					pixelsOverlap(shipAppearance, positions[ship], appearance, position))
+					return ship;
+			}
+		}
+	}
+	return -1;
+}
+
+/*This function is the job of one region: the hit of each of its bullets.*/
+static void findRegionHits(void* data, int region)
+{
+	FreeForAll& game = *static_cast<FreeForAll*>(data);
+	BulletRegions& regions = game.regions;
+	const Position* positions = getColumn<Position>(game.world, BULLET_ARCHETYPE);
+	const Projectile* projectiles = getColumn<Projectile>(game.world, BULLET_ARCHETYPE);
+	const Appearance* appearances = getColumn<Appearance>(game.world, BULLET_ARCHETYPE);
+	for (int i = regions.regionStart[region]; i < regions.regionStart[region + 1]; ++i)
+	{
+		int bullet = regions.bullets[i];
+		regions.hits[bullet] = static_cast<sf::Int8>(findHitShip(game, positions[bullet], appearances[bullet].type, projectiles[bullet].owner));
+	}
+}
+
+/*This function finds the ship each bullet hits, if any, into regions.hits: it sorts the ships
+into the grid and the bullets into regions, then tests the regions as jobs. Nothing else is
+written, so the state is unchanged.*/
+void findFreeForAllHits(FreeForAll& game)
+{
+	BulletRegions& regions = game.regions;
+	int count = game.world.archetypes[BULLET_ARCHETYPE].count;
+	const Position* positions = getColumn<Position>(game.world, BULLET_ARCHETYPE);
+	int column0, column1, row0, row1;
+
+	buildShipGrid(game);
+	for (int region = 0; region <= FREE_FOR_ALL_REGIONS; ++region)
+		regions.regionStart[region] = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		getCellRange(getBulletBounds(positions[i]), column0, column1, row0, row1);
+		int region = (row0 / FREE_FOR_ALL_REGION_CELLS) * FREE_FOR_ALL_REGION_COLUMNS + column0 / FREE_FOR_ALL_REGION_CELLS;
+		regions.regionOf[i] = static_cast<sf::Uint8>(region);
+		regions.regionStart[region + 1]++;
+	}
+	for (int region = 0; region < FREE_FOR_ALL_REGIONS; ++region)
+	{
+		regions.regionStart[region + 1] += regions.regionStart[region];
+		regions.regionFill[region] = regions.regionStart[region];
+	}
+	for (int i = 0; i < count; ++i)
+		regions.bullets[regions.regionFill[regions.regionOf[i]]++] = i;
+
+	runJobs(game.jobs, &findRegionHits, &game, FREE_FOR_ALL_REGIONS);
+}
+
+/*This function moves the bullets, lets each hit at most one ship, and removes those that hit or
+left the arena, keeping the others in the order they were fired.*/
+static void updateBullets(FreeForAll& game)
+{
+	World& world = game.world;
+	int count = world.archetypes[BULLET_ARCHETYPE].count;
+	Position* positions = getColumn<Position>(world, BULLET_ARCHETYPE);
+	const Velocity* velocities = getColumn<Velocity>(world, BULLET_ARCHETYPE);
+	Projectile* projectiles = getColumn<Projectile>(world, BULLET_ARCHETYPE);
+	Health* health = getColumn<Health>(world, SHIP_ARCHETYPE);
+
+	integrateBullets(positions, velocities, count);
+
+	findFreeForAllHits(game);
+	for (int i = 0; i < count; ++i)
+	{
+		int ship = game.regions.hits[i];
+		if (ship >= 0) {
+			projectiles[i].collided = true;
+			health[ship].hit = true;
+			health[ship].points--;
+		}
+	}
+
+	int kept = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		if (projectiles[i].collided || !isInArena(positions[i].x, positions[i].y, BULLET_WIDTH, BULLET_HEIGHT))
+			continue;
+		if (kept != i)
+			copyRow(world, BULLET_ARCHETYPE, i, kept);
+		kept++;
+	}
+	truncateArchetype(world, BULLET_ARCHETYPE, kept);
+}
+
+/*This function runs the scripted bullets, moved by their scripts, through the same hit test as
+the others (on the grid updateBullets built), then removes those that hit, were killed or left
+the arena.*/
+static void updatePatternBullets(FreeForAll& game)
+{
+	PatternVM& vm = game.patterns;
+	Health* health = getColumn<Health>(game.world, SHIP_ARCHETYPE);
+	runPatterns(vm);
+	for (std::size_t script = 0; script < vm.groups.size(); ++script)
+	{
+		PatternGroup& group = vm.groups[script];
+		const float* x = getPatternRegister(vm, static_cast<int>(script), registerX);
+		const float* y = getPatternRegister(vm, static_cast<int>(script), registerY);
+		const float* vy = getPatternRegister(vm, static_cast<int>(script), registerVY);
+		for (int i = 0; i < group.count; ++i)
+		{
+			if (group.killed[i])
+				continue;
+			Position position = { x[i], y[i] };
+			int ship = findHitShip(game, position, (vy[i] < 0) ? bulletUpAppearance : bulletDownAppearance, EMITTER_OWNER);
+			if (ship >= 0) {
+				group.killed[i] = 1;
+				health[ship].hit = true;
+				health[ship].points--;
+			}
+		}
+	}
+	removePatternBullets(vm, sf::FloatRect(0, 0, FREE_FOR_ALL_WIDTH - BULLET_WIDTH, FREE_FOR_ALL_HEIGHT - BULLET_HEIGHT));
+}
+
+/*This function advances a free for all by one tick, with one input per ship. Once one ship or
+none is left (none, in a bullet hell of one ship), the round stands still for REMATCH_TICKS and
+starts over.*/
+void simulateFreeForAllTick(FreeForAll& game, const FreeForAllInput inputs[])
+{
+	if (countLivingShips(game) <= ((game.ships > 1) ? 1 : 0))
+	{
+		if (++game.ticksOver >= REMATCH_TICKS) {
+			restartFreeForAll(game);
+			game.round++;
+		}
+		return;
+	}
+
+	const Health* health = getColumn<Health>(game.world, SHIP_ARCHETYPE);
+	for (int ship = 0; ship < game.ships; ++ship)
+	{
+		if (health[ship].points > 0)
+			moveAndFire(game, ship, inputs[ship]);
+	}
+	fireEmitters(game);
+	updateBullets(game);
+	updatePatternBullets(game);
+}
+
+int countLivingShips(const FreeForAll& game)
+{
+	const Health* health = getColumn<Health>(game.world, SHIP_ARCHETYPE);
+	int living = 0;
+	for (int ship = 0; ship < game.ships; ++ship)
+	{
+		if (health[ship].points > 0)
+			living++;
+	}
+	return living;
+}
+
+/*This function returns the living ship closest to a ship, or -1 if it is the last one.*/
+int getNearestShip(const FreeForAll& game, int ship)
+{
+	const Position* positions = getColumn<Position>(game.world, SHIP_ARCHETYPE);
+	const Health* health = getColumn<Health>(game.world, SHIP_ARCHETYPE);
+	int nearest = -1;
+	float nearestDistance = 0;
+	for (int other = 0; other < game.ships; ++other)
+	{
+		if (other == ship || health[other].points <= 0)
+			continue;
+		float dx = positions[other].x - positions[ship].x;
+		float dy = positions[other].y - positions[ship].y;
+		float distance = dx * dx + dy * dy;
+		if (nearest < 0 || distance < nearestDistance) {
+			nearest = other;
+			nearestDistance = distance;
+		}
+	}
+	return nearest;
+}
+
+/*This function returns the aim from one ship to another, in 256 steps per turn.*/
+sf::Uint8 getAimAt(const FreeForAll& game, int ship, int target)
+{
+	const Position* positions = getColumn<Position>(game.world, SHIP_ARCHETYPE);
+	float angle = std::atan2(positions[target].y - positions[ship].y, positions[target].x - positions[ship].x);
+	return static_cast<sf::Uint8>(static_cast<int>(std::floor(angle * 256 / (2 * PI) + .5f)) & 255);
+}
+
+/*This function plays a ship: it keeps moving the same way for a while, then picks another way
+at random, and keeps firing at the nearest ship.*/
+void updateFreeForAllBot(const FreeForAll& game, int ship, sf::Uint32& random, FreeForAllInput& input)
+{
+	random = random * 1664525u + 1013904223u;
+	if ((random >> 16) % 10 == 0)
+		input.buttons = static_cast<sf::Uint8>((random >> 8) & (INPUT_LEFT | INPUT_RIGHT | INPUT_UP | INPUT_DOWN));
+	input.buttons |= INPUT_FIRE;
+	int target = getNearestShip(game, ship);
+	if (target >= 0)
+		input.aim = getAimAt(game, ship, target);
+}
@@ -0,0 +1,87 @@
+#ifndef FREE_FOR_ALL_H
+#define FREE_FOR_ALL_H
+
+#include "Jobs.h"
+#include "Pattern.h"
+#include "Simulation.h"
+
+// Free for all settings.
+const int MAX_FREE_FOR_ALL_SHIPS = 64;
+const int MAX_FREE_FOR_ALL_BULLETS = 65536;	/* a shot past this is lost */
+const int MAX_FREE_FOR_ALL_PATTERN_BULLETS = 8192;	/* of each script */
+const int MAX_FREE_FOR_ALL_EMITTERS = 64;
+const int FREE_FOR_ALL_HEALTH = 10;
+const int FREE_FOR_ALL_WIDTH = 4 * VIDEO_WIDTH;	/* the window shows a part of it, around the local ship */
+const int FREE_FOR_ALL_HEIGHT = 4 * VIDEO_HEIGHT;
+const int FREE_FOR_ALL_CELL = 128;	/* collision grid cell, bigger than a ship so a ship covers at most 4 cells */
+const int FREE_FOR_ALL_COLUMNS = (FREE_FOR_ALL_WIDTH + FREE_FOR_ALL_CELL - 1) / FREE_FOR_ALL_CELL;
+const int FREE_FOR_ALL_ROWS = (FREE_FOR_ALL_HEIGHT + FREE_FOR_ALL_CELL - 1) / FREE_FOR_ALL_CELL;
+const int FREE_FOR_ALL_CELLS = FREE_FOR_ALL_COLUMNS * FREE_FOR_ALL_ROWS;
+const int FREE_FOR_ALL_REGION_CELLS = 4;	/* a region of the parallel hit test is this many cells across and down */
+const int FREE_FOR_ALL_REGION_COLUMNS = (FREE_FOR_ALL_COLUMNS + FREE_FOR_ALL_REGION_CELLS - 1) / FREE_FOR_ALL_REGION_CELLS;
+const int FREE_FOR_ALL_REGION_ROWS = (FREE_FOR_ALL_ROWS + FREE_FOR_ALL_REGION_CELLS - 1) / FREE_FOR_ALL_REGION_CELLS;
+const int FREE_FOR_ALL_REGIONS = FREE_FOR_ALL_REGION_COLUMNS * FREE_FOR_ALL_REGION_ROWS;
+
+const int EMITTER_ARCHETYPE = 2;
+const int EMITTER_OWNER = 255;	/* owner of emitter bullets, which hit every ship */
+
+// The input of one ship for one tick: the INPUT_ bits, and the direction it fires in.
+struct FreeForAllInput {
+	sf::Uint8 buttons;
+	sf::Uint8 aim;		// 256 steps per turn, 0 is right and 64 is down
+};
+
+// The living ships overlapping each cell of the arena, rebuilt every tick with a counting sort, so
+// a bullet is only tested against the few ships near it.
+struct ShipGrid {
+	int cellStart[FREE_FOR_ALL_CELLS + 1];	// ships of cell c are entries[cellStart[c]] up to cellStart[c + 1]
+	int cellFill[FREE_FOR_ALL_CELLS];		// while sorting, where the next ship of each cell goes
+	sf::Uint8 entries[MAX_FREE_FOR_ALL_SHIPS * 4];
+};
+
+// The bullets sorted by the region their top left corner is in, one hit test job per region. A
+// bullet belongs to one region only, even if it overlaps the next, so every bullet and ship pair
+// is tested once. Jobs write the hit of their own bullets only, and hits are applied afterwards in
+// bullet order, so they are the same whatever thread ran which region.
+struct BulletRegions {
+	int regionStart[FREE_FOR_ALL_REGIONS + 1];	// bullets of region r are bullets[regionStart[r]] up to regionStart[r + 1]
+	int regionFill[FREE_FOR_ALL_REGIONS];
+	std::vector<int> bullets;		// rows of the bullet archetype, in row order within a region
+	std::vector<sf::Uint8> regionOf;	// by bullet row
+	std::vector<sf::Int8> hits;		// by bullet row, the ship it hit or -1
+};
+
+// Up to MAX_FREE_FOR_ALL_SHIPS ships in one arena, each firing at whoever it likes, the last one
+// alive wins. Ships are rows of SHIP_ARCHETYPE and bullets rows of BULLET_ARCHETYPE, like in a duel,
+// but bullets fly along a Velocity and hit any ship but the one that fired them. Emitters, rows of
+// EMITTER_ARCHETYPE, add bullet patterns for every ship to dodge; a game of one ship and emitters
+// is a bullet hell, its round lasts until that ship dies. Bullets of scripted patterns are not
+// entities, they live in the pattern VM, which hit tests them like the others. Every pass of a tick is linear in ships
+// plus bullets. Float only, so it is not meant for lockstep across builds.
+struct FreeForAll {
+	World world;
+	int ships;			// rows of the ship archetype, dead or alive
+	int health;			// of every ship when a round starts
+	int ticksOver;		// ticks since one ship or none was left
+	int round;
+	PatternVM patterns;	// bullets of scripted emitters
+	ShipGrid grid;		// scratch of the collision pass, not part of the state
+	BulletRegions regions;	// same
+	JobSystem* jobs;	// runs the hit test, NULL to run it on the simulating thread
+};
+
+void initializeFreeForAll(FreeForAll& game, int ships, int health);
+void restartFreeForAll(FreeForAll& game);
+void simulateFreeForAllTick(FreeForAll& game, const FreeForAllInput inputs[]);
+int addFreeForAllBullet(FreeForAll& game, sf::Vector2f position, sf::Vector2f velocity, int owner);
+void setFreeForAllJobs(FreeForAll& game, JobSystem* jobs);
+void findFreeForAllHits(FreeForAll& game);
+void setFreeForAllPatterns(FreeForAll& game, const PatternLibrary* library);
+int addEmitter(FreeForAll& game, sf::Vector2f position, const Emitter& emitter);
+void addBulletHellEmitters(FreeForAll& game, int emitters);
+int countLivingShips(const FreeForAll& game);
+int getNearestShip(const FreeForAll& game, int ship);
+sf::Uint8 getAimAt(const FreeForAll& game, int ship, int target);
+void updateFreeForAllBot(const FreeForAll& game, int ship, sf::Uint32& random, FreeForAllInput& input);
+
+#endif
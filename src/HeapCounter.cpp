@@ -0,0 +1,65 @@
+#include "HeapCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<sf::Uint64> heapAllocations(0);
+
+/*This function returns how many times operator new was called since the program started, always
+0 where allocations are not counted.*/
+sf::Uint64 getHeapAllocations()
+{
+	return heapAllocations.load(std::memory_order_relaxed);
+}
+
+#if COUNT_HEAP_ALLOCATIONS
+
+// The replacements of the global operators, plain and array, throwing and not. They allocate like
+// the standard ones, with malloc, and only add the counting.
+
+void* operator new(std::size_t size)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	void* memory = std::malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) throw()
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& nothrow) throw()
+{
+	return operator new(size, nothrow);
+}
+
+void operator delete(void* memory) throw()
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) throw()
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) throw()
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) throw()
+{
+	std::free(memory);
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HEAP_COUNTER_H
+#define HEAP_COUNTER_H
+
+#include <SFML/Config.hpp>
+
+// Where operator new is counted: debug builds, unless COUNT_HEAP_ALLOCATIONS is defined to choose.
+// Release builds keep the standard allocator.
+#if !defined(COUNT_HEAP_ALLOCATIONS)
+#if defined(NDEBUG)
+#define COUNT_HEAP_ALLOCATIONS 0
+#else
+#define COUNT_HEAP_ALLOCATIONS 1
+#endif
+#endif
+
+// Where counted, every operator new of the program goes through HeapCounter.cpp, so a test can
+// check that some code never touches the heap. Counting costs one atomic add per allocation.
+sf::Uint64 getHeapAllocations();
+
+#endif
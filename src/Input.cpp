@@ -0,0 +1,116 @@
+#include "Input.h"
+
+/*This function records key presses and releases. Keys released while the window is not
+focused never produce an event, so everything is released when focus is lost.*/
+void updateKeyboardState(KeyboardState& keyboard, const sf::Event& event)
+{
+	switch (event.type)
+	{
+	case sf::Event::KeyPressed:
+		if (event.key.code >= 0 && event.key.code < sf::Keyboard::KeyCount) {
+			keyboard.down.set(event.key.code);
+			keyboard.pressed.set(event.key.code);
+		}
+		break;
+	case sf::Event::KeyReleased:
+		if (event.key.code >= 0 && event.key.code < sf::Keyboard::KeyCount)
+			keyboard.down.reset(event.key.code);
+		break;
+	case sf::Event::LostFocus:
+		keyboard.down.reset();
+		break;
+	default:
+		break;
+	}
+}
+
+/*This function forgets which keys went down during the tick that just ended.*/
+void clearTickPresses(KeyboardState& keyboard)
+{
+	keyboard.pressed.reset();
+}
+
+/*This function checks if a key was held at any point of the tick, so a tap that is
+pressed and released between two ticks still counts.*/
+bool isKeyDown(const KeyboardState& keyboard, sf::Keyboard::Key key)
+{
+	return key >= 0 && key < sf::Keyboard::KeyCount && (keyboard.down.test(key) || keyboard.pressed.test(key));
+}
+
+/*This function checks if an event is the given key going down.*/
+bool wasKeyPressed(const sf::Event& event, sf::Keyboard::Key key)
+{
+	return event.type == sf::Event::KeyPressed && event.key.code == key;
+}
+
+/*This function filters the events the game reacts to, so mouse motion does not fill the queue.*/
+bool isGameEvent(const sf::Event& event)
+{
+	switch (event.type)
+	{
+	case sf::Event::Closed:
+	case sf::Event::Resized:
+	case sf::Event::LostFocus:
+	case sf::Event::GainedFocus:
+	case sf::Event::KeyPressed:
+	case sf::Event::KeyReleased:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*This function empties the queue. Must be called before either thread uses it.*/
+void initializeInputQueue(InputQueue& queue)
+{
+	queue.head.store(0);
+	queue.tail.store(0);
+	queue.sleeping.store(false);
+}
+
+/*This function adds an event at the back of the queue, and wakes the simulation thread if it
+sleeps in waitForInput. Returns false if the queue is full. Only the input thread may call it.*/
+bool pushInput(InputQueue& queue, const TimedEvent& input)
+{
+	unsigned int tail = queue.tail.load(std::memory_order_relaxed);
+	if (tail - queue.head.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE)
+		return false;
+	queue.events[tail & (INPUT_QUEUE_SIZE - 1)] = input;
+	queue.tail.store(tail + 1);
+	if (queue.sleeping.load()) {
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+		}
+		queue.pushed.notify_one();
+	}
+	return true;
+}
+
+/*This function reads the oldest event without removing it. Returns false if the queue is empty.
+Only the simulation thread may call it.*/
+bool peekInput(InputQueue& queue, TimedEvent& input)
+{
+	unsigned int head = queue.head.load(std::memory_order_relaxed);
+	if (head == queue.tail.load(std::memory_order_acquire))
+		return false;
+	input = queue.events[head & (INPUT_QUEUE_SIZE - 1)];
+	return true;
+}
+
+/*This function removes the oldest event, after it was read with peekInput.*/
+void popInput(InputQueue& queue)
+{
+	queue.head.store(queue.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/*This function sleeps until the queue holds an event. Only the simulation thread may call it. It
+and pushInput each write their own atomic then read the other's, sequentially consistent, so
+either this sees the event or the push sees it sleeping and wakes it (like waitForFrontSlot).*/
+void waitForInput(InputQueue& queue)
+{
+	std::unique_lock<std::mutex> lock(queue.mutex);
+	queue.sleeping.store(true);
+	while (queue.head.load(std::memory_order_relaxed) == queue.tail.load())
+		queue.pushed.wait(lock);
+	queue.sleeping.store(false);
+}
@@ -0,0 +1,48 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <mutex>
+
+const unsigned int INPUT_QUEUE_SIZE = 256;	// must be a power of two
+
+// Which keys are held, tracked from KeyPressed/KeyReleased events. The game loop copies it
+// once per tick so every system reads the same snapshot without querying the OS.
+struct KeyboardState {
+	std::bitset<sf::Keyboard::KeyCount> down;
+	std::bitset<sf::Keyboard::KeyCount> pressed;	// went down during the current tick
+};
+
+// A window event stamped with the time it was pulled from the OS, in microseconds.
+struct TimedEvent {
+	sf::Event event;
+	sf::Int64 time;
+};
+
+// Single producer (input thread), single consumer (simulation thread) ring buffer. The consumer
+// can sleep until the next event, see waitForInput; only then does a push take the mutex.
+struct InputQueue {
+	TimedEvent events[INPUT_QUEUE_SIZE];
+	std::atomic<unsigned int> head;	// next event to read, only written by the consumer
+	std::atomic<unsigned int> tail;	// next slot to write, only written by the producer
+	std::atomic<bool> sleeping;		// the consumer is in waitForInput
+	std::mutex mutex;				// only guards the sleep of the consumer
+	std::condition_variable pushed;
+};
+
+void updateKeyboardState(KeyboardState& keyboard, const sf::Event& event);
+void clearTickPresses(KeyboardState& keyboard);
+bool isKeyDown(const KeyboardState& keyboard, sf::Keyboard::Key key);
+bool wasKeyPressed(const sf::Event& event, sf::Keyboard::Key key);
+bool isGameEvent(const sf::Event& event);
+
+void initializeInputQueue(InputQueue& queue);
+bool pushInput(InputQueue& queue, const TimedEvent& input);
+bool peekInput(InputQueue& queue, TimedEvent& input);
+void popInput(InputQueue& queue);
+void waitForInput(InputQueue& queue);
+
+#endif
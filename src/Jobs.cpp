@@ -0,0 +1,101 @@
+#include "Jobs.h"
+#include <thread>
+
+/*This function runs jobs of the current batch until none is left to claim.*/
+static void runClaimedJobs(JobSystem& system, JobFunction function, void* data, int jobs)
+{
+	for (int job = system.nextJob.fetch_add(1); job < jobs; job = system.nextJob.fetch_add(1))
+	{
+		function(data, job);
+		system.finishedJobs.fetch_add(1);
+	}
+}
+
+/*This function is the loop of a worker: wait for a batch, help with its jobs, check out.*/
+static void runWorker(JobSystem* system)
+{
+	sf::Uint32 seen = 0;
+	for (;;)
+	{
+		std::unique_lock<std::mutex> lock(system->mutex);
+		while (system->running && system->batch == seen)
+			system->wake.wait(lock);
+		if (!system->running)
+			return;
+		seen = system->batch;
+		JobFunction function = system->function;
+		void* data = system->data;
+		int jobs = system->jobs;
+		lock.unlock();
+
+		runClaimedJobs(*system, function, data, jobs);
+		system->busyWorkers.fetch_sub(1);
+	}
+}
+
+/*This function starts a job system of some threads, the one calling runJobs included, so a
+system of 1 thread has no workers.*/
+void startJobSystem(JobSystem& system, int threads)
+{
+	system.batch = 0;
+	system.running = true;
+	system.function = NULL;
+	system.data = NULL;
+	system.jobs = 0;
+	system.nextJob = 0;
+	system.finishedJobs = 0;
+	system.busyWorkers = 0;
+	for (int i = 1; i < threads; ++i)
+	{
+		system.threads.push_back(new sf::Thread(&runWorker, &system));
+		system.threads.back()->launch();
+	}
+}
+
+void stopJobSystem(JobSystem& system)
+{
+	{
+		std::lock_guard<std::mutex> lock(system.mutex);
+		system.running = false;
+	}
+	system.wake.notify_all();
+	for (std::size_t i = 0; i < system.threads.size(); ++i)
+	{
+		system.threads[i]->wait();
+		delete system.threads[i];
+	}
+	system.threads.clear();
+}
+
+/*This function returns how many threads run the jobs of a batch, 1 without a system.*/
+int getJobThreads(const JobSystem* system)
+{
+	return system ? static_cast<int>(system->threads.size()) + 1 : 1;
+}
+
+/*This function runs jobs on the workers and on this thread, and returns once all of them are done
+and every worker has left the batch, so the next batch can't be mixed up with this one. Without
+a system (NULL) the jobs run here, in order.*/
+void runJobs(JobSystem* system, JobFunction function, void* data, int jobs)
+{
+	if (!system || system->threads.empty()) {
+		for (int job = 0; job < jobs; ++job)
+			function(data, job);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(system->mutex);
+		system->function = function;
+		system->data = data;
+		system->jobs = jobs;
+		system->nextJob = 0;
+		system->finishedJobs = 0;
+		system->busyWorkers = static_cast<int>(system->threads.size());
+		system->batch++;
+	}
+	system->wake.notify_all();
+	runClaimedJobs(*system, function, data, jobs);
+	while (system->finishedJobs.load() < jobs || system->busyWorkers.load() > 0)
+		std::this_thread::yield();
+}
@@ -0,0 +1,35 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <SFML/System.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// Runs job (0 to jobs - 1) of a batch, with the data the batch was started with.
+typedef void (*JobFunction)(void* data, int job);
+
+// Worker threads that run the jobs of one batch at a time, next to the thread that starts it.
+// Jobs are claimed one by one from a shared counter, so a slow job does not hold back the
+// others, and which thread ran a job is never part of its result.
+struct JobSystem {
+	std::vector<sf::Thread*> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	sf::Uint32 batch;			// bumped when a batch starts, guarded by mutex
+	bool running;				// guarded by mutex
+	JobFunction function;
+	void* data;
+	int jobs;
+	std::atomic<int> nextJob;
+	std::atomic<int> finishedJobs;
+	std::atomic<int> busyWorkers;	// workers still on the current batch
+};
+
+void startJobSystem(JobSystem& system, int threads);
+void stopJobSystem(JobSystem& system);
+int getJobThreads(const JobSystem* system);
+void runJobs(JobSystem* system, JobFunction function, void* data, int jobs);
+
+#endif
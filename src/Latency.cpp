@@ -0,0 +1,121 @@
+#include "Latency.h"
+
+static const char* INPUT_TYPE_NAMES[INPUT_TYPE_COUNT] = { "move", "fire", "menu" };
+
+static void addSample(LatencyHistogram& histogram, sf::Int64 latency)
+{
+	int bucket = static_cast<int>(latency / LATENCY_BUCKET_MICROSECONDS);
+	if (bucket >= LATENCY_BUCKETS)
+		bucket = LATENCY_BUCKETS - 1;
+	if (bucket < 0)
+		bucket = 0;
+	histogram.buckets[bucket]++;
+	histogram.count++;
+	histogram.total += latency;
+	if (latency > histogram.max)
+		histogram.max = latency;
+}
+
+static void printHistogram(const char* name, const LatencyHistogram& histogram, std::ostream& out)
+{
+	if (histogram.count == 0)
+		return;
+	out << name << ": " << histogram.count << " inputs, mean " << histogram.total / histogram.count / 1000.0
+		<< "ms, p50 <" << getLatencyPercentile(histogram, 0.5f) / 1000.0
+		<< "ms, p99 <" << getLatencyPercentile(histogram, 0.99f) / 1000.0
+		<< "ms, max " << histogram.max / 1000.0 << "ms" << std::endl;
+
+	for (int i = 0; i < LATENCY_BUCKETS; ++i)
+	{
+		if (histogram.buckets[i] == 0)
+			continue;
+		out << "\t" << i * LATENCY_BUCKET_MICROSECONDS / 1000 << "-";
+		if (i == LATENCY_BUCKETS - 1)
+			out << "inf";
+		else
+			out << (i + 1) * LATENCY_BUCKET_MICROSECONDS / 1000;
+		out << "ms\t" << histogram.buckets[i] << std::endl;
+	}
+}
+
+/*This function clears all histograms. Without a display, inputs are only timed to the end of
+their tick.*/
+void initializeLatencyStats(LatencyStats& stats, bool displayed)
+{
+	for (int i = 0; i < INPUT_TYPE_COUNT; ++i)
+	{
+		stats.inputToSim[i] = LatencyHistogram();
+		stats.inputToPhoton[i] = LatencyHistogram();
+	}
+	stats.pending.clear();
+	stats.pending.reserve(64);
+	stats.displayed = displayed;
+}
+
+/*This function is called when the simulation applies an input at the start of a tick.*/
+void recordInputApplied(LatencyStats& stats, inputType type, sf::Int64 inputTime)
+{
+	InputStamp stamp;
+	stamp.type = type;
+	stamp.inputTime = inputTime;
+	stamp.simTime = 0;
+	stats.pending.push_back(stamp);
+}
+
+/*This function is called when a tick is done: its inputs are now part of the world state.*/
+void recordTickFinished(LatencyStats& stats, sf::Int64 time)
+{
+	for (std::vector<InputStamp>::iterator it = stats.pending.begin(); it != stats.pending.end(); ++it)
+	{
+		if (it->simTime != 0)
+			continue;
+		it->simTime = time;
+		addSample(stats.inputToSim[it->type], time - it->inputTime);
+	}
+	if (!stats.displayed)
+		stats.pending.clear();	// no frame will ever take them
+}
+
+/*This function is called when window.display() returns with a frame published at frameTime:
+every input whose tick finished before is now visible. Later ones wait for a later frame.*/
+void recordFrameDisplayed(LatencyStats& stats, sf::Int64 frameTime, sf::Int64 time)
+{
+	std::vector<InputStamp>::iterator it = stats.pending.begin();
+	while (it != stats.pending.end())
+	{
+		if (it->simTime == 0 || it->simTime > frameTime) {
+			++it;
+			continue;
+		}
+		addSample(stats.inputToPhoton[it->type], time - it->inputTime);
+		it = stats.pending.erase(it);
+	}
+}
+
+/*This function returns the upper bound of the bucket holding the given percentile.*/
+sf::Int64 getLatencyPercentile(const LatencyHistogram& histogram, float percentile)
+{
+	unsigned int target = static_cast<unsigned int>(histogram.count * percentile);
+	unsigned int seen = 0;
+	for (int i = 0; i < LATENCY_BUCKETS - 1; ++i)
+	{
+		seen += histogram.buckets[i];
+		if (seen > target)
+			return (i + 1) * LATENCY_BUCKET_MICROSECONDS;
+	}
+	return histogram.max;
+}
+
+/*This function prints one histogram per input type.*/
+void printLatencyReport(const LatencyStats& stats, std::ostream& out, bool includePhoton)
+{
+	out << "INPUT TO SIMULATION" << std::endl;
+	for (int i = 0; i < INPUT_TYPE_COUNT; ++i)
+		printHistogram(INPUT_TYPE_NAMES[i], stats.inputToSim[i], out);
+
+	if (!includePhoton)
+		return;
+	out << "INPUT TO PHOTON" << std::endl;
+	for (int i = 0; i < INPUT_TYPE_COUNT; ++i)
+		printHistogram(INPUT_TYPE_NAMES[i], stats.inputToPhoton[i], out);
+}
@@ -0,0 +1,47 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <SFML/System.hpp>
+#include <ostream>
+#include <vector>
+
+const int LATENCY_BUCKETS = 40;
+const sf::Int64 LATENCY_BUCKET_MICROSECONDS = 2000;	// 0-80ms, the last bucket holds everything slower
+
+enum inputType {
+	moveInput,
+	fireInput,
+	menuInput,
+	INPUT_TYPE_COUNT
+};
+
+struct LatencyHistogram {
+	unsigned int buckets[LATENCY_BUCKETS];
+	unsigned int count;
+	sf::Int64 total;
+	sf::Int64 max;
+};
+
+// An input applied by the simulation that has not reached the screen yet.
+struct InputStamp {
+	inputType type;
+	sf::Int64 inputTime;	// when the event was pulled from the OS
+	sf::Int64 simTime;		// when the tick that applied it finished, 0 while that tick runs
+};
+
+// All times are microseconds on the input clock.
+struct LatencyStats {
+	LatencyHistogram inputToSim[INPUT_TYPE_COUNT];
+	LatencyHistogram inputToPhoton[INPUT_TYPE_COUNT];
+	std::vector<InputStamp> pending;
+	bool displayed;		// frames reach a screen, stamps wait for them in pending
+};
+
+void initializeLatencyStats(LatencyStats& stats, bool displayed);
+void recordInputApplied(LatencyStats& stats, inputType type, sf::Int64 inputTime);
+void recordTickFinished(LatencyStats& stats, sf::Int64 time);
+void recordFrameDisplayed(LatencyStats& stats, sf::Int64 frameTime, sf::Int64 time);
+sf::Int64 getLatencyPercentile(const LatencyHistogram& histogram, float percentile);
+void printLatencyReport(const LatencyStats& stats, std::ostream& out, bool includePhoton);
+
+#endif
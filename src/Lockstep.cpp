@@ -0,0 +1,197 @@
+#include "Lockstep.h"
+#include <iostream>
+#include <sstream>
+#include "StateHash.h"
+
+static void writeUint32(sf::Uint8* buffer, sf::Uint32 value)
+{
+	buffer[0] = static_cast<sf::Uint8>(value >> 24);
+	buffer[1] = static_cast<sf::Uint8>(value >> 16);
+	buffer[2] = static_cast<sf::Uint8>(value >> 8);
+	buffer[3] = static_cast<sf::Uint8>(value);
+}
+
+static sf::Uint32 readUint32(const sf::Uint8* buffer)
+{
+	return (static_cast<sf::Uint32>(buffer[0]) << 24) | (static_cast<sf::Uint32>(buffer[1]) << 16)
+		| (static_cast<sf::Uint32>(buffer[2]) << 8) | static_cast<sf::Uint32>(buffer[3]);
+}
+
+/*This function binds the local port and prepares an empty session. The first inputDelay ticks
+of the local player have no input. conditions is NULL unless testing over a simulated network.*/
+bool startLockstep(LockstepSession& session, int localPlayer, unsigned short localPort,
+	const sf::IpAddress& remoteAddress, unsigned short remotePort, int inputDelay, const NetworkConditions* conditions)
+{
+	if (session.socket.bind(localPort) != sf::Socket::Done) {
+		std::cout << "Could not bind UDP port " << localPort << std::endl;
+		return false;
+	}
+	session.socket.setBlocking(false);
+	startShim(session.shim, session.socket, conditions);
+	session.remoteAddress = remoteAddress;
+	session.remotePort = remotePort;
+	session.localPlayer = localPlayer;
+	session.inputDelay = inputDelay < 0 ? 0 : (inputDelay > MAX_INPUT_DELAY ? MAX_INPUT_DELAY : inputDelay);
+	session.tick = 0;
+	session.localKnown = session.inputDelay;
+	session.remoteKnown = 0;
+	session.remoteAcked = 0;
+	for (int i = 0; i < LOCKSTEP_HISTORY; ++i) {
+		session.localInputs[i] = 0;
+		session.remoteInputs[i] = 0;
+		session.localHashTicks[i] = NO_TICK;
+		session.remoteHashTicks[i] = NO_TICK;
+	}
+	for (int i = 0; i < DESYNC_SAVES; ++i)
+		session.savedTicks[i] = NO_TICK;
+	session.hashedTick = NO_TICK;
+	session.checkedHashes = 0;
+	session.desyncTick = NO_TICK;
+	session.bytesSent = 0;
+	session.packetsSent = 0;
+	session.packetsReceived = 0;
+	return true;
+}
+
+/*This function compares both peers' hashes of the state after a tick, once both are known. The
+first difference is reported, and the state saved after that tick is written to
+desync-player<N>-tick<T>.txt. Each packet carries the hash of the sender's newest tick, so both
+peers compare about every tick and find the same first one unless packets were lost: their dumps
+are of the tick the states parted on, and diff against each other.*/
+static void compareHashes(LockstepSession& session, sf::Uint32 tick)
+{
+	int slot = tick & (LOCKSTEP_HISTORY - 1);
+	if (session.localHashTicks[slot] != tick || session.remoteHashTicks[slot] != tick)
+		return;
+	session.checkedHashes++;
+	if (session.localHashes[slot] == session.remoteHashes[slot] || session.desyncTick != NO_TICK)
+		return;
+
+	session.desyncTick = tick;
+	std::cout << "Desync: player " << session.localPlayer << " differs from the other peer after tick " << tick << std::endl;
+
+	int save = tick & (DESYNC_SAVES - 1);
+	if (session.savedTicks[save] != tick) {
+		std::cout << "The state of that tick is no longer saved, nothing was written" << std::endl;
+		return;
+	}
+	std::ostringstream path;
+	path << "desync-player" << session.localPlayer << "-tick" << tick << ".txt";
+	if (dumpMatchState(session.saved[save], path.str()))
+		std::cout << "State written to " << path.str() << ", diff it with the other peer's" << std::endl;
+}
+
+/*This function reads every pending packet from the remote peer. A packet carries a run of the
+sender's inputs starting at some tick, and how many of our inputs the sender already has.*/
+void receiveInputs(LockstepSession& session)
+{
+	sf::Uint8 buffer[LOCKSTEP_HEADER_SIZE + MAX_INPUTS_PER_PACKET];
+	std::size_t received;
+	sf::IpAddress sender;
+	unsigned short senderPort;
+
+	while (shimReceive(session.shim, buffer, sizeof(buffer), received, sender, senderPort) == sf::Socket::Done)
+	{
+		if (sender != session.remoteAddress || senderPort != session.remotePort || received < LOCKSTEP_HEADER_SIZE)
+			continue;
+		session.packetsReceived++;
+
+		sf::Uint32 ack = readUint32(buffer);
+		sf::Uint32 firstTick = readUint32(buffer + 4);
+		sf::Uint32 count = buffer[8];
+		if (count > received - LOCKSTEP_HEADER_SIZE)
+			continue;
+
+		if (ack > session.remoteAcked && ack <= session.localKnown)
+			session.remoteAcked = ack;
+
+		sf::Uint32 hashedTick = readUint32(buffer + 9);
+		if (hashedTick != NO_TICK)
+		{
+			int slot = hashedTick & (LOCKSTEP_HISTORY - 1);
+			session.remoteHashes[slot] = (static_cast<sf::Uint64>(readUint32(buffer + 13)) << 32) | readUint32(buffer + 17);
+			session.remoteHashTicks[slot] = hashedTick;
+			compareHashes(session, hashedTick);
+		}
+
+		// Inputs are sent as contiguous runs, so only a run that reaches our gap is useful
+		if (firstTick > session.remoteKnown)
+			continue;
+		for (sf::Uint32 i = 0; i < count; ++i)
+		{
+			sf::Uint32 tick = firstTick + i;
+			if (tick < session.remoteKnown)
+				continue;
+			if (tick >= session.tick + LOCKSTEP_HISTORY)
+				break;
+			session.remoteInputs[tick & (LOCKSTEP_HISTORY - 1)] = buffer[LOCKSTEP_HEADER_SIZE + i];
+			session.remoteKnown = tick + 1;
+		}
+	}
+}
+
+/*This function sends every local input the remote peer has not acknowledged yet. Resending the
+whole run each time means a lost packet is repaired by the next one.*/
+void sendInputs(LockstepSession& session)
+{
+	sf::Uint8 buffer[LOCKSTEP_HEADER_SIZE + MAX_INPUTS_PER_PACKET];
+	sf::Uint32 firstTick = session.remoteAcked;
+	sf::Uint32 count = session.localKnown - firstTick;
+	if (count > MAX_INPUTS_PER_PACKET)
+		count = MAX_INPUTS_PER_PACKET;
+
+	writeUint32(buffer, session.remoteKnown);
+	writeUint32(buffer + 4, firstTick);
+	buffer[8] = static_cast<sf::Uint8>(count);
+	sf::Uint64 hash = (session.hashedTick != NO_TICK) ? session.localHashes[session.hashedTick & (LOCKSTEP_HISTORY - 1)] : 0;
+	writeUint32(buffer + 9, session.hashedTick);
+	writeUint32(buffer + 13, static_cast<sf::Uint32>(hash >> 32));
+	writeUint32(buffer + 17, static_cast<sf::Uint32>(hash));
+	for (sf::Uint32 i = 0; i < count; ++i)
+		buffer[LOCKSTEP_HEADER_SIZE + i] = session.localInputs[(firstTick + i) & (LOCKSTEP_HISTORY - 1)];
+
+	std::size_t size = LOCKSTEP_HEADER_SIZE + count;
+	shimSend(session.shim, buffer, size, session.remoteAddress, session.remotePort);
+	session.bytesSent += size;
+	session.packetsSent++;
+}
+
+/*This function checks if both inputs of the next tick are known.*/
+bool isTickReady(const LockstepSession& session)
+{
+	return session.remoteKnown > session.tick;
+}
+
+/*This function records the local input sampled this tick (it will be used inputDelay ticks from
+now), sends it, and returns both players' inputs for the tick being simulated.
+Only call it when isTickReady.*/
+void advanceLockstep(LockstepSession& session, sf::Uint8 localInput, sf::Uint8& input1, sf::Uint8& input2)
+{
+	session.localInputs[session.localKnown & (LOCKSTEP_HISTORY - 1)] = localInput;
+	session.localKnown++;
+	sendInputs(session);
+
+	sf::Uint8 local = session.localInputs[session.tick & (LOCKSTEP_HISTORY - 1)];
+	sf::Uint8 remote = session.remoteInputs[session.tick & (LOCKSTEP_HISTORY - 1)];
+	input1 = (session.localPlayer == 1) ? local : remote;
+	input2 = (session.localPlayer == 1) ? remote : local;
+	session.tick++;
+}
+
+/*This function hashes the state after a tick, for the next packets to carry and to compare with
+the other peer's, and saves it until a desync would need it dumped. Call it for every simulated
+tick, in order (with rollback, for every confirmed tick). Saves reuse their storage, so past the
+first DESYNC_SAVES ticks it never allocates.*/
+void recordState(LockstepSession& session, sf::Uint32 tick, const Match& match)
+{
+	int slot = tick & (LOCKSTEP_HISTORY - 1);
+	session.localHashes[slot] = hashMatch(match);
+	session.localHashTicks[slot] = tick;
+	session.hashedTick = tick;
+	if (session.desyncTick == NO_TICK) {
+		int save = tick & (DESYNC_SAVES - 1);
+		session.saved[save] = match;
+		session.savedTicks[save] = tick;
+	}
+	compareHashes(session, tick);
+}
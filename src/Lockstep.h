@@ -0,0 +1,54 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <SFML/Network.hpp>
+#include "NetworkShim.h"
+#include "Simulation.h"
+
+const int LOCKSTEP_HISTORY = 256;		// ticks of input kept on each side, must be a power of two
+const int MAX_INPUT_DELAY = 60;
+const int MAX_INPUTS_PER_PACKET = 64;
+const int LOCKSTEP_HEADER_SIZE = 21;	// ack (4), first tick (4), input count (1), hashed tick (4), state hash (8)
+const sf::Uint32 NO_TICK = 0xFFFFFFFF;
+const int DESYNC_SAVES = 64;			// states of the newest ticks kept to dump the one a desync is found on, a power of two
+
+// Two peers that only exchange one input byte per player per tick and simulate a tick once both
+// inputs for it are known. A local input sampled at tick t is used at tick t + inputDelay, which
+// gives it time to reach the other peer before it is needed. Every packet also carries the hash of
+// the sender's newest state, so a peer that drifts apart is caught on the tick it happened.
+struct LockstepSession {
+	sf::UdpSocket socket;
+	NetworkShim shim;				// every packet goes through it, to test over a bad network
+	sf::IpAddress remoteAddress;
+	unsigned short remotePort;
+	int localPlayer;				// 1 or 2
+	int inputDelay;
+	sf::Uint32 tick;				// next tick to simulate
+	sf::Uint32 localKnown;			// local inputs are known for all ticks before this one
+	sf::Uint32 remoteKnown;			// remote inputs are known for all ticks before this one
+	sf::Uint32 remoteAcked;			// the remote peer has our inputs for all ticks before this one
+	sf::Uint8 localInputs[LOCKSTEP_HISTORY];
+	sf::Uint8 remoteInputs[LOCKSTEP_HISTORY];
+	sf::Uint32 hashedTick;			// newest tick whose state was hashed here, NO_TICK for none
+	sf::Uint64 localHashes[LOCKSTEP_HISTORY];	// state after each tick, by tick
+	sf::Uint32 localHashTicks[LOCKSTEP_HISTORY];
+	sf::Uint64 remoteHashes[LOCKSTEP_HISTORY];
+	sf::Uint32 remoteHashTicks[LOCKSTEP_HISTORY];
+	sf::Uint32 checkedHashes;
+	sf::Uint32 desyncTick;			// first tick the states differed on, NO_TICK if they never did
+	Match saved[DESYNC_SAVES];		// state after each of the newest ticks, by tick
+	sf::Uint32 savedTicks[DESYNC_SAVES];
+	sf::Uint64 bytesSent;
+	sf::Uint32 packetsSent;
+	sf::Uint32 packetsReceived;		// from the other peer, 0 until it has started
+};
+
+bool startLockstep(LockstepSession& session, int localPlayer, unsigned short localPort,
+	const sf::IpAddress& remoteAddress, unsigned short remotePort, int inputDelay, const NetworkConditions* conditions);
+void receiveInputs(LockstepSession& session);
+void sendInputs(LockstepSession& session);
+bool isTickReady(const LockstepSession& session);
+void advanceLockstep(LockstepSession& session, sf::Uint8 localInput, sf::Uint8& input1, sf::Uint8& input2);
+void recordState(LockstepSession& session, sf::Uint32 tick, const Match& match);
+
+#endif
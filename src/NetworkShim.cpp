@@ -0,0 +1,96 @@
+#include "NetworkShim.h"
+#include <algorithm>
+#include <cstring>
+
+/*This function returns a number between 0 and 1 from the shim's own generator (a plain LCG), so
+runs with the same seed treat the same packets the same way.*/
+static float nextChance(NetworkShim& shim)
+{
+	shim.random = shim.random * 1664525u + 1013904223u;
+	return (shim.random >> 8) / 16777216.f;
+}
+
+/*This function queues one copy of a packet to be sent after the latency, some jitter and maybe
+the reordering delay. The queue stays sorted by send time, a packet goes after those due at the
+same time, so without jitter or reordering packets leave in the order they were sent.*/
+static void delayPacket(NetworkShim& shim, const void* data, std::size_t size, const sf::IpAddress& address, unsigned short port)
+{
+	sf::Int64 delay = shim.conditions.latencyMs * 1000 + static_cast<sf::Int64>(nextChance(shim) * shim.conditions.jitterMs * 1000);
+	if (nextChance(shim) < shim.conditions.reordering)
+		delay += SHIM_REORDER_DELAY_MS * 1000;
+	sf::Int64 sendTime = shim.clock.getElapsedTime().asMicroseconds() + delay;
+
+	std::size_t place = shim.pending.size();
+	while (place > 0 && shim.pending[place - 1].sendTime > sendTime)
+		--place;
+	shim.pending.insert(shim.pending.begin() + place, DelayedPacket());
+	DelayedPacket& packet = shim.pending[place];
+	packet.sendTime = sendTime;
+	packet.sequence = shim.queued++;
+	std::memcpy(packet.data, data, size);
+	packet.size = size;
+	packet.address = address;
+	packet.port = port;
+}
+
+/*This function attaches a shim to a socket. conditions may be NULL for a plain socket.*/
+void startShim(NetworkShim& shim, sf::UdpSocket& socket, const NetworkConditions* conditions)
+{
+	shim.socket = &socket;
+	shim.enabled = (conditions != NULL);
+	if (conditions)
+		shim.conditions = *conditions;
+	shim.random = conditions ? conditions->seed : 0;
+	shim.clock.restart();
+	shim.pending.clear();
+	shim.queued = 0;
+	shim.nextInOrder = 0;
+	shim.dropped = 0;
+	shim.duplicated = 0;
+	shim.reordered = 0;
+}
+
+/*This function sends a packet through the bad network: it may be dropped, duplicated or held back.*/
+void shimSend(NetworkShim& shim, const void* data, std::size_t size, const sf::IpAddress& address, unsigned short port)
+{
+	if (!shim.enabled || size > SHIM_MAX_PACKET) {
+		shim.socket->send(data, size, address, port);
+		return;
+	}
+
+	if (nextChance(shim) < shim.conditions.loss) {
+		shim.dropped++;
+		return;
+	}
+	delayPacket(shim, data, size, address, port);
+	if (nextChance(shim) < shim.conditions.duplication) {
+		delayPacket(shim, data, size, address, port);
+		shim.duplicated++;
+	}
+	flushShim(shim);
+}
+
+/*This function sends the held back packets that are due, then receives like sf::UdpSocket::receive.*/
+sf::Socket::Status shimReceive(NetworkShim& shim, void* data, std::size_t capacity, std::size_t& received,
+	sf::IpAddress& sender, unsigned short& senderPort)
+{
+	flushShim(shim);
+	return shim.socket->receive(data, capacity, received, sender, senderPort);
+}
+
+/*This function sends the held back packets that are due, in the order they are due, and counts
+those that leave after a packet queued later.*/
+void flushShim(NetworkShim& shim)
+{
+	sf::Int64 now = shim.clock.getElapsedTime().asMicroseconds();
+	std::size_t due = 0;
+	for (; due < shim.pending.size() && shim.pending[due].sendTime <= now; ++due)
+	{
+		const DelayedPacket& packet = shim.pending[due];
+		shim.socket->send(packet.data, packet.size, packet.address, packet.port);
+		if (packet.sequence < shim.nextInOrder)
+			shim.reordered++;
+		shim.nextInOrder = std::max(shim.nextInOrder, packet.sequence + 1);
+	}
+	shim.pending.erase(shim.pending.begin(), shim.pending.begin() + due);
+}
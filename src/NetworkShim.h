@@ -0,0 +1,50 @@
+#ifndef NETWORK_SHIM_H
+#define NETWORK_SHIM_H
+
+#include <SFML/Network.hpp>
+#include <vector>
+
+const int SHIM_MAX_PACKET = 512;		// bigger packets are sent right away, game packets are far smaller
+const int SHIM_REORDER_DELAY_MS = 20;	// extra delay of a packet picked to arrive out of order
+
+// Bad network to play over, applied to the packets a peer sends. Probabilities are 0 to 1.
+struct NetworkConditions {
+	int latencyMs;
+	int jitterMs;			// each packet gets 0 to jitterMs more
+	float loss;
+	float duplication;
+	float reordering;
+	sf::Uint32 seed;		// the same seed drops, delays and duplicates the same packets
+};
+
+struct DelayedPacket {
+	sf::Int64 sendTime;		// microseconds on the shim clock
+	sf::Uint32 sequence;	// order it was queued in
+	sf::Uint8 data[SHIM_MAX_PACKET];
+	std::size_t size;
+	sf::IpAddress address;
+	unsigned short port;
+};
+
+// Sits between a peer and its socket. Without conditions it only forwards.
+struct NetworkShim {
+	sf::UdpSocket* socket;
+	bool enabled;
+	NetworkConditions conditions;
+	sf::Uint32 random;
+	sf::Clock clock;
+	std::vector<DelayedPacket> pending;	// by sendTime, in queue order when equal
+	sf::Uint32 queued;		// sequence of the next packet queued
+	sf::Uint32 nextInOrder;	// sequence after the latest one sent
+	sf::Uint32 dropped;
+	sf::Uint32 duplicated;
+	sf::Uint32 reordered;	// packets sent after one queued later than them
+};
+
+void startShim(NetworkShim& shim, sf::UdpSocket& socket, const NetworkConditions* conditions);
+void shimSend(NetworkShim& shim, const void* data, std::size_t size, const sf::IpAddress& address, unsigned short port);
+sf::Socket::Status shimReceive(NetworkShim& shim, void* data, std::size_t capacity, std::size_t& received,
+	sf::IpAddress& sender, unsigned short& senderPort);
+void flushShim(NetworkShim& shim);
+
+#endif
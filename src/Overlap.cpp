@@ -2,9 +2,11 @@
 
 bool overlap(sf::Sprite& sprite1, sf::Sprite& sprite2)
 {
-	sf::FloatRect rectangle1 = sprite1.getGlobalBounds();
-	sf::FloatRect rectangle2 = sprite2.getGlobalBounds();
+	return overlap(sprite1.getGlobalBounds(), sprite2.getGlobalBounds());
+}
 
+bool overlap(const sf::FloatRect& rectangle1, const sf::FloatRect& rectangle2)
+{
 	// Rectangles with negative dimensions are allowed, so we must handle them correctly
 	// Compute the min and max of the first rectangle on both axes
 	float r1MinX = std::min(rectangle1.left, rectangle1.left + rectangle1.width);
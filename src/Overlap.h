@@ -4,5 +4,6 @@
 #include <SFML/Graphics.hpp>
 
 bool overlap(sf::Sprite& sprite1, sf::Sprite& sprite2);
+bool overlap(const sf::FloatRect& rectangle1, const sf::FloatRect& rectangle2);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,494 @@
+#include "Pattern.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// How the operands of an instruction are written, see assemblePatterns.
+enum operandForm {
+	formMove,	// d b
+	formBinary,	// d a b
+	formUnary,	// d a
+	formSelect,	// d a b c
+	formKill,	// a
+	formEmit	// a b c script
+};
+
+struct OpcodeName {
+	const char* name;
+	patternOpcode opcode;
+	operandForm form;
+};
+
+const OpcodeName OPCODE_NAMES[] = {
+	{ "mov", opMove, formMove },
+	{ "add", opAdd, formBinary },
+	{ "sub", opSubtract, formBinary },
+	{ "mul", opMultiply, formBinary },
+	{ "div", opDivide, formBinary },
+	{ "min", opMinimum, formBinary },
+	{ "max", opMaximum, formBinary },
+	{ "lt", opLess, formBinary },
+	{ "eq", opEqual, formBinary },
+	{ "sin", opSine, formUnary },
+	{ "cos", opCosine, formUnary },
+	{ "sel", opSelect, formSelect },
+	{ "kill", opKill, formKill },
+	{ "emit", opEmit, formEmit }
+};
+const int OPCODE_NAME_COUNT = sizeof(OPCODE_NAMES) / sizeof(OPCODE_NAMES[0]);
+const int FORM_WORDS[] = { 3, 4, 3, 5, 2, 5 };	/* by operandForm, the opcode included */
+const char* const REGISTER_NAMES[FIRST_FREE_REGISTER] = { "x", "y", "vx", "vy", "age", "p" };
+
+/*This function reads a register, by the name of its role or as r0 to r15.*/
+static bool parseRegister(const std::string& word, sf::Uint8& reg)
+{
+	for (int i = 0; i < FIRST_FREE_REGISTER; ++i)
+	{
+		if (word == REGISTER_NAMES[i]) {
+			reg = static_cast<sf::Uint8>(i);
+			return true;
+		}
+	}
+	if (word.size() < 2 || word.size() > 3 || word[0] != 'r')
+		return false;
+	int index = 0;
+	for (std::size_t i = 1; i < word.size(); ++i)
+	{
+		if (word[i] < '0' || word[i] > '9')
+			return false;
+		index = index * 10 + (word[i] - '0');
+	}
+	if (index >= PATTERN_REGISTERS)
+		return false;
+	reg = static_cast<sf::Uint8>(index);
+	return true;
+}
+
+static bool parseNumber(const std::string& word, float& value)
+{
+	char* end = NULL;
+	value = static_cast<float>(std::strtod(word.c_str(), &end));
+	return !word.empty() && *end == '\0';
+}
+
+/*This function reads the b operand of an instruction: a register, or a number added to the
+constants of the script if the opcode takes one.*/
+static bool parseOperandB(const std::string& word, bool constantAllowed, PatternScript& script, PatternInstruction& instruction)
+{
+	instruction.constantB = false;
+	if (parseRegister(word, instruction.b))
+		return true;
+	float value;
+	if (!constantAllowed || !parseNumber(word, value))
+		return false;
+	std::vector<float>::iterator found = std::find(script.constants.begin(), script.constants.end(), value);
+	if (found == script.constants.end()) {
+		if (static_cast<int>(script.constants.size()) >= MAX_PATTERN_CONSTANTS)
+			return false;
+		found = script.constants.insert(script.constants.end(), value);
+	}
+	instruction.b = static_cast<sf::Uint8>(found - script.constants.begin());
+	instruction.constantB = true;
+	return true;
+}
+
+/*This function assembles one instruction from its words. emit leaves the name of its script in
+target, it is looked up once every pattern is known.*/
+static bool assembleInstruction(const std::vector<std::string>& words, PatternScript& script, std::string& target, std::ostream& errors)
+{
+	int name = 0;
+	while (name < OPCODE_NAME_COUNT && words[0] != OPCODE_NAMES[name].name)
+		name++;
+	if (name == OPCODE_NAME_COUNT) {
+		errors << "unknown instruction " << words[0];
+		return false;
+	}
+	operandForm form = OPCODE_NAMES[name].form;
+	if (static_cast<int>(words.size()) != FORM_WORDS[form]) {
+		errors << words[0] << " takes " << FORM_WORDS[form] - 1 << " operands";
+		return false;
+	}
+
+	PatternInstruction instruction = { static_cast<sf::Uint8>(OPCODE_NAMES[name].opcode), 0, 0, 0, 0, false };
+	bool valid = true;
+	switch (form)
+	{
+	case formMove:
+		valid = parseRegister(words[1], instruction.d) && parseOperandB(words[2], true, script, instruction);
+		break;
+	case formBinary:
+		valid = parseRegister(words[1], instruction.d) && parseRegister(words[2], instruction.a)
+			&& parseOperandB(words[3], true, script, instruction);
+		break;
+	case formUnary:
+		valid = parseRegister(words[1], instruction.d) && parseRegister(words[2], instruction.a);
+		break;
+	case formSelect:
+		valid = parseRegister(words[1], instruction.d) && parseRegister(words[2], instruction.a)
+			&& parseOperandB(words[3], false, script, instruction) && parseRegister(words[4], instruction.c);
+		break;
+	case formKill:
+		valid = parseRegister(words[1], instruction.a);
+		break;
+	case formEmit:
+		valid = parseRegister(words[1], instruction.a) && parseOperandB(words[2], false, script, instruction)
+			&& parseRegister(words[3], instruction.c);
+		target = words[4];
+		break;
+	}
+	if (!valid) {
+		errors << "bad operands for " << words[0] << " (registers are x y vx vy age p r0-r15, numbers only as the last operand of mov and arithmetic)";
+		return false;
+	}
+	script.code.push_back(instruction);
+	return true;
+}
+
+/*This function assembles pattern scripts from text, replacing those of the library. A script is
+"pattern <name>", one instruction per line (see patternOpcode, written in lower case: mov add sub
+mul div min max lt eq sin cos sel kill emit), then "end"; "#" starts a comment. Every error is
+written to errors, with its line, and the library is only valid if none was found.*/
+bool assemblePatterns(const std::string& text, PatternLibrary& library, std::ostream& errors)
+{
+	library.scripts.clear();
+	std::vector<std::vector<std::string> > targets;	// of the emits of each script, by instruction
+	std::vector<std::vector<int> > targetLines;
+	std::istringstream lines(text);
+	std::string line;
+	int lineNumber = 0;
+	int current = -1;	// script being assembled
+	bool valid = true;
+
+	while (std::getline(lines, line))
+	{
+		lineNumber++;
+		std::istringstream stream(line.substr(0, line.find('#')));
+		std::vector<std::string> words;
+		std::string word;
+		while (stream >> word)
+			words.push_back(word);
+		if (words.empty())
+			continue;
+
+		std::ostringstream error;
+		if (words[0] == "pattern") {
+			if (current >= 0)
+				error << "pattern " << library.scripts[current].name << " has no end";
+			else if (words.size() != 2)
+				error << "pattern takes a name";
+			else if (findPattern(library, words[1]) >= 0)
+				error << "there is a pattern " << words[1] << " already";
+			else if (static_cast<int>(library.scripts.size()) >= MAX_PATTERN_SCRIPTS)
+				error << "more than " << MAX_PATTERN_SCRIPTS << " patterns";
+			else {
+				current = static_cast<int>(library.scripts.size());
+				library.scripts.push_back(PatternScript());
+				library.scripts[current].name = words[1];
+				targets.push_back(std::vector<std::string>());
+				targetLines.push_back(std::vector<int>());
+			}
+		}
+		else if (words[0] == "end") {
+			if (current < 0)
+				error << "end without a pattern";
+			current = -1;
+		}
+		else if (current < 0)
+			error << "instruction outside a pattern";
+		else {
+			std::string target;
+			if (assembleInstruction(words, library.scripts[current], target, error)) {
+				targets[current].push_back(target);
+				targetLines[current].push_back(lineNumber);
+			}
+		}
+		if (!error.str().empty()) {
+			errors << "line " << lineNumber << ": " << error.str() << std::endl;
+			valid = false;
+		}
+	}
+	if (current >= 0) {
+		errors << "pattern " << library.scripts[current].name << " has no end" << std::endl;
+		valid = false;
+	}
+
+	for (std::size_t script = 0; script < library.scripts.size(); ++script)
+	{
+		for (std::size_t i = 0; i < library.scripts[script].code.size(); ++i)
+		{
+			PatternInstruction& instruction = library.scripts[script].code[i];
+			if (instruction.opcode != opEmit)
+				continue;
+			int target = findPattern(library, targets[script][i]);
+			if (target < 0) {
+				errors << "line " << targetLines[script][i] << ": there is no pattern " << targets[script][i] << std::endl;
+				valid = false;
+			}
+			instruction.d = static_cast<sf::Uint8>(target);
+		}
+	}
+	return valid;
+}
+
+/*This function assembles the pattern scripts of a file, see assemblePatterns.*/
+bool loadPatterns(const std::string& path, PatternLibrary& library, std::ostream& errors)
+{
+	std::ifstream file(path.c_str());
+	if (!file) {
+		library.scripts.clear();
+		errors << "can't open " << path << std::endl;
+		return false;
+	}
+	std::ostringstream text;
+	text << file.rdbuf();
+	return assemblePatterns(text.str(), library, errors);
+}
+
+/*This function returns the index of the script of a name, or -1.*/
+int findPattern(const PatternLibrary& library, const std::string& name)
+{
+	for (std::size_t i = 0; i < library.scripts.size(); ++i)
+	{
+		if (library.scripts[i].name == name)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+/*This function allocates room for capacity bullets of every script of a library, and for as
+many spawns per tick. A NULL library runs nothing.*/
+void initializePatternVM(PatternVM& vm, const PatternLibrary* library, int capacity)
+{
+	vm.library = library;
+	vm.capacity = capacity;
+	PatternGroup empty;
+	empty.count = 0;
+	empty.registers.assign(static_cast<std::size_t>(capacity) * PATTERN_REGISTERS, 0.f);
+	empty.killed.assign(capacity, 0);
+	vm.groups.assign(library ? library->scripts.size() : 0, empty);
+	vm.spawns.clear();
+	vm.spawns.reserve(capacity);
+}
+
+void clearPatternBullets(PatternVM& vm)
+{
+	for (std::size_t i = 0; i < vm.groups.size(); ++i)
+		vm.groups[i].count = 0;
+	vm.spawns.clear();
+}
+
+/*This function adds a bullet running a script. Returns false if there is no room for it.*/
+bool addPatternBullet(PatternVM& vm, int script, sf::Vector2f position, sf::Vector2f velocity, float parameter)
+{
+	if (script < 0 || script >= static_cast<int>(vm.groups.size()) || vm.groups[script].count >= vm.capacity)
+		return false;
+	PatternGroup& group = vm.groups[script];
+	int row = group.count++;
+	for (int reg = 0; reg < PATTERN_REGISTERS; ++reg)
+		group.registers[reg * vm.capacity + row] = 0;
+	group.registers[registerX * vm.capacity + row] = position.x;
+	group.registers[registerY * vm.capacity + row] = position.y;
+	group.registers[registerVX * vm.capacity + row] = velocity.x;
+	group.registers[registerVY * vm.capacity + row] = velocity.y;
+	group.registers[registerParameter * vm.capacity + row] = parameter;
+	group.killed[row] = 0;
+	return true;
+}
+
+int countPatternBullets(const PatternVM& vm)
+{
+	int count = 0;
+	for (std::size_t i = 0; i < vm.groups.size(); ++i)
+		count += vm.groups[i].count;
+	return count;
+}
+
+/*This function returns the column of one register for the bullets of a script, one value per bullet.*/
+float* getPatternRegister(PatternVM& vm, int script, int reg)
+{
+	return &vm.groups[script].registers[reg * vm.capacity];
+}
+
+const float* getPatternRegister(const PatternVM& vm, int script, int reg)
+{
+	return &vm.groups[script].registers[reg * vm.capacity];
+}
+
+// The arithmetic of the binary opcodes, inlined into runBinary.
+struct AddOperation { float operator()(float a, float b) const { return a + b; } };
+struct SubtractOperation { float operator()(float a, float b) const { return a - b; } };
+struct MultiplyOperation { float operator()(float a, float b) const { return a * b; } };
+struct DivideOperation { float operator()(float a, float b) const { return a / b; } };
+struct MinimumOperation { float operator()(float a, float b) const { return (b < a) ? b : a; } };
+struct MaximumOperation { float operator()(float a, float b) const { return (a < b) ? b : a; } };
+struct LessOperation { float operator()(float a, float b) const { return (a < b) ? 1.f : 0.f; } };
+struct EqualOperation { float operator()(float a, float b) const { return (a == b) ? 1.f : 0.f; } };
+
+/*This function runs one binary instruction over count bullets, b being a column or, if it is
+NULL, the constant k. Each loop is straight arithmetic over arrays, which compilers vectorize.*/
+template <typename Operation>
+static void runBinary(float* d, const float* a, const float* b, float k, int count, Operation operation)
+{
+	if (b) {
+		for (int i = 0; i < count; ++i)
+			d[i] = operation(a[i], b[i]);
+	}
+	else {
+		for (int i = 0; i < count; ++i)
+			d[i] = operation(a[i], k);
+	}
+}
+
+/*This function runs the script of a group, one instruction at a time over all of its bullets, so
+decoding costs once per instruction rather than once per bullet.*/
+static void runScript(PatternVM& vm, int script)
+{
+	PatternGroup& group = vm.groups[script];
+	const PatternScript& code = vm.library->scripts[script];
+	int count = group.count;
+	float* r[PATTERN_REGISTERS];
+	for (int reg = 0; reg < PATTERN_REGISTERS; ++reg)
+		r[reg] = &group.registers[reg * vm.capacity];
+
+	for (std::size_t pc = 0; pc < code.code.size(); ++pc)
+	{
+		const PatternInstruction& instruction = code.code[pc];
+		const float* a = r[instruction.a];
+		const float* b = instruction.constantB ? NULL : r[instruction.b];
+		float k = instruction.constantB ? code.constants[instruction.b] : 0;
+		switch (instruction.opcode)
+		{
+		case opMove:
+			if (b)
+				std::copy(b, b + count, r[instruction.d]);
+			else
+				std::fill(r[instruction.d], r[instruction.d] + count, k);
+			break;
+		case opAdd:
+			runBinary(r[instruction.d], a, b, k, count, AddOperation());
+			break;
+		case opSubtract:
+			runBinary(r[instruction.d], a, b, k, count, SubtractOperation());
+			break;
+		case opMultiply:
+			runBinary(r[instruction.d], a, b, k, count, MultiplyOperation());
+			break;
+		case opDivide:
+			runBinary(r[instruction.d], a, b, k, count, DivideOperation());
+			break;
+		case opMinimum:
+			runBinary(r[instruction.d], a, b, k, count, MinimumOperation());
+			break;
+		case opMaximum:
+			runBinary(r[instruction.d], a, b, k, count, MaximumOperation());
+			break;
+		case opLess:
+			runBinary(r[instruction.d], a, b, k, count, LessOperation());
+			break;
+		case opEqual:
+			runBinary(r[instruction.d], a, b, k, count, EqualOperation());
+			break;
+		case opSine:
+			for (int i = 0; i < count; ++i)
+				r[instruction.d][i] = std::sin(a[i]);
+			break;
+		case opCosine:
+			for (int i = 0; i < count; ++i)
+				r[instruction.d][i] = std::cos(a[i]);
+			break;
+		case opSelect:
+		{
+			float* d = r[instruction.d];
+			const float* c = r[instruction.c];
+			for (int i = 0; i < count; ++i)
+				d[i] = (a[i] != 0) ? b[i] : c[i];
+			break;
+		}
+		case opKill:
+			for (int i = 0; i < count; ++i)
+				group.killed[i] |= (a[i] != 0);
+			break;
+		case opEmit:
+		{
+			const float* c = r[instruction.c];
+			for (int i = 0; i < count; ++i)
+			{
+				if (a[i] == 0 || vm.spawns.size() >= vm.spawns.capacity())
+					continue;
+				PatternSpawn spawn = { instruction.d, r[registerX][i], r[registerY][i], b[i], c[i], a[i] };
+				vm.spawns.push_back(spawn);
+			}
+			break;
+		}
+		}
+	}
+}
+
+/*This function runs every script once, then moves each bullet by its velocity and ages it. Bullets
+killed, and those emitted, are only removed and added by removePatternBullets, so that whatever
+tests them for hits in between sees the same ones the scripts did.*/
+void runPatterns(PatternVM& vm)
+{
+	for (std::size_t script = 0; script < vm.groups.size(); ++script)
+	{
+		PatternGroup& group = vm.groups[script];
+		int count = group.count;
+		if (count == 0)
+			continue;
+		std::fill(group.killed.begin(), group.killed.begin() + count, 0);
+		runScript(vm, static_cast<int>(script));
+
+		float* x = &group.registers[registerX * vm.capacity];
+		float* y = &group.registers[registerY * vm.capacity];
+		const float* vx = &group.registers[registerVX * vm.capacity];
+		const float* vy = &group.registers[registerVY * vm.capacity];
+		float* age = &group.registers[registerAge * vm.capacity];
+		for (int i = 0; i < count; ++i)
+		{
+			x[i] += vx[i];
+			y[i] += vy[i];
+			age[i] += 1;
+		}
+	}
+}
+
+/*This function removes the bullets killed this tick and those outside of bounds, keeping the
+others in order, then adds the bullets emitted this tick.*/
+void removePatternBullets(PatternVM& vm, const sf::FloatRect& bounds)
+{
+	for (std::size_t script = 0; script < vm.groups.size(); ++script)
+	{
+		PatternGroup& group = vm.groups[script];
+		const float* x = &group.registers[registerX * vm.capacity];
+		const float* y = &group.registers[registerY * vm.capacity];
+		int kept = 0;
+		for (int i = 0; i < group.count; ++i)
+		{
+			group.killed[i] |= !bounds.contains(x[i], y[i]);
+			kept += !group.killed[i];
+		}
+		if (kept == group.count)
+			continue;
+		// One column at a time, so each is read and written front to back
+		for (int reg = 0; reg < PATTERN_REGISTERS; ++reg)
+		{
+			float* column = &group.registers[reg * vm.capacity];
+			int to = 0;
+			for (int i = 0; i < group.count; ++i)
+			{
+				if (!group.killed[i])
+					column[to++] = column[i];
+			}
+		}
+		group.count = kept;
+	}
+
+	for (std::size_t i = 0; i < vm.spawns.size(); ++i)
+	{
+		const PatternSpawn& spawn = vm.spawns[i];
+		addPatternBullet(vm, spawn.script, sf::Vector2f(spawn.x, spawn.y), sf::Vector2f(spawn.vx, spawn.vy), spawn.parameter);
+	}
+	vm.spawns.clear();
+}
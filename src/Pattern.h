@@ -0,0 +1,103 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <SFML/Graphics.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Pattern settings.
+const int PATTERN_REGISTERS = 16;
+const int MAX_PATTERN_SCRIPTS = 32;
+const int MAX_PATTERN_CONSTANTS = 256;	/* per script, an operand indexes them with one byte */
+
+// Registers every bullet starts with. The VM moves a bullet by its velocity after its script ran
+// and counts its age, the others (r6 to r15) are the script's own and start at 0.
+enum patternRegister {
+	registerX,			// top left corner, in pixels
+	registerY,
+	registerVX,			// pixels per tick
+	registerVY,
+	registerAge,		// ticks the bullet has lived, 0 on its first
+	registerParameter,	// given by whatever spawned the bullet, like its place in a volley
+	FIRST_FREE_REGISTER
+};
+
+// Instructions, with the operands each reads. b is a register, or a constant if the instruction
+// says so. Conditions are true when not 0, comparisons give 1 or 0.
+enum patternOpcode {
+	opMove,		// d = b
+	opAdd,		// d = a + b
+	opSubtract,	// d = a - b
+	opMultiply,	// d = a * b
+	opDivide,	// d = a / b
+	opMinimum,	// d = min(a, b)
+	opMaximum,	// d = max(a, b)
+	opLess,		// d = a < b
+	opEqual,	// d = a == b
+	opSine,		// d = sin(a)
+	opCosine,	// d = cos(a)
+	opSelect,	// d = a ? b : c
+	opKill,		// removes the bullet if a
+	opEmit,		// if a, spawns a bullet of script d where this one is, of velocity (b, c) and parameter a
+	PATTERN_OPCODES
+};
+
+struct PatternInstruction {
+	sf::Uint8 opcode;
+	sf::Uint8 d;
+	sf::Uint8 a;
+	sf::Uint8 b;
+	sf::Uint8 c;
+	bool constantB;		// b is an index into the constants of the script
+};
+
+// What every bullet of one pattern runs once per tick, assembled from text (see assemblePatterns).
+struct PatternScript {
+	std::string name;
+	std::vector<PatternInstruction> code;
+	std::vector<float> constants;
+};
+
+struct PatternLibrary {
+	std::vector<PatternScript> scripts;	// emit refers to them by index
+};
+
+// The bullets running one script. Each register is a column of capacity floats, so every
+// instruction runs over all of them in one loop before the next instruction starts.
+struct PatternGroup {
+	int count;
+	std::vector<float> registers;	// PATTERN_REGISTERS columns, one after the other
+	std::vector<sf::Uint8> killed;	// per bullet, by kill or by whoever hit it this tick
+};
+
+// A bullet emitted this tick, added once every group has run.
+struct PatternSpawn {
+	sf::Uint8 script;
+	float x, y;
+	float vx, vy;
+	float parameter;
+};
+
+// Bullets driven by the scripts of a library, one group per script. Storage is allocated once, by
+// initializePatternVM, a bullet or a spawn past capacity is lost.
+struct PatternVM {
+	const PatternLibrary* library;	// NULL for none
+	int capacity;					// bullets of each script
+	std::vector<PatternGroup> groups;	// by script
+	std::vector<PatternSpawn> spawns;
+};
+
+bool assemblePatterns(const std::string& text, PatternLibrary& library, std::ostream& errors);
+bool loadPatterns(const std::string& path, PatternLibrary& library, std::ostream& errors);
+int findPattern(const PatternLibrary& library, const std::string& name);
+void initializePatternVM(PatternVM& vm, const PatternLibrary* library, int capacity);
+void clearPatternBullets(PatternVM& vm);
+bool addPatternBullet(PatternVM& vm, int script, sf::Vector2f position, sf::Vector2f velocity, float parameter);
+int countPatternBullets(const PatternVM& vm);
+float* getPatternRegister(PatternVM& vm, int script, int reg);
+const float* getPatternRegister(const PatternVM& vm, int script, int reg);
+void runPatterns(PatternVM& vm);
+void removePatternBullets(PatternVM& vm, const sf::FloatRect& bounds);
+
+#endif
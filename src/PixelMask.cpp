@@ -0,0 +1,120 @@
+#include "PixelMask.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#if PIXEL_MASK_SSE2
+#include <emmintrin.h>
+#endif
+
+/*This function builds the mask of an image of RGBA pixels drawn width by height pixels on screen,
+sampled the way a sprite without smoothing is drawn: pixel (x, y) is the texel under its center.*/
+void buildPixelMask(PixelMask& mask, const sf::Uint8* pixels, int imageWidth, int imageHeight, float width, float height)
+{
+	mask.width = std::min(static_cast<int>(std::ceil(width)), MAX_MASK_WORDS * 64);
+	mask.height = std::min(static_cast<int>(std::ceil(height)), MAX_MASK_ROWS);
+	mask.words = (mask.width + 63) / 64;
+	for (int i = 0; i < MAX_MASK_WORDS * MAX_MASK_ROWS; ++i)
+		mask.bits[i] = 0;
+	for (int y = 0; y < mask.height; ++y)
+	{
+		int texelY = static_cast<int>((y + .5) * imageHeight / height);
+		if (texelY >= imageHeight)
+			continue;
+		for (int x = 0; x < mask.width; ++x)
+		{
+			int texelX = static_cast<int>((x + .5) * imageWidth / width);
+			if (texelX < imageWidth && pixels[(texelY * imageWidth + texelX) * 4 + 3] >= MASK_ALPHA_THRESHOLD)
+				mask.bits[(x / 64) * MAX_MASK_ROWS + y] |= 1ULL << (x % 64);
+		}
+	}
+}
+
+/*This function is masksOverlap, with or without SSE2. A word of mask2 lands on at most two words of
+mask1, shifted by the same amount on every row: left by shift into the first, right by 64 - shift
+into the next. With SSE2 two rows are shifted, ANDed and tested at once.*/
+static bool testMasks(const PixelMask& mask1, const PixelMask& mask2, int dx, int dy, bool vector)
+{
+	if (dx < 0)
+		return testMasks(mask2, mask1, -dx, -dy, vector);
+	int first = std::max(0, dy);	// rows of mask1 both masks cover
+	int last = std::min(mask1.height, dy + mask2.height);
+	if (first >= last || dx >= mask1.width)
+		return false;
+
+	for (int word2 = 0; word2 < mask2.words; ++word2)
+	{
+		int word1 = (dx + 64 * word2) / 64;
+		if (word1 >= mask1.words)
+			break;
+		int shift = (dx + 64 * word2) % 64;
+		const sf::Uint64* rows1 = &mask1.bits[word1 * MAX_MASK_ROWS];
+		const sf::Uint64* next1 = (word1 + 1 < mask1.words) ? &mask1.bits[(word1 + 1) * MAX_MASK_ROWS] : NULL;
+		const sf::Uint64* rows2 = &mask2.bits[word2 * MAX_MASK_ROWS];
+		int y = first;
+#if PIXEL_MASK_SSE2
+		if (vector)
+		{
+			__m128i left = _mm_cvtsi32_si128(shift);
+			__m128i right = _mm_cvtsi32_si128(64 - shift);	// a shift by 64 gives 0, unlike a scalar one
+			for (; y + 2 <= last; y += 2)
+			{
+				__m128i row2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows2 + y - dy));
+				__m128i hits = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows1 + y)), _mm_sll_epi64(row2, left));
+				if (next1)
+					hits = _mm_or_si128(hits, _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(next1 + y)), _mm_srl_epi64(row2, right)));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(hits, _mm_setzero_si128())) != 0xFFFF)
+					return true;
+			}
+		}
+#endif
+		for (; y < last; ++y)
+		{
+			sf::Uint64 row2 = rows2[y - dy];
+			if (rows1[y] & (row2 << shift))
+				return true;
+			if (next1 && shift > 0 && (next1[y] & (row2 >> (64 - shift))))
+				return true;
+		}
+	}
+	return false;
+}
+
+/*This function checks if a solid pixel of mask2, with its top left corner dx and dy pixels right
+and down of the one of mask1, is solid in mask1 too. It is the narrow phase of a hit test, for
+sprites whose boxes overlap.*/
+bool masksOverlap(const PixelMask& mask1, const PixelMask& mask2, int dx, int dy)
+{
+	return testMasks(mask1, mask2, dx, dy, true);
+}
+
+/*This function is masksOverlap one row at a time, to measure it against.*/
+bool masksOverlapScalar(const PixelMask& mask1, const PixelMask& mask2, int dx, int dy)
+{
+	return testMasks(mask1, mask2, dx, dy, false);
+}
+
+/*This function writes masks as the C++ source of the SPRITE_MASKS table, see --cook-masks. Zero
+words after the last solid one are left out.*/
+void writeCookedMasks(std::ostream& out, const PixelMask masks[], const char* const names[], int count)
+{
+	out << "// Written by ToastyDuels --cook-masks from the sprite textures, do not edit." << std::endl;
+	out << "#include \"PixelMask.h\"" << std::endl << std::endl;
+	out << "const PixelMask SPRITE_MASKS[] = {" << std::endl;
+	for (int i = 0; i < count; ++i)
+	{
+		const PixelMask& mask = masks[i];
+		out << "\t{ " << mask.width << ", " << mask.height << ", " << mask.words << ", {	// " << names[i] << std::endl;
+		int words = MAX_MASK_WORDS * MAX_MASK_ROWS;
+		while (words > 0 && mask.bits[words - 1] == 0)
+			--words;
+		for (int word = 0; word < words; ++word)
+		{
+			out << ((word % 4 == 0) ? "\t\t" : " ") << "0x" << std::hex << std::setw(16) << std::setfill('0') << mask.bits[word] << "ULL,";
+			if (word % 4 == 3 || word == words - 1)
+				out << std::endl;
+		}
+		out << std::dec << std::setfill(' ');
+		out << "\t} }," << std::endl;
+	}
+	out << "};" << std::endl;
+}
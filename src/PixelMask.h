@@ -0,0 +1,40 @@
+#ifndef PIXEL_MASK_H
+#define PIXEL_MASK_H
+
+#include <SFML/Config.hpp>
+#include <ostream>
+
+// Where the SSE2 narrow phase is built, like the bullet kernel.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_MASK_SSE2 1
+#else
+#define PIXEL_MASK_SSE2 0
+#endif
+
+// Pixel mask settings.
+const int MAX_MASK_WORDS = 2;	/* a row is at most this many words of 64 pixels */
+const int MAX_MASK_ROWS = 128;
+const int MASK_ALPHA_THRESHOLD = 128;	/* a pixel at least this opaque is solid */
+
+// The solid pixels of a sprite at its size on screen, one bit per pixel: bit x of word w of row y is
+// pixel 64 * w + x of that row. The rows of each word follow each other (a word is a column 64
+// pixels wide), so two rows of a word load as one 128 bit value. Words and rows past the sprite
+// are 0.
+struct PixelMask {
+	int width;
+	int height;
+	int words;
+	sf::Uint64 bits[MAX_MASK_WORDS * MAX_MASK_ROWS];	// word w of row y is bits[w * MAX_MASK_ROWS + y]
+};
+
+// The masks of every appearanceType, cooked from the sprite textures by --cook-masks into
+// CookedMasks.cpp, so the simulation never needs a texture, and every build and server has the
+// same ones.
+extern const PixelMask SPRITE_MASKS[];
+
+void buildPixelMask(PixelMask& mask, const sf::Uint8* pixels, int imageWidth, int imageHeight, float width, float height);
+bool masksOverlap(const PixelMask& mask1, const PixelMask& mask2, int dx, int dy);
+bool masksOverlapScalar(const PixelMask& mask1, const PixelMask& mask2, int dx, int dy);
+void writeCookedMasks(std::ostream& out, const PixelMask masks[], const char* const names[], int count);
+
+#endif
@@ -0,0 +1,143 @@
+#include "RenderCommands.h"
+#include <algorithm>
+
+/*This function sets up a buffer with no textures and no commands.*/
+void initializeRenderCommands(RenderCommandBuffer& buffer)
+{
+	buffer.textures[0] = NULL;
+	buffer.textureCount = 1;
+	buffer.lists.clear();
+	buffer.listCount = 0;
+	buffer.sorted.clear();
+	buffer.scratch.clear();
+}
+
+/*This function returns the id keys give the texture, giving it the next one the first time it is
+seen. Textures are added once, before commands use them, and keep their id. Past
+MAX_RENDER_TEXTURES, a texture is drawn as if it had none.*/
+int addRenderTexture(RenderCommandBuffer& buffer, const sf::Texture* texture)
+{
+	for (int id = 0; id < buffer.textureCount; ++id)
+	{
+		if (buffer.textures[id] == texture)
+			return id;
+	}
+	if (buffer.textureCount == MAX_RENDER_TEXTURES)
+		return 0;
+	buffer.textures[buffer.textureCount] = texture;
+	return buffer.textureCount++;
+}
+
+/*This function empties the buffer for a frame of the given number of lists (at most
+MAX_RENDER_LISTS), which threads then fill, each list by one thread.*/
+void beginRenderCommands(RenderCommandBuffer& buffer, int lists)
+{
+	buffer.listCount = std::min(lists, MAX_RENDER_LISTS);
+	if (static_cast<int>(buffer.lists.size()) < buffer.listCount)
+		buffer.lists.resize(buffer.listCount);
+	for (int i = 0; i < buffer.listCount; ++i)
+	{
+		buffer.lists[i].commands.clear();
+		buffer.lists[i].keys.clear();
+	}
+	buffer.sorted.clear();
+}
+
+/*This function returns the key of a command: by layer, then texture id, then depth.*/
+sf::Uint64 makeRenderKey(int layer, int texture, sf::Uint16 depth)
+{
+	return (static_cast<sf::Uint64>(layer & 0xFF) << RENDER_KEY_LAYER_SHIFT) |
+		(static_cast<sf::Uint64>(texture & 0xFF) << RENDER_KEY_TEXTURE_SHIFT) |
+		(static_cast<sf::Uint64>(depth) << RENDER_KEY_DEPTH_SHIFT);
+}
+
+/*This function adds a command to a list. A command past MAX_RENDER_LIST_COMMANDS is lost.*/
+void addRenderCommand(RenderCommandList& list, sf::Uint64 key, const RenderCommand& command)
+{
+	if (static_cast<int>(list.commands.size()) == MAX_RENDER_LIST_COMMANDS)
+		return;
+	list.keys.push_back(key);
+	list.commands.push_back(command);
+}
+
+/*This function merges the keys of every list, with the list and the place of its command in the
+low 32 bits, and sorts them least significant byte first over the upper 32 bits. The counts of
+all four bytes are taken in one pass, and a byte every key shares is skipped: frames with one
+layer or one texture skip its pass. Stable, so the order of commands alike is the same whatever
+thread filled which list.*/
+void sortRenderCommands(RenderCommandBuffer& buffer)
+{
+	std::vector<sf::Uint64> &keys = buffer.sorted;
+	keys.clear();
+	for (int list = 0; list < buffer.listCount; ++list)
+	{
+		const std::vector<sf::Uint64> &listKeys = buffer.lists[list].keys;
+		sf::Uint64 base = static_cast<sf::Uint64>(list) << RENDER_KEY_LIST_SHIFT;
+		for (std::size_t i = 0; i < listKeys.size(); ++i)
+			keys.push_back(listKeys[i] | base | i);
+	}
+	if (keys.size() < 2)
+		return;
+
+	unsigned int counts[4][256] = {};
+	for (std::size_t i = 0; i < keys.size(); ++i)
+	{
+		sf::Uint64 key = keys[i];
+		for (int pass = 0; pass < 4; ++pass)
+			counts[pass][(key >> (RENDER_KEY_DEPTH_SHIFT + pass * 8)) & 0xFF]++;
+	}
+
+	buffer.scratch.resize(keys.size());
+	std::vector<sf::Uint64>* from = &keys;
+	std::vector<sf::Uint64>* to = &buffer.scratch;
+	for (int pass = 0; pass < 4; ++pass)
+	{
+		int shift = RENDER_KEY_DEPTH_SHIFT + pass * 8;
+		if (counts[pass][((*from)[0] >> shift) & 0xFF] == keys.size())
+			continue;
+		unsigned int offsets[256];
+		unsigned int offset = 0;
+		for (int b = 0; b < 256; ++b)
+		{
+			offsets[b] = offset;
+			offset += counts[pass][b];
+		}
+		for (std::size_t i = 0; i < from->size(); ++i)
+		{
+			sf::Uint64 key = (*from)[i];
+			(*to)[offsets[(key >> shift) & 0xFF]++] = key;
+		}
+		std::swap(from, to);
+	}
+	if (from != &keys)
+		keys.swap(buffer.scratch);
+}
+
+/*This function returns how many commands the lists of this frame hold.*/
+int countRenderCommands(const RenderCommandBuffer& buffer)
+{
+	int count = 0;
+	for (int list = 0; list < buffer.listCount; ++list)
+		count += static_cast<int>(buffer.lists[list].commands.size());
+	return count;
+}
+
+/*This function returns the command of a sorted key.*/
+const RenderCommand& getRenderCommand(const RenderCommandBuffer& buffer, sf::Uint64 key)
+{
+	int list = static_cast<int>((key >> RENDER_KEY_LIST_SHIFT) & 0xFF);
+	return buffer.lists[list].commands[key & (MAX_RENDER_LIST_COMMANDS - 1)];
+}
+
+/*This function returns the texture of a key, NULL for none.*/
+const sf::Texture* getRenderTexture(const RenderCommandBuffer& buffer, sf::Uint64 key)
+{
+	int texture = static_cast<int>((key >> RENDER_KEY_TEXTURE_SHIFT) & 0xFF);
+	return (texture < buffer.textureCount) ? buffer.textures[texture] : NULL;
+}
+
+/*This function returns the layer of a key.*/
+int getRenderLayer(sf::Uint64 key)
+{
+	return static_cast<int>(key >> RENDER_KEY_LAYER_SHIFT);
+}
@@ -0,0 +1,59 @@
+#ifndef RENDER_COMMANDS_H
+#define RENDER_COMMANDS_H
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Render command settings.
+const int MAX_RENDER_TEXTURES = 256;	/* a key holds the texture as one byte, 0 is no texture */
+const int MAX_RENDER_LISTS = 256;		/* a key holds the list of its command as one byte */
+const int MAX_RENDER_LIST_COMMANDS = 1 << 24;	/* and its place in the list as three */
+
+// A sort key is, from the highest byte down: the layer, the texture, 16 bits of depth (drawn in
+// increasing order) and 32 bits that find the command, see makeRenderKey. Sorting by key puts every
+// layer and texture in one run, and keeps commands of equal layer, texture and depth in the order
+// of their lists.
+const int RENDER_KEY_LAYER_SHIFT = 56;
+const int RENDER_KEY_TEXTURE_SHIFT = 48;
+const int RENDER_KEY_DEPTH_SHIFT = 32;
+const int RENDER_KEY_LIST_SHIFT = 24;
+const sf::Uint64 RENDER_KEY_STATE_MASK = 0xFFFF000000000000ULL;	/* layer and texture */
+
+// One unrotated quad, on screen and in its texture (ignored without one).
+struct RenderCommand {
+	float x, y, width, height;
+	sf::Uint16 u, v, uWidth, vHeight;
+	sf::Color color;
+};
+
+// The commands of one thread or job, each with the key it was added with (nothing in the low 32
+// bits yet).
+struct RenderCommandList {
+	std::vector<RenderCommand> commands;
+	std::vector<sf::Uint64> keys;
+};
+
+// The commands of a frame. Any number of threads add commands, each to lists of its own, then
+// sortRenderCommands merges the keys of every list and radix sorts them, so a submit changes
+// layer or texture once per run. Storage is kept from frame to frame.
+struct RenderCommandBuffer {
+	const sf::Texture* textures[MAX_RENDER_TEXTURES];	// by id, 0 is NULL
+	int textureCount;
+	std::vector<RenderCommandList> lists;
+	int listCount;					// used this frame, see beginRenderCommands
+	std::vector<sf::Uint64> sorted;	// keys of every list, in draw order after sortRenderCommands
+	std::vector<sf::Uint64> scratch;
+};
+
+void initializeRenderCommands(RenderCommandBuffer& buffer);
+int addRenderTexture(RenderCommandBuffer& buffer, const sf::Texture* texture);
+void beginRenderCommands(RenderCommandBuffer& buffer, int lists);
+sf::Uint64 makeRenderKey(int layer, int texture, sf::Uint16 depth);
+void addRenderCommand(RenderCommandList& list, sf::Uint64 key, const RenderCommand& command);
+void sortRenderCommands(RenderCommandBuffer& buffer);
+int countRenderCommands(const RenderCommandBuffer& buffer);
+const RenderCommand& getRenderCommand(const RenderCommandBuffer& buffer, sf::Uint64 key);
+const sf::Texture* getRenderTexture(const RenderCommandBuffer& buffer, sf::Uint64 key);
+int getRenderLayer(sf::Uint64 key);
+
+#endif
@@ -0,0 +1,150 @@
+#include "Rollback.h"
+
+/*This function returns the remote input of a tick: the real one if it arrived, otherwise a
+repeat of the last one that did.*/
+static sf::Uint8 getRemoteInput(const LockstepSession& transport, sf::Uint32 tick)
+{
+	if (tick < transport.remoteKnown)
+		return transport.remoteInputs[tick & (LOCKSTEP_HISTORY - 1)];
+	if (transport.remoteKnown == 0)
+		return 0;
+	return transport.remoteInputs[(transport.remoteKnown - 1) & (LOCKSTEP_HISTORY - 1)];
+}
+
+/*This function simulates one tick with the local input and the best known remote input, and
+remembers which remote input was used.*/
+static void simulateWithGuess(RollbackSession& session, Match& match, sf::Uint32 tick)
+{
+	sf::Uint8 local = session.transport.localInputs[tick & (LOCKSTEP_HISTORY - 1)];
+	sf::Uint8 remote = getRemoteInput(session.transport, tick);
+	session.guessed[tick % ROLLBACK_STATES] = remote;
+	if (session.transport.localPlayer == 1)
+		simulateTick(match, local, remote);
+	else
+		simulateTick(match, remote, local);
+}
+
+/*This function hashes the state after every tick confirmed since the tick from, for the desync
+check of the transport. Those states are still saved, or the current match for the newest one.*/
+static void recordConfirmedStates(RollbackSession& session, const Match& match, sf::Uint32 from)
+{
+	for (sf::Uint32 tick = from; tick < session.confirmed; ++tick)
+	{
+		sf::Uint32 next = tick + 1;
+		recordState(session.transport, tick, next == session.transport.tick ? match : session.saved[next % ROLLBACK_STATES]);
+	}
+}
+
+/*This function binds the local port and prepares an empty session.*/
+bool startRollback(RollbackSession& session, int localPlayer, unsigned short localPort,
+	const sf::IpAddress& remoteAddress, unsigned short remotePort, int inputDelay, const NetworkConditions* conditions)
+{
+	if (!startLockstep(session.transport, localPlayer, localPort, remoteAddress, remotePort, inputDelay, conditions))
+		return false;
+	session.confirmed = 0;
+	for (int i = 0; i < ROLLBACK_STATES; ++i)
+		session.guessed[i] = 0;
+	session.predictedTicks = 0;
+	session.rollbacks = 0;
+	for (int i = 0; i <= MAX_ROLLBACK; ++i)
+		session.depthCounts[i] = 0;
+	session.resimMicroseconds = 0;
+	session.maxResimMicroseconds = 0;
+	return true;
+}
+
+/*This function reads the inputs that arrived from the remote peer and checks them against the
+guesses. On the first wrong guess the match saved at that tick is restored and every tick up to
+the current one is simulated again, all within this call.*/
+void updateRollback(RollbackSession& session, Match& match)
+{
+	LockstepSession& transport = session.transport;
+	receiveInputs(transport);
+
+	sf::Uint32 known = (transport.remoteKnown < transport.tick) ? transport.remoteKnown : transport.tick;
+	sf::Uint32 first = session.confirmed;
+	while (first < known && transport.remoteInputs[first & (LOCKSTEP_HISTORY - 1)] == session.guessed[first % ROLLBACK_STATES])
+		first++;
+	sf::Uint32 wasConfirmed = session.confirmed;
+	session.confirmed = known;
+	if (first == known) {
+		recordConfirmedStates(session, match, wasConfirmed);
+		return;
+	}
+
+	// Restore and simulate again; the saved matches of the later ticks are refreshed on the way
+	sf::Clock clock;
+	match = session.saved[first % ROLLBACK_STATES];
+	for (sf::Uint32 tick = first; tick < transport.tick; ++tick)
+	{
+		if (tick != first)
+			session.saved[tick % ROLLBACK_STATES] = match;
+		simulateWithGuess(session, match, tick);
+	}
+	sf::Int64 elapsed = clock.getElapsedTime().asMicroseconds();
+	recordConfirmedStates(session, match, wasConfirmed);
+
+	session.rollbacks++;
+	session.depthCounts[transport.tick - first]++;
+	session.resimMicroseconds += elapsed;
+	if (elapsed > session.maxResimMicroseconds)
+		session.maxResimMicroseconds = elapsed;
+}
+
+/*This function checks if another tick can be guessed without going past MAX_ROLLBACK.
+Call it after updateRollback.*/
+bool canPredictTick(const RollbackSession& session)
+{
+	return session.transport.tick - session.confirmed < static_cast<sf::Uint32>(MAX_ROLLBACK);
+}
+
+/*This function records and sends the local input sampled this tick (it will be used inputDelay
+ticks from now), saves the match and simulates the next tick. Only call it when canPredictTick.*/
+void advanceRollback(RollbackSession& session, Match& match, sf::Uint8 localInput)
+{
+	LockstepSession& transport = session.transport;
+	transport.localInputs[transport.localKnown & (LOCKSTEP_HISTORY - 1)] = localInput;
+	transport.localKnown++;
+	sendInputs(transport);
+
+	// Bullets live in fixed capacity archetypes, so a save copies over the old one without allocating
+	session.saved[transport.tick % ROLLBACK_STATES] = match;
+	if (transport.tick >= transport.remoteKnown)
+		session.predictedTicks++;
+	simulateWithGuess(session, match, transport.tick);
+	transport.tick++;
+	if (transport.remoteKnown >= transport.tick) {
+		sf::Uint32 wasConfirmed = session.confirmed;
+		session.confirmed = transport.tick;
+		recordConfirmedStates(session, match, wasConfirmed);
+	}
+}
+
+/*This function returns the newest state of the match that no late input can change anymore.*/
+const Match& getConfirmedMatch(const RollbackSession& session, const Match& match)
+{
+	if (session.confirmed == session.transport.tick)
+		return match;
+	return session.saved[session.confirmed % ROLLBACK_STATES];
+}
+
+/*This function prints how often the remote input had to be guessed, how often a guess was wrong
+and how long simulating again took.*/
+void printRollbackReport(const RollbackSession& session, std::ostream& out)
+{
+	const LockstepSession& transport = session.transport;
+	if (transport.tick == 0)
+		return;
+
+	out << "ROLLBACK" << std::endl;
+	out << "  " << session.predictedTicks << " of " << transport.tick << " ticks predicted, "
+		<< session.rollbacks << " rolled back ("
+		<< 100.0 * session.rollbacks / transport.tick << "% of ticks)" << std::endl;
+	out << "  depth:";
+	for (int i = 1; i <= MAX_ROLLBACK; ++i)
+		out << " " << i << ":" << session.depthCounts[i];
+	out << std::endl;
+	if (session.rollbacks > 0)
+		out << "  resimulation: mean " << session.resimMicroseconds / session.rollbacks
+			<< "us, max " << session.maxResimMicroseconds << "us" << std::endl;
+}
@@ -0,0 +1,36 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <SFML/System.hpp>
+#include <ostream>
+#include "Lockstep.h"
+#include "Simulation.h"
+
+const int MAX_ROLLBACK = 8;						// ticks simulated ahead of the other peer's input before stalling
+const int ROLLBACK_STATES = MAX_ROLLBACK + 1;	// saved matches, one per tick that may still be rolled back
+
+// Two peers exchanging inputs like in lockstep, but a tick never waits for the other peer: its
+// input is guessed as a repeat of the last one received. When the real input arrives and differs
+// from the guess, the match is restored to the tick of the first wrong guess and simulated again.
+struct RollbackSession {
+	LockstepSession transport;				// input exchange, transport.tick is the next tick to simulate
+	sf::Uint32 confirmed;					// ticks before this one were simulated with the real remote input
+	Match saved[ROLLBACK_STATES];			// match at the start of each unconfirmed tick
+	sf::Uint8 guessed[ROLLBACK_STATES];		// remote input each unconfirmed tick was simulated with
+	// Metrics
+	sf::Uint32 predictedTicks;				// ticks first simulated with a guessed remote input
+	sf::Uint32 rollbacks;
+	sf::Uint32 depthCounts[MAX_ROLLBACK + 1];	// rollbacks by number of ticks simulated again
+	sf::Int64 resimMicroseconds;
+	sf::Int64 maxResimMicroseconds;
+};
+
+bool startRollback(RollbackSession& session, int localPlayer, unsigned short localPort,
+	const sf::IpAddress& remoteAddress, unsigned short remotePort, int inputDelay, const NetworkConditions* conditions);
+void updateRollback(RollbackSession& session, Match& match);
+bool canPredictTick(const RollbackSession& session);
+void advanceRollback(RollbackSession& session, Match& match, sf::Uint8 localInput);
+const Match& getConfirmedMatch(const RollbackSession& session, const Match& match);
+void printRollbackReport(const RollbackSession& session, std::ostream& out);
+
+#endif
@@ -0,0 +1,430 @@
+#include "Server.h"
+#include <iostream>
+#include "StateHash.h"
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+const int MAX_SERVER_TICKS_BEHIND = 5;	// a shard that falls further behind skips ticks instead of catching up
+
+/*This function keeps the calling thread on one core, where the platform allows it (macOS only has
+affinity hints, the thread is left alone there).*/
+void pinThreadToCore(int core)
+{
+#if defined(__linux__)
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(core, &cpus);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#elif defined(_WIN32)
+	SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << core);
+#else
+	(void)core;
+#endif
+}
+
+/*This function sends a player the state of its match, as changes against the newest snapshot the
+player has if it is still in the history.*/
+static void sendSnapshot(ServerShard& shard, HostedMatch& hosted, ServerClient& client)
+{
+	const Snapshot& snapshot = hosted.history[hosted.tick & (SNAPSHOT_HISTORY - 1)];
+	const Snapshot* baseline = &hosted.history[client.ackedTick & (SNAPSHOT_HISTORY - 1)];
+	if (client.ackedTick == 0 || baseline->tick != client.ackedTick)
+		baseline = NULL;
+
+	BitWriter writer;
+	startWriting(writer, shard.sendBuffer, sizeof(shard.sendBuffer));
+	writeBits(writer, stateMessage, 8);
+	writeBits(writer, client.id, 32);
+	writeBits(writer, client.appliedTick, 32);
+	encodeSnapshot(writer, snapshot, baseline);
+	shard.socket.send(shard.sendBuffer, getWrittenBytes(writer), client.address, client.port);
+	shard.bytesSent += getWrittenBytes(writer);
+}
+
+/*This function gives a client a seat, in the waiting match or in a new one, and welcomes it.
+A client asking again (lost welcome) gets the same seat. A new match takes the place of a retired
+one if there is one, so the matches of a shard only grow with the players it has at once.*/
+static void handleJoin(ServerShard& shard, sf::Uint32 clientId, const sf::IpAddress& address, unsigned short port)
+{
+	std::map<sf::Uint32, sf::Uint32>::iterator seat = shard.seats.find(clientId);
+	if (seat == shard.seats.end())
+	{
+		if (shard.waitingMatch < 0)
+		{
+			if (shard.freeMatches.empty()) {
+				shard.matches.push_back(HostedMatch());
+				shard.waitingMatch = static_cast<int>(shard.matches.size()) - 1;
+			}
+			else {
+				shard.waitingMatch = static_cast<int>(shard.freeMatches.back());
+				shard.freeMatches.pop_back();
+			}
+			HostedMatch& hosted = shard.matches[shard.waitingMatch];
+			initializeMatch(hosted.match);
+			hosted.playerCount = 0;
+			hosted.tick = 0;
+			for (int i = 0; i < SNAPSHOT_HISTORY; ++i)
+				clearSnapshot(hosted.history[i]);
+			hosted.spectators.spectators.clear();
+			hosted.spectators.nextRedirect = 0;
+			hosted.spectators.bytesSent = 0;
+			hosted.spectators.redirects = 0;
+			hosted.spectators.refused = 0;
+		}
+		HostedMatch& hosted = shard.matches[shard.waitingMatch];
+		ServerClient& client = hosted.players[hosted.playerCount];
+		client.address = address;
+		client.port = port;
+		client.id = clientId;
+		client.input = 0;
+		client.appliedTick = 0;
+		client.receivedTick = 0;
+		for (int i = 0; i < SERVER_INPUT_BUFFER; ++i)
+			client.inputTicks[i] = 0;
+		client.ackedTick = 0;
+		client.heardTick = shard.ticks;
+		seat = shard.seats.insert(std::make_pair(clientId, static_cast<sf::Uint32>(shard.waitingMatch * 2 + hosted.playerCount))).first;
+		if (++hosted.playerCount == 2)
+			shard.waitingMatch = -1;
+	}
+
+	shard.matches[seat->second / 2].players[seat->second % 2].heardTick = shard.ticks;
+	sf::Packet welcome;
+	welcome << static_cast<sf::Uint8>(welcomeMessage) << clientId << (seat->second / 2) << static_cast<sf::Uint8>(seat->second % 2 + 1);
+	shard.socket.send(welcome, address, port);
+}
+
+/*This function buffers the inputs of a player until their tick. A packet repeats the last few
+inputs, so one lost packet loses nothing.*/
+static void handleInput(ServerShard& shard, sf::Packet& packet, const sf::IpAddress& address, unsigned short port)
+{
+	sf::Uint32 matchIndex;
+	sf::Uint8 player;
+	sf::Uint32 newestTick;
+	sf::Uint8 count;
+	if (!(packet >> matchIndex >> player >> newestTick >> count))
+		return;
+	if (matchIndex >= shard.matches.size() || player < 1 || player > 2 || count > MAX_INPUTS_PER_MESSAGE || count > newestTick)
+		return;
+	ServerClient& client = shard.matches[matchIndex].players[player - 1];
+	if (client.address != address || client.port != port)
+		return;
+	client.heardTick = shard.ticks;
+
+	for (sf::Uint32 tick = newestTick - count + 1; tick <= newestTick; ++tick)
+	{
+		sf::Uint8 input;
+		if (!(packet >> input))
+			return;
+		if (tick <= client.appliedTick || tick > client.appliedTick + SERVER_INPUT_BUFFER)
+			continue;
+		// Duels only have three keys, and the stream packs both players' in one byte.
+		client.inputs[tick & (SERVER_INPUT_BUFFER - 1)] = input & (INPUT_LEFT | INPUT_RIGHT | INPUT_FIRE);
+		client.inputTicks[tick & (SERVER_INPUT_BUFFER - 1)] = tick;
+		if (tick > client.receivedTick)
+			client.receivedTick = tick;
+	}
+
+	sf::Uint32 ackedTick;
+	if ((packet >> ackedTick) && ackedTick > client.ackedTick && ackedTick <= shard.matches[matchIndex].tick)
+		client.ackedTick = ackedTick;
+}
+
+/*This function picks the input a player plays this tick: the next one in order if it arrived,
+otherwise the last one again. A player too far behind skips inputs to catch up.*/
+static void consumeInput(ServerClient& client)
+{
+	if (client.receivedTick > client.appliedTick + MAX_INPUT_BACKLOG)
+		client.appliedTick = client.receivedTick - MAX_INPUT_BACKLOG;
+	if (client.receivedTick <= client.appliedTick)
+		return;
+
+	client.appliedTick++;
+	int slot = client.appliedTick & (SERVER_INPUT_BUFFER - 1);
+	if (client.inputTicks[slot] == client.appliedTick)
+		client.input = client.inputs[slot];
+}
+
+/*This function reads every pending packet of the shard's socket.*/
+static void receiveClientPackets(ServerShard& shard)
+{
+	sf::Packet packet;
+	sf::IpAddress address;
+	unsigned short port;
+	while (shard.socket.receive(packet, address, port) == sf::Socket::Done)
+	{
+		sf::Uint8 type;
+		if (!(packet >> type))
+			continue;
+		if (type == joinMessage) {
+			sf::Uint32 clientId;
+			if (packet >> clientId)
+				handleJoin(shard, clientId, address, port);
+		}
+		else if (type == inputMessage)
+			handleInput(shard, packet, address, port);
+		else if (type == subscribeMessage) {
+			sf::Uint32 matchIndex;
+			sf::Uint8 relay;
+			if ((packet >> matchIndex >> relay) && matchIndex < shard.matches.size() && shard.matches[matchIndex].playerCount > 0)
+				addSpectator(shard.matches[matchIndex].spectators, shard.socket, matchIndex, address, port, relay != 0, shard.ticks);
+		}
+	}
+}
+
+/*This function feeds a match's viewers a keyframe now and then, taken before a tick is simulated.*/
+static void sendKeyframe(ServerShard& shard, HostedMatch& hosted, sf::Uint32 matchIndex, sf::Uint32 tick)
+{
+	if (hosted.spectators.spectators.empty() || tick % KEYFRAME_TICKS != 0)
+		return;
+	std::size_t size = writeKeyframe(shard.streamBuffer, sizeof(shard.streamBuffer), matchIndex, tick, hosted.match);
+	if (size > 0)
+		sendToSpectators(hosted.spectators, shard.socket, shard.streamBuffer, size, shard.ticks);
+}
+
+/*This function feeds a match's viewers the inputs of the tick just simulated, and the hash of the
+match after it. Viewers simulate the match themselves, so a tick costs a few bytes per viewer fed.*/
+static void sendInputStream(ServerShard& shard, HostedMatch& hosted, sf::Uint32 matchIndex, sf::Uint32 tick)
+{
+	hosted.playedInputs[tick % STREAM_REDUNDANCY] = static_cast<sf::Uint8>(hosted.players[0].input | (hosted.players[1].input << 3));
+	if (hosted.spectators.spectators.empty())
+		return;
+	std::size_t size = writeInputStream(shard.streamBuffer, sizeof(shard.streamBuffer), matchIndex, tick,
+		hosted.playedInputs, hashMatch(hosted.match));
+	sendToSpectators(hosted.spectators, shard.socket, shard.streamBuffer, size, shard.ticks);
+}
+
+/*This function frees the seats of a match and its place in the shard, for handleJoin to reuse.*/
+static void retireMatch(ServerShard& shard, sf::Uint32 matchIndex)
+{
+	HostedMatch& hosted = shard.matches[matchIndex];
+	for (int i = 0; i < hosted.playerCount; ++i)
+		shard.seats.erase(hosted.players[i].id);
+	hosted.playerCount = 0;
+	hosted.spectators.spectators.clear();
+	if (shard.waitingMatch == static_cast<int>(matchIndex))
+		shard.waitingMatch = -1;
+	shard.freeMatches.push_back(matchIndex);
+	shard.retiredMatches++;
+}
+
+/*This function checks if a player of a match has not been heard from for SEAT_TIMEOUT_TICKS.*/
+static bool hasLeft(const ServerShard& shard, const HostedMatch& hosted, int player)
+{
+	return shard.ticks - hosted.players[player].heardTick > static_cast<sf::Uint32>(SEAT_TIMEOUT_TICKS);
+}
+
+/*This function retires the matches whose players are gone: a waiting match once its player has
+left, a full one once both have, or once a round is over with one of them gone, since the rematch
+would be against nobody.*/
+static void retireAbandonedMatches(ServerShard& shard)
+{
+	for (std::size_t i = 0; i < shard.matches.size(); ++i)
+	{
+		const HostedMatch& hosted = shard.matches[i];
+		if (hosted.playerCount == 0)
+			continue;
+		bool left1 = hasLeft(shard, hosted, 0);
+		bool left2 = (hosted.playerCount == 2) ? hasLeft(shard, hosted, 1) : true;
+		bool abandoned = (hosted.playerCount == 1) ? left1 : (left1 && left2);
+		if (abandoned || (hosted.playerCount == 2 && (left1 || left2) && isMatchOver(hosted.match)))
+			retireMatch(shard, static_cast<sf::Uint32>(i));
+	}
+}
+
+/*This function advances every full match of the shard by one tick and sends each player the new state.*/
+static void tickMatches(ServerShard& shard)
+{
+	retireAbandonedMatches(shard);
+	for (std::size_t i = 0; i < shard.matches.size(); ++i)
+	{
+		HostedMatch& hosted = shard.matches[i];
+		if (hosted.playerCount < 2)
+			continue;
+
+		consumeInput(hosted.players[0]);
+		consumeInput(hosted.players[1]);
+		sendKeyframe(shard, hosted, static_cast<sf::Uint32>(i), hosted.tick);
+		simulateTick(hosted.match, hosted.players[0].input, hosted.players[1].input);
+		sendInputStream(shard, hosted, static_cast<sf::Uint32>(i), hosted.tick);
+		hosted.tick++;
+		Snapshot& snapshot = hosted.history[hosted.tick & (SNAPSHOT_HISTORY - 1)];
+		takeSnapshot(snapshot, hosted.match, hosted.tick);
+
+		// Measured only, for the report
+		BitWriter full;
+		startWriting(full, shard.sendBuffer, sizeof(shard.sendBuffer));
+		encodeSnapshot(full, snapshot, NULL);
+		shard.fullBytes += 2 * (STATE_HEADER_SIZE + getWrittenBytes(full));
+
+		sendSnapshot(shard, hosted, hosted.players[0]);
+		sendSnapshot(shard, hosted, hosted.players[1]);
+	}
+}
+
+/*This function is the loop of a shard thread: it sleeps in the selector until a packet arrives or
+the next tick is due.*/
+static void runShard(ServerShard* shard)
+{
+	pinThreadToCore(shard->index);
+
+	sf::Clock clock;
+	sf::Int64 nextTick = TICK_MICROSECONDS;
+	while (shard->server->running)
+	{
+		sf::Int64 now = clock.getElapsedTime().asMicroseconds();
+		if (now < nextTick)
+		{
+			if (shard->selector.wait(sf::microseconds(nextTick - now)))
+				receiveClientPackets(*shard);
+			continue;
+		}
+		if (now - nextTick > MAX_SERVER_TICKS_BEHIND * TICK_MICROSECONDS)
+			nextTick = now;
+
+		receiveClientPackets(*shard);
+		sf::Clock tickClock;
+		tickMatches(*shard);
+		sf::Int64 elapsed = tickClock.getElapsedTime().asMicroseconds();
+
+		int bucket = static_cast<int>(elapsed / TICK_TIME_BUCKET_MICROSECONDS);
+		shard->tickBuckets[bucket < TICK_TIME_BUCKETS ? bucket : TICK_TIME_BUCKETS - 1]++;
+		shard->ticks++;
+		nextTick += TICK_MICROSECONDS;
+	}
+}
+
+/*This function binds one socket per shard and starts the shard threads, one per core.*/
+bool startServer(Server& server, unsigned short basePort, int shardCount, int matchesPerShard)
+{
+	server.shards = new ServerShard[shardCount];
+	server.shardCount = shardCount;
+	server.basePort = basePort;
+	server.running = true;
+
+	for (int i = 0; i < shardCount; ++i)
+	{
+		ServerShard& shard = server.shards[i];
+		shard.server = &server;
+		shard.index = i;
+		if (shard.socket.bind(static_cast<unsigned short>(basePort + i)) != sf::Socket::Done) {
+			std::cout << "Could not bind UDP port " << basePort + i << std::endl;
+			delete[] server.shards;
+			server.shards = NULL;
+			return false;
+		}
+		shard.socket.setBlocking(false);
+		shard.selector.add(shard.socket);
+		shard.matches.reserve(matchesPerShard);
+		shard.waitingMatch = -1;
+		shard.retiredMatches = 0;
+		for (int b = 0; b < TICK_TIME_BUCKETS; ++b)
+			shard.tickBuckets[b] = 0;
+		shard.ticks = 0;
+		shard.bytesSent = 0;
+		shard.fullBytes = 0;
+	}
+
+	for (int i = 0; i < shardCount; ++i)
+	{
+		server.threads.push_back(new sf::Thread(&runShard, &server.shards[i]));
+		server.threads.back()->launch();
+	}
+	return true;
+}
+
+/*This function returns the tick time below which a share of the ticks finished, in microseconds.*/
+static sf::Int64 getTickTimePercentile(const sf::Uint32* buckets, sf::Uint32 count, float percentile)
+{
+	sf::Uint32 target = static_cast<sf::Uint32>(count * percentile);
+	sf::Uint32 seen = 0;
+	for (int i = 0; i < TICK_TIME_BUCKETS; ++i)
+	{
+		seen += buckets[i];
+		if (seen > target)
+			return static_cast<sf::Int64>(i + 1) * TICK_TIME_BUCKET_MICROSECONDS;
+	}
+	return static_cast<sf::Int64>(TICK_TIME_BUCKETS) * TICK_TIME_BUCKET_MICROSECONDS;
+}
+
+/*This function prints the matches each core runs and how long their ticks take. A tick over
+TICK_MICROSECONDS means the shard cannot keep up.*/
+static void printServerReport(const Server& server, std::ostream& out)
+{
+	sf::Uint32 total[TICK_TIME_BUCKETS] = {};
+	sf::Uint32 totalTicks = 0;
+	int totalMatches = 0;
+	sf::Uint32 retiredMatches = 0;
+	sf::Uint64 bytesSent = 0, fullBytes = 0;
+	int watchedMatches = 0;
+	double streamBytesPerTick = 0;	// summed over the watched matches
+	sf::Uint32 redirects = 0, refused = 0;
+
+	out << "SERVER (" << server.shardCount << " cores, tick budget " << TICK_MICROSECONDS << "us)" << std::endl;
+	for (int i = 0; i < server.shardCount; ++i)
+	{
+		const ServerShard& shard = server.shards[i];
+		int matches = 0;
+		for (std::size_t m = 0; m < shard.matches.size(); ++m)
+			matches += (shard.matches[m].playerCount == 2) ? 1 : 0;
+		totalMatches += matches;
+		retiredMatches += shard.retiredMatches;
+		for (int b = 0; b < TICK_TIME_BUCKETS; ++b)
+			total[b] += shard.tickBuckets[b];
+		totalTicks += shard.ticks;
+		bytesSent += shard.bytesSent;
+		fullBytes += shard.fullBytes;
+		for (std::size_t m = 0; m < shard.matches.size(); ++m)
+		{
+			const SpectatorFanout& spectators = shard.matches[m].spectators;
+			redirects += spectators.redirects;
+			refused += spectators.refused;
+			if (spectators.bytesSent == 0 || shard.ticks == 0)
+				continue;
+			watchedMatches++;
+			streamBytesPerTick += static_cast<double>(spectators.bytesSent) / shard.ticks;
+		}
+
+		if (shard.ticks == 0)
+			continue;
+		out << "  core " << i << ": " << matches << " matches, tick p50 " << getTickTimePercentile(shard.tickBuckets, shard.ticks, 0.5f)
+			<< "us p99 " << getTickTimePercentile(shard.tickBuckets, shard.ticks, 0.99f)
+			<< "us, overruns " << shard.tickBuckets[TICK_TIME_BUCKETS - 1]
+			<< ", " << shard.bytesSent / shard.ticks << " bytes sent per tick (" << shard.fullBytes / shard.ticks
+			<< " without delta compression)" << std::endl;
+	}
+	if (totalTicks == 0)
+		return;
+	out << "  all: " << totalMatches << " matches (" << static_cast<float>(totalMatches) / server.shardCount
+		<< " per core), tick p50 " << getTickTimePercentile(total, totalTicks, 0.5f)
+		<< "us p99 " << getTickTimePercentile(total, totalTicks, 0.99f)
+		<< "us p99.9 " << getTickTimePercentile(total, totalTicks, 0.999f) << "us, " << retiredMatches
+		<< " matches retired" << std::endl;
+	if (bytesSent > 0)
+		out << "  snapshots: " << bytesSent << " bytes sent, " << fullBytes << " without delta compression ("
+			<< 100.0 * bytesSent / fullBytes << "%)" << std::endl;
+	if (watchedMatches > 0 || refused > 0)
+		out << "  spectators: " << watchedMatches << " matches watched, "
+			<< (watchedMatches > 0 ? streamBytesPerTick / watchedMatches : 0) << " bytes sent per watched match per tick, "
+			<< redirects << " viewers redirected to relays, " << refused << " refused" << std::endl;
+}
+
+/*This function stops the shard threads, prints the report and frees the shards.*/
+void stopServer(Server& server, std::ostream& report)
+{
+	server.running = false;
+	for (std::size_t i = 0; i < server.threads.size(); ++i)
+	{
+		server.threads[i]->wait();
+		delete server.threads[i];
+	}
+	server.threads.clear();
+
+	printServerReport(server, report);
+	delete[] server.shards;
+	server.shards = NULL;
+}
@@ -0,0 +1,96 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <SFML/Network.hpp>
+#include <atomic>
+#include <map>
+#include <ostream>
+#include <vector>
+#include "Broadcast.h"
+#include "Simulation.h"
+#include "Snapshot.h"
+
+// Messages between clients and the server, the first byte of every packet.
+enum serverMessage {
+	joinMessage,		// client: [u32 client id], asks for a seat in a match
+	welcomeMessage,		// server: [u32 client id][u32 match][u8 player]
+	inputMessage,		// client: [u32 match][u8 player][u32 tick of the newest input][u8 count][count inputs, oldest first]
+						//         [u32 newest snapshot tick, 0 for none]
+	stateMessage,		// server: [u32 client id][u32 newest input applied] then a snapshot, bit packed (see encodeSnapshot)
+	subscribeMessage,	// viewer: [u32 match][u8 1 if relay], asks to be fed the match, repeated to stay fed
+	redirectMessage,	// server or relay: [u32 match][u32 address][u16 port], subscribe there instead
+	inputStreamMessage,	// server or relay: [u32 match][u32 newest tick][u64 state hash after it][u8 count]
+						//                  [count inputs of both players, 6 bits each]
+	keyframeMessage		// server or relay: [u32 match][u32 tick] then the whole match (see writeKeyframe)
+};
+
+const int STATE_HEADER_SIZE = 9;
+const int SERVER_INPUT_BUFFER = 32;		// client inputs waiting for their tick, must be a power of two
+const int MAX_INPUT_BACKLOG = 4;		// inputs further behind than this are dropped to catch up
+const int MAX_INPUTS_PER_MESSAGE = 8;
+const int SEAT_TIMEOUT_TICKS = 5 * TICK_RATE;	// a player not heard from this long has left
+
+const int TICK_TIME_BUCKET_MICROSECONDS = 10;
+const int TICK_TIME_BUCKETS = TICK_MICROSECONDS / TICK_TIME_BUCKET_MICROSECONDS + 1;	// the last one holds overruns
+
+struct ServerClient {
+	sf::IpAddress address;
+	unsigned short port;
+	sf::Uint32 id;
+	sf::Uint8 input;		// input applied on the last tick, applied again until a newer one arrives
+	sf::Uint32 appliedTick;	// client tick of that input
+	sf::Uint32 receivedTick;	// newest client tick received
+	sf::Uint8 inputs[SERVER_INPUT_BUFFER];		// by client tick
+	sf::Uint32 inputTicks[SERVER_INPUT_BUFFER];
+	sf::Uint32 ackedTick;	// newest snapshot the client has, the baseline of the next one
+	sf::Uint32 heardTick;	// shard tick of the newest packet from the client
+};
+
+// A match owned by a shard. It starts ticking once its second player joins, and is retired, its
+// seats freed and its place reused, once both players have left or a round ends with one gone.
+struct HostedMatch {
+	Match match;
+	ServerClient players[2];
+	int playerCount;		// 0 for a retired match
+	sf::Uint32 tick;
+	Snapshot history[SNAPSHOT_HISTORY];	// snapshots sent, by tick, to delta against
+	sf::Uint8 playedInputs[STREAM_REDUNDANCY];	// by tick, for the viewers
+	SpectatorFanout spectators;
+};
+
+struct Server;
+
+// A worker thread with its own socket and its own matches, pinned to one core. Nothing in a
+// shard is shared with the other shards.
+struct ServerShard {
+	Server* server;
+	int index;
+	sf::UdpSocket socket;
+	sf::SocketSelector selector;
+	std::vector<HostedMatch> matches;
+	std::map<sf::Uint32, sf::Uint32> seats;		// client id to match index * 2 + player index
+	int waitingMatch;							// match with one player, -1 if none
+	std::vector<sf::Uint32> freeMatches;		// retired matches, reused before new ones are added
+	sf::Uint32 retiredMatches;
+	sf::Uint32 tickBuckets[TICK_TIME_BUCKETS];	// time to simulate and send every match in one tick
+	sf::Uint32 ticks;
+	sf::Uint64 bytesSent;
+	sf::Uint64 fullBytes;						// what the same states would have cost without delta compression
+	sf::Uint8 sendBuffer[STATE_HEADER_SIZE + MAX_SNAPSHOT_BYTES];
+	sf::Uint8 streamBuffer[MAX_KEYFRAME_BYTES];
+};
+
+// Shard i listens on basePort + i; a client picks a shard and stays on it.
+struct Server {
+	ServerShard* shards;
+	int shardCount;
+	unsigned short basePort;
+	std::vector<sf::Thread*> threads;
+	std::atomic<bool> running;
+};
+
+bool startServer(Server& server, unsigned short basePort, int shardCount, int matchesPerShard);
+void stopServer(Server& server, std::ostream& report);
+void pinThreadToCore(int core);
+
+#endif
@@ -0,0 +1,379 @@
+#include "Simulation.h"
+#include <cmath>
+#include "Overlap.h"
+#include "PixelMask.h"
+
+// Components of each archetype of a match.
+const ComponentMask SHIP_COMPONENTS = (1 << positionComponent) | (1 << fixedPositionComponent) | (1 << gunComponent)
+	| (1 << healthComponent) | (1 << healthBarComponent) | (1 << appearanceComponent);
+const ComponentMask BULLET_COMPONENTS = (1 << positionComponent) | (1 << fixedPositionComponent) | (1 << projectileComponent)
+	| (1 << appearanceComponent);
+
+/*This function sets up a new match: lays out its world, then places the ships.*/
+void initializeMatch(Match &match)
+{
+	clearWorld(match.world);
+	addArchetype(match.world, SHIP_COMPONENTS, SHIPS, COMPONENT_SIZES);
+	addArchetype(match.world, BULLET_COMPONENTS, MAX_BULLETS, COMPONENT_SIZES);
+	match.round = 0;
+	match.fixedPoint = false;
+	initializePlayerSettings(match);
+}
+
+/*This function makes a new match simulate in fixed point. Every peer of a match must agree on it.*/
+void enableFixedPoint(Match &match)
+{
+	match.fixedPoint = true;
+	initializePlayerSettings(match);
+}
+
+/*This function advances the match by one tick with both players' input bits. A finished match
+ignores input and starts over after REMATCH_TICKS, on the same tick for every peer.*/
+void simulateTick(Match &match, sf::Uint8 input1, sf::Uint8 input2)
+{
+	if (isMatchOver(match))
+	{
+		if (++match.ticksOver >= REMATCH_TICKS) {
+			initializePlayerSettings(match);
+			match.round++;
+		}
+		return;
+	}
+	if (match.fixedPoint) {
+		simulateFixedTick(match, input1, input2);
+		return;
+	}
+	movePlayers(match, input1, input2);
+	checkCollisions(match.world);
+	removeBullets(match.world);
+}
+
+/*This function checks if a player died.*/
+bool isMatchOver(const Match &match)
+{
+	const Health* health = getColumn<Health>(match.world, SHIP_ARCHETYPE);
+	return health[0].points <= 0 || health[1].points <= 0;
+}
+
+/*This function compares two matches on everything the next ticks depend on, to find peers that
+went out of sync.*/
+bool isSameMatch(const Match &a, const Match &b)
+{
+	const Position* positionsA = getColumn<Position>(a.world, SHIP_ARCHETYPE);
+	const Position* positionsB = getColumn<Position>(b.world, SHIP_ARCHETYPE);
+	const FixedPosition* fixedA = getColumn<FixedPosition>(a.world, SHIP_ARCHETYPE);
+	const FixedPosition* fixedB = getColumn<FixedPosition>(b.world, SHIP_ARCHETYPE);
+	const Gun* gunsA = getColumn<Gun>(a.world, SHIP_ARCHETYPE);
+	const Gun* gunsB = getColumn<Gun>(b.world, SHIP_ARCHETYPE);
+	const Health* healthA = getColumn<Health>(a.world, SHIP_ARCHETYPE);
+	const Health* healthB = getColumn<Health>(b.world, SHIP_ARCHETYPE);
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		const Gun &p = gunsA[i];
+		const Gun &q = gunsB[i];
+		if (positionsA[i].x != positionsB[i].x || positionsA[i].y != positionsB[i].y || healthA[i].points != healthB[i].points
+			|| p.ticksSinceShot != q.ticksSinceShot || p.cooldownRate != q.cooldownRate || p.startTrigger != q.startTrigger)
+			return false;
+		if (a.fixedPoint && (fixedA[i].x != fixedB[i].x || fixedA[i].y != fixedB[i].y || p.cooldownTicks != q.cooldownTicks))
+			return false;
+	}
+	if (a.fixedPoint != b.fixedPoint)
+		return false;
+	int count = a.world.archetypes[BULLET_ARCHETYPE].count;
+	if (count != b.world.archetypes[BULLET_ARCHETYPE].count || a.ticksOver != b.ticksOver || a.round != b.round)
+		return false;
+	positionsA = getColumn<Position>(a.world, BULLET_ARCHETYPE);
+	positionsB = getColumn<Position>(b.world, BULLET_ARCHETYPE);
+	fixedA = getColumn<FixedPosition>(a.world, BULLET_ARCHETYPE);
+	fixedB = getColumn<FixedPosition>(b.world, BULLET_ARCHETYPE);
+	const Projectile* projectilesA = getColumn<Projectile>(a.world, BULLET_ARCHETYPE);
+	const Projectile* projectilesB = getColumn<Projectile>(b.world, BULLET_ARCHETYPE);
+	for (int i = 0; i < count; ++i)
+	{
+		if (projectilesA[i].owner != projectilesB[i].owner || projectilesA[i].collided != projectilesB[i].collided)
+			return false;
+		if (a.fixedPoint ? (fixedA[i].x != fixedB[i].x || fixedA[i].y != fixedB[i].y)
+			: (positionsA[i].x != positionsB[i].x || positionsA[i].y != positionsB[i].y))
+			return false;
+	}
+	return true;
+}
+
+/*This function returns the player who won a finished match.*/
+int getWinner(const Match &match)
+{
+	return (getColumn<Health>(match.world, SHIP_ARCHETYPE)[0].points <= 0) ? 2 : 1;
+}
+
+/*This function will initialize player settings, such as position, cooldownRate, health etc,
+for both player1 and player2, and clears the bullets.*/
+void initializePlayerSettings(Match &match)
+{
+	World &world = match.world;
+	const int startX[] = { START_X1, START_X2 };
+	const int startY[] = { START_Y1, START_Y2 };
+	const float barY[] = { 0, VIDEO_HEIGHT - HEALTH_BAR_HEIGHT };
+	const sf::Color barColors[] = { sf::Color::Red, sf::Color::Yellow };
+
+	clearArchetype(world, SHIP_ARCHETYPE);
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		int row = addRow(world, SHIP_ARCHETYPE);
+		Position &position = getColumn<Position>(world, SHIP_ARCHETYPE)[row];
+		position.x = static_cast<float>(startX[i]);
+		position.y = static_cast<float>(startY[i]);
+		FixedPosition &fixedPosition = getColumn<FixedPosition>(world, SHIP_ARCHETYPE)[row];
+		fixedPosition.x = toFixed(startX[i]);
+		fixedPosition.y = toFixed(startY[i]);
+		Gun &gun = getColumn<Gun>(world, SHIP_ARCHETYPE)[row];
+		gun.ticksSinceShot = TICK_RATE;	// one second, longer than any cooldown: can shoot right away
+		gun.cooldownRate = MIN_SHOT_COOLDOWN;
+		gun.cooldownTicks = MIN_SHOT_COOLDOWN_TICKS;
+		gun.moved = false;
+		gun.startTrigger = false;
+		Health &health = getColumn<Health>(world, SHIP_ARCHETYPE)[row];
+		health.points = HEALTH;
+		health.hit = false;
+		HealthBar &healthBar = getColumn<HealthBar>(world, SHIP_ARCHETYPE)[row];
+		healthBar.position = sf::Vector2f(0, barY[i]);
+		healthBar.color = barColors[i];
+		getColumn<Appearance>(world, SHIP_ARCHETYPE)[row].type = shipAppearance;
+	}
+
+	// Clear bullets on screen
+	clearArchetype(world, BULLET_ARCHETYPE);
+	match.ticksOver = 0;
+}
+
+/*This function checks if a box stays within the screen after moving by an offset.*/
+bool isInBounds(const sf::FloatRect &bounds, sf::Vector2f offset) {
+	if ((bounds.top + offset.y) < 0) {
+		return false;
+	}
+	if ((bounds.left + offset.x) < 0) {
+		return false;
+	}
+	if ((bounds.left + bounds.width + offset.x) > VIDEO_WIDTH) {
+		return false;
+	}
+	if ((bounds.top + bounds.height + offset.y) > VIDEO_HEIGHT) {
+		return false;
+	}
+	return true;
+}
+
+/*This function handles controls, move the player ships and spawn bullets.*/
+void movePlayers(Match &match, sf::Uint8 input1, sf::Uint8 input2)
+{
+	World &world = match.world;
+	Position* positions = getColumn<Position>(world, SHIP_ARCHETYPE);
+	Gun* guns = getColumn<Gun>(world, SHIP_ARCHETYPE);
+	const sf::Uint8 inputs[] = { input1, input2 };
+	const sf::Uint8 owners[] = { OWNER_PLAYER1, OWNER_PLAYER2 };
+
+	// Move each player and spawn its bullets, player1 first
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		moveShip(positions[i], guns[i], inputs[i]);
+		if (fireShip(guns[i], inputs[i]))
+			addBullet(world, getMuzzlePosition(positions[i], owners[i] == OWNER_PLAYER2), owners[i]);
+	}
+
+	// Update the bullet cooldown rates for both players
+	changeCooldownRates(world);
+}
+
+/*This function moves one ship with its input bits. A ship pressing both directions does not count as moving.*/
+void moveShip(Position &position, Gun &gun, sf::Uint8 input)
+{
+	sf::Vector2f rightBoundary = sf::Vector2f(-SHIP_VELOCITY, 0);
+	sf::Vector2f leftBoundary = sf::Vector2f(SHIP_VELOCITY, 0);
+
+	gun.moved = false;
+	gun.ticksSinceShot++;
+
+	if ((input & INPUT_LEFT) && isInBounds(getShipBounds(position), rightBoundary))
+	{
+		position.x -= SHIP_VELOCITY;
+		gun.moved = true;
+	}
+	if ((input & INPUT_RIGHT) && isInBounds(getShipBounds(position), leftBoundary))
+	{
+		position.x += SHIP_VELOCITY;
+		gun.moved = true;
+	}
+	if ((input & INPUT_LEFT) && (input & INPUT_RIGHT))
+	{
+		gun.moved = false;
+	}
+}
+
+/*This function checks if a ship shoots this tick, and restarts its cooldown if it does.*/
+bool fireShip(Gun &gun, sf::Uint8 input)
+{
+	if (!(input & INPUT_FIRE) || static_cast<float>(gun.ticksSinceShot) / TICK_RATE <= gun.cooldownRate)
+		return false;
+	gun.ticksSinceShot = 0;
+
+	// start bullet decay when bullets are first spawned
+	if (!gun.startTrigger)
+		gun.startTrigger = true;
+	return true;
+}
+
+/*This function returns the box a ship covers. The size is computed the way a scaled sprite
+computes its bounds (right edge minus left edge), so float matches keep the exact bits they had
+when ships were sprites.*/
+sf::FloatRect getShipBounds(const Position &position)
+{
+	return sf::FloatRect(position.x, position.y, (SHIP_WIDTH + position.x) - position.x, (SHIP_HEIGHT + position.y) - position.y);
+}
+
+/*This function returns where a ship's bullets spawn: the middle of its front edge.*/
+sf::Vector2f getMuzzlePosition(const Position &position, bool facingUp)
+{
+	sf::FloatRect bounds = getShipBounds(position);
+	int x = static_cast<int>(position.x + bounds.width / 2);
+	return sf::Vector2f(static_cast<float>(x), facingUp ? bounds.top : bounds.top + bounds.height);
+}
+
+/*This function spawns a bullet that has not moved yet, and returns its row (-1 if the match has
+MAX_BULLETS already, the shot is lost). A fixed point match sets its FixedPosition after.*/
+int addBullet(World &world, sf::Vector2f position, sf::Uint8 owner)
+{
+	int row = addRow(world, BULLET_ARCHETYPE);
+	if (row < 0)
+		return row;
+	Position &bulletPosition = getColumn<Position>(world, BULLET_ARCHETYPE)[row];
+	bulletPosition.x = position.x;
+	bulletPosition.y = position.y;
+	Projectile &projectile = getColumn<Projectile>(world, BULLET_ARCHETYPE)[row];
+	projectile.owner = owner;
+	projectile.collided = false;
+	getColumn<Appearance>(world, BULLET_ARCHETYPE)[row].type = isFacingUp(projectile) ? bulletUpAppearance : bulletDownAppearance;
+	return row;
+}
+
+/*This function returns the box a bullet of a float match covers.*/
+sf::FloatRect getBulletBounds(const Position &position)
+{
+	return sf::FloatRect(position.x, position.y, BULLET_WIDTH, BULLET_HEIGHT);
+}
+
+/*This function checks if the solid pixels of two sprites touch, once their boxes do (see
+SPRITE_MASKS). The offset between them is rounded to whole pixels.*/
+bool pixelsOverlap(int appearance1, const Position &position1, int appearance2, const Position &position2)
+{
+	int dx = static_cast<int>(std::floor(position2.x - position1.x + .5f));
+	int dy = static_cast<int>(std::floor(position2.y - position1.y + .5f));
+	return masksOverlap(SPRITE_MASKS[appearance1], SPRITE_MASKS[appearance2], dx, dy);
+}
+
+/*This function removes collided or out of bounds bullets from the match.*/
+void removeBullets(World &world)
+{
+	const Archetype &bullets = world.archetypes[BULLET_ARCHETYPE];
+	Position* positions = getColumn<Position>(world, BULLET_ARCHETYPE);
+	Projectile* projectiles = getColumn<Projectile>(world, BULLET_ARCHETYPE);
+
+	// Move collided bullets out of the screen and delete from list later (fix with better solution later).
+	// This is part of the tick, not of drawing, so that every peer sees the same bullets.
+	for (int i = 0; i < bullets.count; ++i)
+	{
+		if (projectiles[i].collided) {
+			positions[i].x = 1200;
+			positions[i].y = 1200;
+		}
+	}
+
+	// Remove the oldest bullet if it collided.
+	if (bullets.count > 0 && projectiles[0].collided)
+		removeRow(world, BULLET_ARCHETYPE, 0);
+
+	// Remove old bullets.
+	for (int i = 0; i < bullets.count; ++i)
+	{
+		sf::Vector2f bulletBoundary = isFacingUp(projectiles[i]) ? sf::Vector2f(0, -BULLET_VELOCITY) : sf::Vector2f(0, BULLET_VELOCITY);
+		if (!isInBounds(getBulletBounds(positions[i]), bulletBoundary))
+		{
+			removeRow(world, BULLET_ARCHETYPE, i);
+			break;
+		}
+	}
+}
+
+/*This function checks for three types of collisions in the game: bullet-bullet collision,
+bullet-player1 collision and bullet-player2 collision. Boxes are tested first, the solid pixels
+only of those that overlap.*/
+void checkCollisions(World &world)
+{
+	int count = world.archetypes[BULLET_ARCHETYPE].count;
+	Position* positions = getColumn<Position>(world, BULLET_ARCHETYPE);
+	Projectile* projectiles = getColumn<Projectile>(world, BULLET_ARCHETYPE);
+	const Appearance* appearances = getColumn<Appearance>(world, BULLET_ARCHETYPE);
+	const Position* ships = getColumn<Position>(world, SHIP_ARCHETYPE);
+	Health* health = getColumn<Health>(world, SHIP_ARCHETYPE);
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (isFacingUp(projectiles[i]))
+			positions[i].y -= BULLET_VELOCITY;
+		else
+			positions[i].y += BULLET_VELOCITY;
+	}
+
+	// Compare bullets to check for collision
+	for (int i = 0; i < count; ++i)
+	{
+		// Check for bullet-ship collision, bullets only hit the other player
+		int target = (projectiles[i].owner == OWNER_PLAYER1) ? OWNER_PLAYER2 : OWNER_PLAYER1;
+		if (overlap(getBulletBounds(positions[i]), getShipBounds(ships[target])) &&
+			pixelsOverlap(shipAppearance, ships[target], appearances[i].type, positions[i])) {
+			projectiles[i].collided = true;
+			health[target].hit = true;
+			health[target].points--;
+			continue;
+		}
+
+		// Check for bullet-bullet collision
+		for (int j = 0; j < count; ++j) {
+			// Avoid comparing the same bullet
+			if (i == j)
+				break;
+			// Ignore comparing bullets spawned by same ship
+			if (projectiles[i].owner == projectiles[j].owner)
+				break;
+			if (overlap(getBulletBounds(positions[i]), getBulletBounds(positions[j])) &&
+				pixelsOverlap(appearances[i].type, positions[i], appearances[j].type, positions[j])) {
+				projectiles[i].collided = true;
+				projectiles[j].collided = true;
+			}
+		}
+	}
+}
+
+/*This function speeds up shooting while a player moves and slows it down over time once they started shooting.*/
+void changeCooldownRates(World &world)
+{
+	Gun* guns = getColumn<Gun>(world, SHIP_ARCHETYPE);
+	for (int i = 0; i < world.archetypes[SHIP_ARCHETYPE].count; ++i)
+		updateCooldownRate(guns[i]);
+}
+
+/*This function updates the cooldown of one player, see changeCooldownRates.*/
+void updateCooldownRate(Gun &gun)
+{
+	// Decrease cooldown rate if moving (increase bullet spawn rate).
+	if (gun.moved) {
+		if (gun.cooldownRate > MIN_SHOT_COOLDOWN) {
+			gun.cooldownRate = gun.cooldownRate - (SHOT_COOLDOWN_INC * SHOT_DECAY_MULTIPLIER);
+		}
+	}
+	// Start constant cooldown after first bullet spawned.
+	if (gun.startTrigger)
+	{
+		if (gun.cooldownRate < MAX_SHOT_COOLDOWN) {
+			gun.cooldownRate += SHOT_COOLDOWN_INC;
+		}
+	}
+}
@@ -0,0 +1,107 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <SFML/Graphics.hpp>
+#include "Components.h"
+
+// Gameplay settings.
+const float SHIP_VELOCITY = 20.f;
+const float BULLET_VELOCITY = 10.0f;
+const int HEALTH = 25;
+const int TICK_RATE = 60;	/* gameplay constants are per tick */
+const sf::Int64 TICK_MICROSECONDS = 1000000 / TICK_RATE;
+const int REMATCH_TICKS = TICK_RATE / 2;	/* a finished match stands still this long, then starts over */
+// Health bar settings.
+const int HEALTH_BAR_WIDTH = 40;
+const int HEALTH_BAR_HEIGHT = 10;
+// Playfield (window) settings.
+const int VIDEO_WIDTH = 1000;
+const int VIDEO_HEIGHT = 600;
+// Player sprite and position settings.
+const int START_Y1 = 25;
+const int START_Y2 = 440;
+const int START_X1 = (VIDEO_WIDTH / 2);
+const int START_X2 = START_X1;
+const float SHIP_SCALE_X = .1f;
+const float SHIP_SCALE_Y = .1f;
+const float BULLET_SCALE_X = .10f;
+const float BULLET_SCALE_Y = .10f;
+// Texture sizes, so sprite bounds are right where textures are never loaded (server, headless runs).
+const int SHIP_TEXTURE_WIDTH = 1108;
+const int SHIP_TEXTURE_HEIGHT = 1236;
+const int BULLET_TEXTURE_WIDTH = 311;
+const int BULLET_TEXTURE_HEIGHT = 336;
+const float SHIP_WIDTH = SHIP_TEXTURE_WIDTH * SHIP_SCALE_X;	/* on screen, what a ship's sprite would cover */
+const float SHIP_HEIGHT = SHIP_TEXTURE_HEIGHT * SHIP_SCALE_Y;
+const float BULLET_WIDTH = BULLET_TEXTURE_WIDTH * BULLET_SCALE_X;	/* on screen, what a bullet's sprite would cover */
+const float BULLET_HEIGHT = BULLET_TEXTURE_HEIGHT * BULLET_SCALE_Y;
+// Bullet storage settings.
+const int MAX_BULLETS = 64;	/* bullets in flight at once, far more than two ships can fire; a shot past this is lost */
+// Shot cooldown settings.
+const float MAX_SHOT_COOLDOWN = 0.7f;
+const float MIN_SHOT_COOLDOWN = 0.15f;
+const float SHOT_COOLDOWN_INC = .001f;	/* rate at which bullets slow down (when not moving) */
+const float SHOT_DECAY_MULTIPLIER = 4;
+// Fixed point settings, the same gameplay in Q16.16 with cooldowns counted in ticks.
+const Fixed SHIP_WIDTH_FIXED = SHIP_TEXTURE_WIDTH * FIXED_ONE / 10;		/* texture size times SHIP_SCALE_X (.1) */
+const Fixed SHIP_HEIGHT_FIXED = SHIP_TEXTURE_HEIGHT * FIXED_ONE / 10;
+const Fixed BULLET_WIDTH_FIXED = BULLET_TEXTURE_WIDTH * FIXED_ONE / 10;	/* texture size times BULLET_SCALE_X (.1) */
+const Fixed BULLET_HEIGHT_FIXED = BULLET_TEXTURE_HEIGHT * FIXED_ONE / 10;
+const Fixed MAX_SHOT_COOLDOWN_TICKS = 42 * FIXED_ONE;	/* MAX_SHOT_COOLDOWN * TICK_RATE */
+const Fixed MIN_SHOT_COOLDOWN_TICKS = 9 * FIXED_ONE;	/* MIN_SHOT_COOLDOWN * TICK_RATE */
+const Fixed SHOT_COOLDOWN_INC_TICKS = 3932;				/* SHOT_COOLDOWN_INC * TICK_RATE, .06 ticks */
+// Player input bits, the only thing sent over the network.
+const sf::Uint8 INPUT_LEFT = 1;
+const sf::Uint8 INPUT_RIGHT = 2;
+const sf::Uint8 INPUT_FIRE = 4;
+const sf::Uint8 INPUT_UP = 8;		/* free for all only, duel ships only move sideways */
+const sf::Uint8 INPUT_DOWN = 16;
+
+// Bullet owners, the row of the ship that fired: player1 fires down and player2 fires up.
+const sf::Uint8 OWNER_PLAYER1 = 0;
+const sf::Uint8 OWNER_PLAYER2 = 1;
+// Archetypes of a match, added in this order by initializeMatch.
+const int SHIP_ARCHETYPE = 0;	/* row 0 is player1, row 1 is player2 */
+const int BULLET_ARCHETYPE = 1;	/* oldest first */
+const int SHIPS = 2;
+
+inline bool isFacingUp(const Projectile &projectile)
+{
+	return projectile.owner == OWNER_PLAYER2;
+}
+
+// Everything a tick reads and writes. Ships and bullets are entities of the world: a bullet is a
+// Position, FixedPosition, Projectile and Appearance and nothing else, so the collision passes read
+// many per cache line, and firing or removing one never touches the heap. Copying a Match saves it,
+// assigning one restores it.
+struct Match {
+	World world;
+	int ticksOver;		// ticks since a player died
+	int round;			// matches started before this one
+	bool fixedPoint;	// simulated in integers, bit for bit the same on every machine
+};
+
+void initializeMatch(Match &match);
+void enableFixedPoint(Match &match);
+void initializePlayerSettings(Match &match);
+void simulateTick(Match &match, sf::Uint8 input1, sf::Uint8 input2);
+bool isMatchOver(const Match &match);
+bool isSameMatch(const Match &a, const Match &b);
+int getWinner(const Match &match);
+bool isInBounds(const sf::FloatRect &bounds, sf::Vector2f offset);
+void movePlayers(Match &match, sf::Uint8 input1, sf::Uint8 input2);
+void moveShip(Position &position, Gun &gun, sf::Uint8 input);
+bool fireShip(Gun &gun, sf::Uint8 input);
+sf::FloatRect getShipBounds(const Position &position);
+sf::Vector2f getMuzzlePosition(const Position &position, bool facingUp);
+int addBullet(World &world, sf::Vector2f position, sf::Uint8 owner);
+sf::FloatRect getBulletBounds(const Position &position);
+bool pixelsOverlap(int appearance1, const Position &position1, int appearance2, const Position &position2);
+void checkCollisions(World &world);
+void removeBullets(World &world);
+void changeCooldownRates(World &world);
+void updateCooldownRate(Gun &gun);
+void simulateFixedTick(Match &match, sf::Uint8 input1, sf::Uint8 input2);
+void syncFixedPositions(World &world);
+
+#endif
@@ -0,0 +1,167 @@
+#include "Snapshot.h"
+
+static const Snapshot EMPTY_SNAPSHOT = {};	// a snapshot sent without baseline is a delta against it
+
+/*This function turns a position into half pixels, clamped to what POSITION_BITS can hold.*/
+static sf::Uint16 quantizePosition(float position)
+{
+	float scaled = position * POSITION_SCALE + 0.5f;
+	if (scaled < 0)
+		return 0;
+	if (scaled > (1 << POSITION_BITS) - 1)
+		return (1 << POSITION_BITS) - 1;
+	return static_cast<sf::Uint16>(scaled);
+}
+
+/*This function checks if a bullet is a baseline bullet that kept flying for age ticks, which is
+what most bullets do between two snapshots.*/
+static bool isMovedBullet(const SnapshotBullet& before, const SnapshotBullet& after, int age)
+{
+	int step = static_cast<int>(BULLET_VELOCITY) * POSITION_SCALE * age;
+	int y = before.facingUp ? before.y - step : before.y + step;
+	return before.facingUp == after.facingUp && before.x == after.x && y == after.y;
+}
+
+static void writeDeltaField(BitWriter& writer, sf::Uint32 value, sf::Uint32 baseline, int bits)
+{
+	writeBits(writer, value != baseline, 1);
+	if (value != baseline)
+		writeBits(writer, value, bits);
+}
+
+static sf::Uint32 readDeltaField(BitReader& reader, sf::Uint32 baseline, int bits)
+{
+	return readBits(reader, 1) ? readBits(reader, bits) : baseline;
+}
+
+/*This function empties a snapshot. The tick is set to one no baseline can have, so a history
+of cleared snapshots holds no baseline.*/
+void clearSnapshot(Snapshot& snapshot)
+{
+	snapshot = EMPTY_SNAPSHOT;
+	snapshot.tick = 0xFFFFFFFF;
+}
+
+/*This function quantizes the parts of a match a client draws.*/
+void takeSnapshot(Snapshot& snapshot, const Match& match, sf::Uint32 tick)
+{
+	const World& world = match.world;
+	const Position* positions = getColumn<Position>(world, SHIP_ARCHETYPE);
+	const Health* health = getColumn<Health>(world, SHIP_ARCHETYPE);
+	snapshot.tick = tick;
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		snapshot.ships[i].x = quantizePosition(positions[i].x);
+		snapshot.ships[i].y = quantizePosition(positions[i].y);
+		snapshot.ships[i].health = static_cast<sf::Uint8>(health[i].points < 0 ? 0 : health[i].points);
+	}
+
+	int count = world.archetypes[BULLET_ARCHETYPE].count;
+	positions = getColumn<Position>(world, BULLET_ARCHETYPE);
+	const Projectile* projectiles = getColumn<Projectile>(world, BULLET_ARCHETYPE);
+	snapshot.bulletCount = 0;
+	for (int i = 0; i < count && snapshot.bulletCount < MAX_SNAPSHOT_BULLETS; ++i)
+	{
+		SnapshotBullet& bullet = snapshot.bullets[snapshot.bulletCount++];
+		bullet.x = quantizePosition(positions[i].x);
+		bullet.y = quantizePosition(positions[i].y);
+		bullet.facingUp = isFacingUp(projectiles[i]);
+	}
+}
+
+/*This function writes a snapshot as changes against a baseline the client already has (NULL for
+none). Ship fields are only written when they changed. A bullet that just kept flying since a
+baseline bullet costs 3 bits: a flag and how many baseline bullets before it are gone.*/
+void encodeSnapshot(BitWriter& writer, const Snapshot& snapshot, const Snapshot* baseline)
+{
+	if (baseline != NULL && snapshot.tick - baseline->tick >= static_cast<sf::Uint32>(1 << SNAPSHOT_AGE_BITS))
+		baseline = NULL;
+	int age = baseline ? static_cast<int>(snapshot.tick - baseline->tick) : 0;
+	if (baseline == NULL)
+		baseline = &EMPTY_SNAPSHOT;
+
+	writeBits(writer, snapshot.tick, 32);
+	writeBits(writer, age, SNAPSHOT_AGE_BITS);
+	for (int i = 0; i < 2; ++i)
+	{
+		writeDeltaField(writer, snapshot.ships[i].x, baseline->ships[i].x, POSITION_BITS);
+		writeDeltaField(writer, snapshot.ships[i].y, baseline->ships[i].y, POSITION_BITS);
+		writeDeltaField(writer, snapshot.ships[i].health, baseline->ships[i].health, HEALTH_BITS);
+	}
+
+	writeBits(writer, snapshot.bulletCount, BULLET_COUNT_BITS);
+	int cursor = 0;		// first baseline bullet not matched yet, bullets keep their order
+	for (int i = 0; i < snapshot.bulletCount; ++i)
+	{
+		const SnapshotBullet& bullet = snapshot.bullets[i];
+		int skip = -1;
+		for (int k = 0; k < (1 << BULLET_SKIP_BITS) && cursor + k < baseline->bulletCount; ++k)
+		{
+			if (isMovedBullet(baseline->bullets[cursor + k], bullet, age)) {
+				skip = k;
+				break;
+			}
+		}
+
+		if (skip >= 0) {
+			writeBits(writer, 1, 1);
+			writeBits(writer, skip, BULLET_SKIP_BITS);
+			cursor += skip + 1;
+		}
+		else {
+			writeBits(writer, 0, 1);
+			writeBits(writer, bullet.x, POSITION_BITS);
+			writeBits(writer, bullet.y, POSITION_BITS);
+			writeBits(writer, bullet.facingUp, 1);
+		}
+	}
+}
+
+/*This function reads a snapshot written by encodeSnapshot. Baselines are looked up in history,
+indexed by tick modulo SNAPSHOT_HISTORY; snapshot must not be one of them. Fails if the baseline
+is no longer there or the data is cut short.*/
+bool decodeSnapshot(BitReader& reader, Snapshot& snapshot, const Snapshot* history)
+{
+	snapshot.tick = readBits(reader, 32);
+	int age = static_cast<int>(readBits(reader, SNAPSHOT_AGE_BITS));
+	const Snapshot* baseline = &EMPTY_SNAPSHOT;
+	if (age != 0) {
+		baseline = &history[(snapshot.tick - age) & (SNAPSHOT_HISTORY - 1)];
+		if (baseline->tick != snapshot.tick - age)
+			return false;
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		snapshot.ships[i].x = static_cast<sf::Uint16>(readDeltaField(reader, baseline->ships[i].x, POSITION_BITS));
+		snapshot.ships[i].y = static_cast<sf::Uint16>(readDeltaField(reader, baseline->ships[i].y, POSITION_BITS));
+		snapshot.ships[i].health = static_cast<sf::Uint8>(readDeltaField(reader, baseline->ships[i].health, HEALTH_BITS));
+	}
+
+	snapshot.bulletCount = static_cast<int>(readBits(reader, BULLET_COUNT_BITS));
+	if (snapshot.bulletCount > MAX_SNAPSHOT_BULLETS)
+		return false;
+	int cursor = 0;
+	for (int i = 0; i < snapshot.bulletCount; ++i)
+	{
+		SnapshotBullet& bullet = snapshot.bullets[i];
+		if (readBits(reader, 1))
+		{
+			cursor += static_cast<int>(readBits(reader, BULLET_SKIP_BITS));
+			if (cursor >= baseline->bulletCount)
+				return false;
+			const SnapshotBullet& before = baseline->bullets[cursor++];
+			int step = static_cast<int>(BULLET_VELOCITY) * POSITION_SCALE * age;
+			bullet.x = before.x;
+			bullet.y = static_cast<sf::Uint16>(before.facingUp ? before.y - step : before.y + step);
+			bullet.facingUp = before.facingUp;
+		}
+		else
+		{
+			bullet.x = static_cast<sf::Uint16>(readBits(reader, POSITION_BITS));
+			bullet.y = static_cast<sf::Uint16>(readBits(reader, POSITION_BITS));
+			bullet.facingUp = readBits(reader, 1) != 0;
+		}
+	}
+	return !reader.overflow;
+}
@@ -0,0 +1,43 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "BitStream.h"
+#include "Simulation.h"
+
+// Snapshot settings.
+const int POSITION_SCALE = 2;			// positions are sent in half pixels
+const int POSITION_BITS = 11;			// up to 1023.5 pixels, more than the playfield
+const int HEALTH_BITS = 8;
+const int MAX_SNAPSHOT_BULLETS = 64;	// bullets past this many are not sent
+const int BULLET_COUNT_BITS = 7;
+const int BULLET_SKIP_BITS = 2;			// baseline bullets that may have disappeared between two matches
+const int SNAPSHOT_HISTORY = 32;		// snapshots kept to delta against, must be a power of two
+const int SNAPSHOT_AGE_BITS = 5;		// age of the baseline in ticks, 0 for none
+const int MAX_SNAPSHOT_BYTES = 256;		// worst case is about 210 bytes
+
+struct SnapshotShip {
+	sf::Uint16 x;
+	sf::Uint16 y;
+	sf::Uint8 health;
+};
+
+struct SnapshotBullet {
+	sf::Uint16 x;
+	sf::Uint16 y;
+	bool facingUp;
+};
+
+// What a client sees of a match, quantized the way it is sent.
+struct Snapshot {
+	sf::Uint32 tick;
+	SnapshotShip ships[2];
+	int bulletCount;
+	SnapshotBullet bullets[MAX_SNAPSHOT_BULLETS];
+};
+
+void clearSnapshot(Snapshot& snapshot);
+void takeSnapshot(Snapshot& snapshot, const Match& match, sf::Uint32 tick);
+void encodeSnapshot(BitWriter& writer, const Snapshot& snapshot, const Snapshot* baseline);
+bool decodeSnapshot(BitReader& reader, Snapshot& snapshot, const Snapshot* history);
+
+#endif
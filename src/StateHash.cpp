@@ -0,0 +1,210 @@
+#include "StateHash.h"
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// FNV-1a, a 32 bit word at a time, then a final mix so that every input bit reaches the whole hash.
+const sf::Uint64 HASH_OFFSET = 14695981039346656037ULL;
+const sf::Uint64 HASH_PRIME = 1099511628211ULL;
+
+static sf::Uint32 getFloatBits(float value)
+{
+	sf::Uint32 bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static void hashWord(sf::Uint64 &hash, sf::Uint32 word)
+{
+	hash = (hash ^ word) * HASH_PRIME;
+}
+
+/*This function hashes everything the next ticks depend on, floats by their exact bits. A fixed
+point match is hashed by its integers, the floats there only follow them. The fields and their
+order are the ones of listStateFields, keep both the same.*/
+sf::Uint64 hashMatch(const Match &match)
+{
+	sf::Uint64 hash = HASH_OFFSET;
+	bool fixed = match.fixedPoint;
+	hashWord(hash, fixed);
+	hashWord(hash, static_cast<sf::Uint32>(match.ticksOver));
+	hashWord(hash, static_cast<sf::Uint32>(match.round));
+	const World &world = match.world;
+	const Position* positions = getColumn<Position>(world, SHIP_ARCHETYPE);
+	const FixedPosition* fixedPositions = getColumn<FixedPosition>(world, SHIP_ARCHETYPE);
+	const Gun* guns = getColumn<Gun>(world, SHIP_ARCHETYPE);
+	const Health* health = getColumn<Health>(world, SHIP_ARCHETYPE);
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		hashWord(hash, fixed ? static_cast<sf::Uint32>(fixedPositions[i].x) : getFloatBits(positions[i].x));
+		hashWord(hash, fixed ? static_cast<sf::Uint32>(fixedPositions[i].y) : getFloatBits(positions[i].y));
+		hashWord(hash, static_cast<sf::Uint32>(guns[i].ticksSinceShot));
+		hashWord(hash, static_cast<sf::Uint32>(health[i].points));
+		hashWord(hash, health[i].hit);
+		hashWord(hash, fixed ? static_cast<sf::Uint32>(guns[i].cooldownTicks) : getFloatBits(guns[i].cooldownRate));
+		hashWord(hash, guns[i].moved);
+		hashWord(hash, guns[i].startTrigger);
+	}
+	int count = world.archetypes[BULLET_ARCHETYPE].count;
+	positions = getColumn<Position>(world, BULLET_ARCHETYPE);
+	fixedPositions = getColumn<FixedPosition>(world, BULLET_ARCHETYPE);
+	const Projectile* projectiles = getColumn<Projectile>(world, BULLET_ARCHETYPE);
+	hashWord(hash, static_cast<sf::Uint32>(count));
+	for (int i = 0; i < count; ++i)
+	{
+		hashWord(hash, fixed ? static_cast<sf::Uint32>(fixedPositions[i].x) : getFloatBits(positions[i].x));
+		hashWord(hash, fixed ? static_cast<sf::Uint32>(fixedPositions[i].y) : getFloatBits(positions[i].y));
+		hashWord(hash, projectiles[i].owner);
+		hashWord(hash, projectiles[i].collided);
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+static void addField(std::vector<StateField> &fields, const std::string &name, int value)
+{
+	StateField field;
+	field.name = name;
+	std::ostringstream text;
+	text << value;
+	field.value = text.str();
+	field.bits = static_cast<sf::Uint32>(value);
+	fields.push_back(field);
+}
+
+static void addField(std::vector<StateField> &fields, const std::string &name, float value)
+{
+	StateField field;
+	field.name = name;
+	std::ostringstream text;
+	text << std::setprecision(9) << value;
+	field.value = text.str();
+	field.bits = getFloatBits(value);
+	fields.push_back(field);
+}
+
+static void addFixedField(std::vector<StateField> &fields, const std::string &name, Fixed value)
+{
+	StateField field;
+	field.name = name;
+	std::ostringstream text;
+	text << fixedFloor(value) << "+" << (value & (FIXED_ONE - 1)) << "/" << FIXED_ONE;
+	field.value = text.str();
+	field.bits = static_cast<sf::Uint32>(value);
+	fields.push_back(field);
+}
+
+/*This function lists the hashed state one value at a time, named so two lists can be diffed.*/
+void listStateFields(const Match &match, std::vector<StateField> &fields)
+{
+	fields.clear();
+	bool fixed = match.fixedPoint;
+	addField(fields, "fixedPoint", fixed ? 1 : 0);
+	addField(fields, "ticksOver", match.ticksOver);
+	addField(fields, "round", match.round);
+	const World &world = match.world;
+	const Position* positions = getColumn<Position>(world, SHIP_ARCHETYPE);
+	const FixedPosition* fixedPositions = getColumn<FixedPosition>(world, SHIP_ARCHETYPE);
+	const Gun* guns = getColumn<Gun>(world, SHIP_ARCHETYPE);
+	const Health* health = getColumn<Health>(world, SHIP_ARCHETYPE);
+	for (int i = 0; i < SHIPS; ++i)
+	{
+		std::string prefix = (i == 0) ? "player1." : "player2.";
+		if (fixed) {
+			addFixedField(fields, prefix + "x", fixedPositions[i].x);
+			addFixedField(fields, prefix + "y", fixedPositions[i].y);
+		}
+		else {
+			addField(fields, prefix + "x", positions[i].x);
+			addField(fields, prefix + "y", positions[i].y);
+		}
+		addField(fields, prefix + "ticksSinceShot", guns[i].ticksSinceShot);
+		addField(fields, prefix + "health", health[i].points);
+		addField(fields, prefix + "playerHit", health[i].hit ? 1 : 0);
+		if (fixed)
+			addFixedField(fields, prefix + "cooldownTicks", guns[i].cooldownTicks);
+		else
+			addField(fields, prefix + "cooldownRate", guns[i].cooldownRate);
+		addField(fields, prefix + "moved", guns[i].moved ? 1 : 0);
+		addField(fields, prefix + "startTrigger", guns[i].startTrigger ? 1 : 0);
+	}
+	int count = world.archetypes[BULLET_ARCHETYPE].count;
+	positions = getColumn<Position>(world, BULLET_ARCHETYPE);
+	fixedPositions = getColumn<FixedPosition>(world, BULLET_ARCHETYPE);
+	const Projectile* projectiles = getColumn<Projectile>(world, BULLET_ARCHETYPE);
+	addField(fields, "bullets", count);
+	for (int i = 0; i < count; ++i)
+	{
+		std::ostringstream prefix;
+		prefix << "bullet" << i << ".";
+		if (fixed) {
+			addFixedField(fields, prefix.str() + "x", fixedPositions[i].x);
+			addFixedField(fields, prefix.str() + "y", fixedPositions[i].y);
+		}
+		else {
+			addField(fields, prefix.str() + "x", positions[i].x);
+			addField(fields, prefix.str() + "y", positions[i].y);
+		}
+		addField(fields, prefix.str() + "owner", static_cast<int>(projectiles[i].owner));
+		addField(fields, prefix.str() + "collided", projectiles[i].collided ? 1 : 0);
+	}
+}
+
+static void writeField(const StateField &field, std::ostream &out)
+{
+	out << field.name << " " << field.value << " (0x" << std::hex << std::setw(8) << std::setfill('0') << field.bits
+		<< std::dec << std::setfill(' ') << ")";
+}
+
+/*This function writes the state one field per line, so the dumps of two machines can be diffed.*/
+void writeMatchState(const Match &match, std::ostream &out)
+{
+	std::vector<StateField> fields;
+	listStateFields(match, fields);
+	out << "hash " << std::hex << hashMatch(match) << std::dec << std::endl;
+	for (std::size_t i = 0; i < fields.size(); ++i)
+	{
+		writeField(fields[i], out);
+		out << std::endl;
+	}
+}
+
+/*This function writes the state to a file, see writeMatchState.*/
+bool dumpMatchState(const Match &match, const std::string &path)
+{
+	std::ofstream file(path.c_str());
+	if (!file)
+		return false;
+	writeMatchState(match, file);
+	return true;
+}
+
+/*This function prints the fields that differ between two states. Bullets are compared in list
+order, so a missing bullet shows as every later bullet differing.*/
+void printMatchDiff(const Match &a, const Match &b, std::ostream &out)
+{
+	std::vector<StateField> fieldsA, fieldsB;
+	listStateFields(a, fieldsA);
+	listStateFields(b, fieldsB);
+	std::size_t count = fieldsA.size() > fieldsB.size() ? fieldsA.size() : fieldsB.size();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (i < fieldsA.size() && i < fieldsB.size() && fieldsA[i].bits == fieldsB[i].bits)
+			continue;
+		out << "  ";
+		if (i < fieldsA.size())
+			writeField(fieldsA[i], out);
+		else
+			out << fieldsB[i].name << " missing";
+		out << " | ";
+		if (i < fieldsB.size())
+			writeField(fieldsB[i], out);
+		else
+			out << fieldsA[i].name << " missing";
+		out << std::endl;
+	}
+}
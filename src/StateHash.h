@@ -0,0 +1,23 @@
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+#include <SFML/Config.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Simulation.h"
+
+// One value of the canonical state, for dumps and diffs.
+struct StateField {
+	std::string name;
+	std::string value;
+	sf::Uint32 bits;	// exact bits, floats included
+};
+
+sf::Uint64 hashMatch(const Match &match);
+void listStateFields(const Match &match, std::vector<StateField> &fields);
+void writeMatchState(const Match &match, std::ostream &out);
+bool dumpMatchState(const Match &match, const std::string &path);
+void printMatchDiff(const Match &a, const Match &b, std::ostream &out);
+
+#endif
@@ -0,0 +1,69 @@
+#include "TextCache.h"
+
+/*This function rasterizes every character of the given set into the font's atlas page for
+characterSize, so no glyph is ever rendered by FreeType once the game is running.*/
+void bakeGlyphAtlas(const sf::Font& font, unsigned int characterSize, const std::string& characters)
+{
+	for (std::string::size_type i = 0; i < characters.size(); ++i)
+		font.getGlyph(static_cast<unsigned char>(characters[i]), characterSize, false);
+}
+
+/*This function lays out a single line of text into quads, the same way sf::Text does,
+and remembers the atlas page the texture coordinates refer to.*/
+void bakeText(CachedText& text, const sf::Font& font, const std::string& string, unsigned int characterSize, sf::Color color)
+{
+	// Make sure every glyph is in the atlas before the page texture is referenced.
+	bakeGlyphAtlas(font, characterSize, string);
+
+	text.vertices.clear();
+	text.vertices.setPrimitiveType(sf::Triangles);
+	text.texture = &font.getTexture(characterSize);
+
+	float x = 0.f;
+	float y = static_cast<float>(characterSize);	// baseline of the first line
+	sf::Uint32 previous = 0;
+
+	for (std::string::size_type i = 0; i < string.size(); ++i)
+	{
+		sf::Uint32 current = static_cast<unsigned char>(string[i]);
+		x += font.getKerning(previous, current, characterSize);
+		previous = current;
+
+		const sf::Glyph& glyph = font.getGlyph(current, characterSize, false);
+
+		float left = x + glyph.bounds.left;
+		float top = y + glyph.bounds.top;
+		float right = left + glyph.bounds.width;
+		float bottom = top + glyph.bounds.height;
+
+		float u1 = static_cast<float>(glyph.textureRect.left);
+		float v1 = static_cast<float>(glyph.textureRect.top);
+		float u2 = static_cast<float>(glyph.textureRect.left + glyph.textureRect.width);
+		float v2 = static_cast<float>(glyph.textureRect.top + glyph.textureRect.height);
+
+		// Two triangles per glyph; whitespace produces empty quads which are harmless.
+		text.vertices.append(sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(u1, v1)));
+		text.vertices.append(sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(u2, v1)));
+		text.vertices.append(sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(u1, v2)));
+		text.vertices.append(sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(u1, v2)));
+		text.vertices.append(sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(u2, v1)));
+		text.vertices.append(sf::Vertex(sf::Vector2f(right, bottom), color, sf::Vector2f(u2, v2)));
+
+		x += glyph.advance;
+	}
+}
+
+/*This function places baked text on screen.*/
+void setCachedTextPosition(CachedText& text, float x, float y)
+{
+	text.transform = sf::Transform::Identity;
+	text.transform.translate(x, y);
+}
+
+/*This function draws baked text with one draw call.*/
+void drawCachedText(sf::RenderTarget& target, const CachedText& text)
+{
+	sf::RenderStates states(text.transform);
+	states.texture = text.texture;
+	target.draw(text.vertices, states);
+}
@@ -0,0 +1,20 @@
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include <SFML/Graphics.hpp>
+#include <string>
+
+// A string laid out once into textured quads. Drawing it is a single
+// vertex array draw: no FreeType lookups and no geometry rebuild per frame.
+struct CachedText {
+	sf::VertexArray vertices;
+	const sf::Texture* texture;	// glyph atlas page of the font at the baked size
+	sf::Transform transform;
+};
+
+void bakeGlyphAtlas(const sf::Font& font, unsigned int characterSize, const std::string& characters);
+void bakeText(CachedText& text, const sf::Font& font, const std::string& string, unsigned int characterSize, sf::Color color);
+void setCachedTextPosition(CachedText& text, float x, float y);
+void drawCachedText(sf::RenderTarget& target, const CachedText& text);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+const unsigned int TRIPLE_BUFFER_SLOT_MASK = 3;
+const unsigned int TRIPLE_BUFFER_NEW_BIT = 4;	/* the middle slot was published since the reader last took it */
+
+// Three slots handed from one writer thread to one reader thread without a lock. The writer fills
+// its back slot and swaps it with the middle one; the reader swaps the middle one for its front
+// slot when it is newer. The writer never waits on the reader, the reader always gets the newest
+// slot published, and a slot is never written while the reader has it. A reader with nothing else
+// to do can sleep until the next publish, see waitForFrontSlot: only then does a publish take the
+// mutex, to wake it, and the reader never holds it for more than its check of the middle slot.
+template <typename T>
+struct TripleBuffer {
+	T slots[3];
+	std::atomic<unsigned int> middle;	// index of the middle slot, with TRIPLE_BUFFER_NEW_BIT
+	unsigned int back;		// only used by the writer
+	unsigned int front;		// only used by the reader
+	std::atomic<bool> sleeping;	// the reader is in waitForFrontSlot
+	std::mutex mutex;		// only guards the sleep of the reader, never a slot
+	std::condition_variable published;
+};
+
+template <typename T>
+void initializeTripleBuffer(TripleBuffer<T>& buffer)
+{
+	buffer.back = 0;
+	buffer.middle = 1;
+	buffer.front = 2;
+	buffer.sleeping = false;
+}
+
+/*This function returns the slot the writer fills next. It holds whatever was published two
+publishes ago, the writer overwrites all of it.*/
+template <typename T>
+T& getBackSlot(TripleBuffer<T>& buffer)
+{
+	return buffer.slots[buffer.back];
+}
+
+/*This function hands the back slot to the reader, and takes the middle one (never the reader's)
+as the next back slot. A reader asleep in waitForFrontSlot is woken. Both sides write their own
+atomic then read the other's, all sequentially consistent, so either the reader sees the new slot
+or the writer sees it sleeping; taking the mutex before notifying keeps the wake up from landing
+between the reader's check and its sleep.*/
+template <typename T>
+void publishBackSlot(TripleBuffer<T>& buffer)
+{
+	unsigned int previous = buffer.middle.exchange(buffer.back | TRIPLE_BUFFER_NEW_BIT);
+	buffer.back = previous & TRIPLE_BUFFER_SLOT_MASK;
+	if (!buffer.sleeping.load())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+	}
+	buffer.published.notify_one();
+}
+
+/*This function makes the newest published slot the front slot, if one was published since the
+last call, and returns whether it did.*/
+template <typename T>
+bool acquireFrontSlot(TripleBuffer<T>& buffer)
+{
+	if (!(buffer.middle.load(std::memory_order_acquire) & TRIPLE_BUFFER_NEW_BIT))
+		return false;
+	unsigned int previous = buffer.middle.exchange(buffer.front, std::memory_order_acq_rel);
+	buffer.front = previous & TRIPLE_BUFFER_SLOT_MASK;
+	return true;
+}
+
+/*This function sleeps until a slot is published, unless one already was since the last call, and
+makes it the front slot.*/
+template <typename T>
+void waitForFrontSlot(TripleBuffer<T>& buffer)
+{
+	if (acquireFrontSlot(buffer))
+		return;
+	{
+		std::unique_lock<std::mutex> lock(buffer.mutex);
+		buffer.sleeping.store(true);
+		while (!(buffer.middle.load() & TRIPLE_BUFFER_NEW_BIT))
+			buffer.published.wait(lock);
+		buffer.sleeping.store(false);
+	}
+	acquireFrontSlot(buffer);
+}
+
+/*This function returns the slot the reader has, see acquireFrontSlot.*/
+template <typename T>
+T& getFrontSlot(TripleBuffer<T>& buffer)
+{
+	return buffer.slots[buffer.front];
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include "World.h"
+#include <cstring>
+
+/*This function removes every archetype, so the world can be laid out again.*/
+void clearWorld(World& world)
+{
+	world.archetypeCount = 0;
+	world.storage.clear();
+}
+
+/*This function adds an archetype with room for capacity entities, and returns its index (-1 if
+the world has MAX_ARCHETYPES already). componentSizes has the size of each component by id.
+Adding archetypes allocates, so it is done once when a world is set up.*/
+int addArchetype(World& world, ComponentMask mask, int capacity, const std::size_t componentSizes[])
+{
+	if (world.archetypeCount == MAX_ARCHETYPES)
+		return -1;
+	Archetype& table = world.archetypes[world.archetypeCount];
+	table.mask = mask;
+	table.capacity = capacity;
+	table.count = 0;
+	std::size_t words = world.storage.size();
+	for (int i = 0; i < MAX_COMPONENT_TYPES; ++i)
+	{
+		table.columns[i] = 0;
+		table.sizes[i] = 0;
+		if (mask & (static_cast<ComponentMask>(1) << i)) {
+			table.columns[i] = words;
+			table.sizes[i] = componentSizes[i];
+			words += (componentSizes[i] * capacity + sizeof(sf::Uint64) - 1) / sizeof(sf::Uint64);
+		}
+	}
+	world.storage.resize(words);
+	return world.archetypeCount++;
+}
+
+/*This function returns the byte address of a value in a column.*/
+static unsigned char* getValue(World& world, const Archetype& table, int component, int row)
+{
+	return reinterpret_cast<unsigned char*>(&world.storage[table.columns[component]]) + table.sizes[component] * row;
+}
+
+/*This function adds an entity to an archetype and returns its row, or -1 if the archetype is full.
+The components of the new row are zeroed, the caller sets them.*/
+int addRow(World& world, int archetype)
+{
+	Archetype& table = world.archetypes[archetype];
+	if (table.count == table.capacity)
+		return -1;
+	for (int i = 0; i < MAX_COMPONENT_TYPES; ++i)
+	{
+		if (table.sizes[i] > 0)
+			std::memset(getValue(world, table, i, table.count), 0, table.sizes[i]);
+	}
+	return table.count++;
+}
+
+/*This function removes an entity. The later rows move down by one, so the rows keep the order
+they were added in: the simulation depends on it, the oldest bullet is always row 0.*/
+void removeRow(World& world, int archetype, int row)
+{
+	Archetype& table = world.archetypes[archetype];
+	if (row < 0 || row >= table.count)
+		return;
+	for (int i = 0; i < MAX_COMPONENT_TYPES; ++i)
+	{
+		if (table.sizes[i] > 0)
+			std::memmove(getValue(world, table, i, row), getValue(world, table, i, row + 1), table.sizes[i] * (table.count - row - 1));
+	}
+	table.count--;
+}
+
+/*This function copies every component of a row over another row of the same archetype. Removing
+many rows at once is a single pass that copies the rows kept down, then truncateArchetype.*/
+void copyRow(World& world, int archetype, int from, int to)
+{
+	const Archetype& table = world.archetypes[archetype];
+	for (int i = 0; i < MAX_COMPONENT_TYPES; ++i)
+	{
+		if (table.sizes[i] > 0)
+			std::memcpy(getValue(world, table, i, to), getValue(world, table, i, from), table.sizes[i]);
+	}
+}
+
+/*This function removes the rows from count on.*/
+void truncateArchetype(World& world, int archetype, int count)
+{
+	if (count < world.archetypes[archetype].count)
+		world.archetypes[archetype].count = count;
+}
+
+void clearArchetype(World& world, int archetype)
+{
+	world.archetypes[archetype].count = 0;
+}
+
+bool hasComponents(const World& world, int archetype, ComponentMask mask)
+{
+	return (world.archetypes[archetype].mask & mask) == mask;
+}
+
+/*This function copies a world. Only the rows in use are copied, and the storage is only resized
+when the two worlds were laid out differently.*/
+World& World::operator=(const World& other)
+{
+	if (this == &other)
+		return *this;
+	if (storage.size() != other.storage.size())
+		storage.resize(other.storage.size());
+	archetypeCount = other.archetypeCount;
+	for (int archetype = 0; archetype < archetypeCount; ++archetype)
+	{
+		const Archetype& table = other.archetypes[archetype];
+		archetypes[archetype] = table;
+		for (int i = 0; i < MAX_COMPONENT_TYPES; ++i)
+		{
+			if (table.sizes[i] > 0 && table.count > 0)
+				std::memcpy(&storage[table.columns[i]], &other.storage[table.columns[i]], table.sizes[i] * table.count);
+		}
+	}
+	return *this;
+}
@@ -0,0 +1,86 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <SFML/Config.hpp>
+#include <cstddef>
+#include <vector>
+
+// Entity settings.
+const int MAX_COMPONENT_TYPES = 16;
+const int MAX_ARCHETYPES = 4;
+
+typedef sf::Uint32 ComponentMask;	// one bit per component id
+
+// Every entity with the same components is a row of the same archetype. Each component of the
+// archetype is a column, an array of capacity values in the world's storage, so a system walking
+// one component of many entities reads memory front to back and never loads the others.
+struct Archetype {
+	ComponentMask mask;
+	int capacity;
+	int count;
+	std::size_t columns[MAX_COMPONENT_TYPES];	// offset of each column in the storage, in words
+	std::size_t sizes[MAX_COMPONENT_TYPES];	// bytes of one value of each column
+};
+
+// A set of archetypes, laid out once when they are added. Components are plain data: rows move
+// with memmove and a copy of the world copies the rows in use, nothing is constructed. Assigning
+// a world to one with the same archetypes never allocates, so rollback saves don't either.
+struct World {
+	Archetype archetypes[MAX_ARCHETYPES];
+	int archetypeCount;
+	std::vector<sf::Uint64> storage;	// words, so every column is 8 byte aligned
+
+	World() : archetypeCount(0) {}
+	World(const World& other) : archetypeCount(0) { *this = other; }
+	World& operator=(const World& other);
+};
+
+void clearWorld(World& world);
+int addArchetype(World& world, ComponentMask mask, int capacity, const std::size_t componentSizes[]);
+int addRow(World& world, int archetype);
+void removeRow(World& world, int archetype, int row);
+void copyRow(World& world, int archetype, int from, int to);
+void truncateArchetype(World& world, int archetype, int count);
+void clearArchetype(World& world, int archetype);
+bool hasComponents(const World& world, int archetype, ComponentMask mask);
+
+/*This function returns the mask of a component type, see getColumn.*/
+template <typename T>
+ComponentMask componentBit()
+{
+	return static_cast<ComponentMask>(1) << T::COMPONENT;
+}
+
+/*This function returns the column of a component in an archetype, one value per row, or NULL if
+the archetype does not have it. T is a component struct with a COMPONENT id.*/
+template <typename T>
+T* getColumn(World& world, int archetype)
+{
+	const Archetype& table = world.archetypes[archetype];
+	if (!(table.mask & componentBit<T>()))
+		return NULL;
+	return reinterpret_cast<T*>(&world.storage[table.columns[T::COMPONENT]]);
+}
+
+template <typename T>
+const T* getColumn(const World& world, int archetype)
+{
+	const Archetype& table = world.archetypes[archetype];
+	if (!(table.mask & componentBit<T>()))
+		return NULL;
+	return reinterpret_cast<const T*>(&world.storage[table.columns[T::COMPONENT]]);
+}
+
+/*This function runs a system on every archetype that has all the components of a mask. The system
+gets the world and the archetype, and fetches the columns it needs with getColumn.*/
+template <typename System>
+void forEachArchetype(World& world, ComponentMask mask, System system)
+{
+	for (int i = 0; i < world.archetypeCount; ++i)
+	{
+		if ((world.archetypes[i].mask & mask) == mask && world.archetypes[i].count > 0)
+			system(world, i);
+	}
+}
+
+#endif
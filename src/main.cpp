@@ -11,25 +11,155 @@ Player2 (bottom):
 
 Bullets spawn rate will decay if player is not moving. 
 Keep moving to spawn bullets faster!
+
+Online (one player per machine, either control scheme):
+	ToastyDuels --lockstep <1|2> <local port> <remote address> <remote port> [input delay]
+	e.g. "--lockstep 1 5000 127.0.0.1 5001" and "--lockstep 2 5001 127.0.0.1 5000"
+	ToastyDuels --rollback <1|2> <local port> <remote address> <remote port> [input delay]
+	Same, but the game never waits for the other player: late input is predicted and corrected.
+
+Client of a dedicated server (the local ship is predicted, either control scheme):
+	ToastyDuels --connect <server address> <port>
+
+Watching a match of a dedicated server, directly or through relays (no window with a duration in seconds):
+	ToastyDuels --spectate <server or relay address> <port> <match> [seconds]
+	ToastyDuels --relay <local port> <server or relay address> <port> <match> [seconds]
+
+Input latency test (no window, a thread types at random for a few seconds, fails if the 99th percentile wait for a tick is over two ticks, for CI):
+	ToastyDuels --headless-latency
+
+Network test (no window, two peers in this process over loopback, for CI):
+	ToastyDuels --network-test <lockstep|rollback> [latency ms] [jitter ms] [loss %] [duplicate %] [reorder %] [seed]
+	ToastyDuels --prediction-test [round trip ms] [jitter ms] [loss %] [seed]
+
+Determinism test (no window, plays a fixed point match of random input and checks its final state hash, for CI):
+	ToastyDuels --determinism-test [ticks] [seed]
+
+Allocation test (no window, fails if a gameplay tick past the first second touches the heap, for CI):
+	ToastyDuels --allocation-test [ticks]
+
+Free for all (up to 64 ships, bots play all but yours; arrows or WASD to move, right "Shift" or "Space" to fire at the nearest ship):
+	ToastyDuels --free-for-all [ships]
+	ToastyDuels --free-for-all-benchmark [ticks]	(no window, times the ticks of bot matches of 8 to 64 ships)
+	ToastyDuels --collision-benchmark [bullets]	(no window, times the hit test of 64 ships on 1 to 16 threads)
+	ToastyDuels --render-benchmark [bullets]	(no window, times turning a frame into sorted render commands on 1 to 4 threads)
+
+Bullet hell (your ship alone against emitters of radial, spiral, aimed and scripted patterns, same keys):
+	ToastyDuels --bullet-hell [emitters]	(scripted patterns are read from assets/patterns.txt)
+	ToastyDuels --bullet-hell-benchmark [ticks]	(no window, reports bullets updated per second per core)
+	ToastyDuels --pattern-benchmark [bullets]	(no window, times a pattern script against the same pattern in C++)
+
+Entity benchmark (no window, moves many ships stored as entities and as the old ship structs, and compares):
+	ToastyDuels --entity-benchmark [ships]
+
+Sprite masks (no window, writes the solid pixels of the ship and bullet textures as src/CookedMasks.cpp, after they change):
+	ToastyDuels --cook-masks <output file>
+
+Dedicated server (no window, runs until "Enter" is pressed):
+	ToastyDuels --server <first port> [cores]
+	ToastyDuels --server-load <matches> [cores]	(server and bot players in one process, for load tests)
 ****************************************************************************************************/
 
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
 #include <iostream>
-#include <list>
+#include <string>
+#include <thread>
+#include <vector>
 #include "ResourcePath.h"
-#include "Overlap.h"
-
-// Gameplay settings.
-const float SHIP_VELOCITY = 20.f;
-const float BULLET_VELOCITY = 10.0f;
-const int HEALTH = 25;
-// Health bar settings.
-const int HEALTH_BAR_WIDTH = 40;
-const int HEALTH_BAR_HEIGHT = 10;
-// Window settings.
-const int VIDEO_WIDTH = 1000;
-const int VIDEO_HEIGHT = 600;
+#include "Simulation.h"
+#include "TextCache.h"
+#include "Compositor.h"
+#include "RenderCommands.h"
+#include "Input.h"
+#include "Latency.h"
+#include "Lockstep.h"
+#include "Rollback.h"
+#include "Server.h"
+#include "Bots.h"
+#include "NetworkShim.h"
+#include "Client.h"
+#include "Broadcast.h"
+#include "StateHash.h"
+#include "HeapCounter.h"
+#include "BulletKernel.h"
+#include "FreeForAll.h"
+#include "TripleBuffer.h"
+#include "PixelMask.h"
+
+// Window settings (size is in Simulation.h).
 const int FRAME_LIMIT = 60;
+// Simulation settings (gameplay settings are in Simulation.h).
+const int MAX_TICKS_BEHIND = 5;
+const int NETWORK_POLL_MS = 1;	/* poll interval of the simulation thread waiting for the other peer */
+// Latency instrumentation settings.
+const bool REPORT_LATENCY = false;	/* print input latency histograms when the game exits */
+const float HEADLESS_LATENCY_SECONDS = 5.f;	/* length of the synthetic run of --headless-latency */
+// Network settings.
+const int DEFAULT_INPUT_DELAY = 3;	/* ticks between pressing a key and the tick that uses it */
+const int DEFAULT_ROLLBACK_INPUT_DELAY = 1;	/* prediction hides the rest of the latency */
+const float NETWORK_TIMEOUT = 5.f;	/* seconds without the other peer's input before giving up, once it has been heard from */
+const unsigned short NETWORK_TEST_PORT = 5900;	/* --network-test uses this port and the next */
+const int NETWORK_TEST_SECONDS = 20;
+const unsigned short PREDICTION_TEST_PORT = 5910;
+const int PREDICTION_TEST_SECONDS = 20;
+const bool FIXED_POINT_ONLINE = true;	/* peers simulate in fixed point, so different builds and CPUs agree */
+// Determinism test settings.
+const int DETERMINISM_TEST_TICKS = 36000;	/* ten minutes of play */
+const sf::Uint32 DETERMINISM_TEST_SEED = 1;
+const int DETERMINISM_CHECKPOINT_TICKS = 3600;
+const sf::Uint64 DETERMINISM_TEST_HASH = 0x92F0C09511D147F5ULL;	/* every build must reach it with the default ticks and seed */
+// Allocation test settings.
+const int ALLOCATION_TEST_TICKS = 36000;
+const int ALLOCATION_WARMUP_TICKS = TICK_RATE;	/* storage that is reused, like rollback saves, fills up first */
+// Entity benchmark settings.
+const int ENTITY_BENCHMARK_SHIPS = 4096;
+const int ENTITY_BENCHMARK_PASSES = 2000;
+// Free for all settings (gameplay settings are in FreeForAll.h).
+const int FREE_FOR_ALL_BENCHMARK_TICKS = 3600;
+const int FREE_FOR_ALL_BOT_SEED = 1;
+const int FREE_FOR_ALL_BENCHMARK_HEALTH = 1 << 30;	/* nobody dies, so the bullets of every ship pile up */
+// Collision settings.
+const int MAX_COLLISION_THREADS = 16;	/* a free for all tests for hits on this many cores at most */
+const int COLLISION_BENCHMARK_BULLETS = 50000;
+const int COLLISION_BENCHMARK_PASSES = 200;
+// Bullet hell settings.
+const int BULLET_HELL_EMITTERS = 24;
+const int BULLET_HELL_BENCHMARK_TICKS = 3600;
+const int BULLET_KERNEL_BENCHMARK_PASSES = 20000;	/* of the integration kernel alone, over MAX_FREE_FOR_ALL_BULLETS */
+const int PATTERN_BENCHMARK_BULLETS = 50000;
+const int PATTERN_BENCHMARK_TICKS = 600;
+const char* const PATTERN_BENCHMARK_SCRIPT =	/* the wave of assets/patterns.txt, see updateHandWrittenWaves */
+	"pattern wave\n"
+	"	eq r6 age 0\n"
+	"	sel r10 r6 vx r10\n"
+	"	sel r11 r6 vy r11\n"
+	"	mul r7 age .1\n"
+	"	sin r7 r7\n"
+	"	mul r7 r7 .8\n"
+	"	mul r8 r11 r7\n"
+	"	mul r9 r10 r7\n"
+	"	sub vx r10 r8\n"
+	"	add vy r11 r9\n"
+	"end\n";
+// Dedicated server settings.
+const unsigned short SERVER_LOAD_PORT = 6000;	/* first port of --server-load, one per core */
+const int SERVER_LOAD_SECONDS = 30;
+const int SERVER_LOAD_BOT_THREADS = 4;
+// Render cost reporting settings.
+const bool REPORT_LAYER_COSTS = false;	/* print per-layer draw calls, fill and submit time */
+const float LAYER_REPORT_INTERVAL = 5.f;
+// Render command settings.
+const int DRAW_CHUNK_ROWS = 4096;	/* entities one job turns into render commands, at least */
+const int MAX_DRAW_THREADS = 4;		/* the render thread generates commands on this many cores at most */
+const int PATTERN_BULLET_CHUNK = -1;	/* archetype of a chunk of scripted bullets */
+const int RENDER_BENCHMARK_BULLETS = 50000;
+const int RENDER_BENCHMARK_FRAMES = 200;
 // Title sceen settings.
 const float TITLE_BACKGROUND_SCALE_X = .4;
 const float TITLE_BACKGROUND_SCALE_Y = .4;
@@ -37,26 +167,13 @@ const int TITLE_POS_X = 100;
 const int TITLE_POS_Y = 120;
 const int INSTRUCTIONS_POS_X = 200;
 const int INSTRUCTIONS_POS_Y = 300;
-// Player sprite and position settings.
-const int START_Y1 = 25;
-const int START_Y2 = 440;
-const int START_X1 = (VIDEO_WIDTH / 2);
-const int START_X2 = START_X1;
-const float SHIP_SCALE_X = .1f;
-const float SHIP_SCALE_Y = .1f;
-const float BULLET_SCALE_X = .10f;
-const float BULLET_SCALE_Y = .10f;
-// Shot cooldown settings.
-const float MAX_SHOT_COOLDOWN = 0.7f;
-const float MIN_SHOT_COOLDOWN = 0.15f;
-const float SHOT_COOLDOWN_INC = .001f;	/* rate at which bullets slow down (when not moving) */
-const float SHOT_DECAY_MULTIPLIER = 4;
 // Result Screen settings.
 const float RESULT_SCREEN_DELAY = 2.5f;
 const float RESULT_IMG_SCALE_X = 1.5f;
 const float RESULT_IMG_SCALE_Y = 1.2f;
 const int RESULT_TEXT_POS_X = 350;
 const int RESULT_TEXT_POS_Y = 500;
+const unsigned int RESULT_TEXT_SIZE = 30;
 
 enum gameScene {
 	start,
@@ -64,500 +181,2042 @@ enum gameScene {
 	result
 };
 
-struct Bullet {
-	sf::Sprite sprite;
-	bool facingUp;
-	bool collided;
+// Gameplay layers, bottom to top.
+enum gameLayer {
+	backgroundLayer,
+	bulletLayer,
+	shipLayer,
+	hudLayer
+};
+
+// How often a scene needs a new frame.
+enum renderPolicy {
+	renderContinuous,	// something animates every frame
+	renderOnChange		// frame only changes in response to an event
+};
+
+// How every entity of one appearance looks. Entities are plain data, only drawing reads this.
+struct SpriteType {
+	const sf::Texture* texture;
+	sf::IntRect textureRect;
+	sf::Vector2f size;	// on screen, the texture rect scaled
+	int textureId;		// of texture in the render command buffer, see initializeDrawJobs
 };
 
 struct Assets {
 	sf::Texture ship;
 	sf::Texture bulletUp;
 	sf::Texture bulletDown;
+	SpriteType spriteTypes[APPEARANCE_TYPES];	// by appearanceType
 	sf::Texture background;
 	sf::Texture instructions;
 	sf::Texture gameBckground;
 	sf::Sprite ocean;
-	std::list<Bullet>* bullets;
 	sf::Font myFont;
 	sf::Text title;
 	sf::Texture titlePng;
+	sf::Texture resultImg;
+	CachedText player1Wins;
+	CachedText player2Wins;
 };
 
-struct Player {
-	sf::Sprite sprite;
-	sf::Clock shootingClock;
-	int health;
-	bool playerHit;
-	float cooldownRate;	// time between bullets spawned.
-	sf::RectangleShape healthBar;
-	bool moved;
-	bool startTrigger;	// Decay triggered when bullets are spawned.
+// A free for all played in this window: ship 0 is the local player, bots play the others.
+struct LocalFreeForAll {
+	FreeForAll game;
+	FreeForAllInput inputs[MAX_FREE_FOR_ALL_SHIPS];
+	sf::Uint32 random;	// the bots' generator
+};
+
+// A bullet of the wave pattern, for the hand written side of --pattern-benchmark.
+struct HandWrittenWave {
+	float x, y;
+	float vx, vy;
+	float age;
+	float baseX, baseY;	// velocity it was fired at
+	bool killed;
+};
+
+// Everything the simulation thread updates from input and ticks.
+struct GameState {
+	gameScene scene;
+	Match match;
+	KeyboardState keyboard;
+	bool running;
+	bool networked;	// played online, against a remote peer or on a dedicated server
+	bool freeForAll;	// --free-for-all or --bullet-hell, there is no title or result screen
+	int resultRound;	// match whose result was shown last (rollback)
+};
+
+// Everything one frame shows, copied out of the game state after the ticks of a loop, so the
+// render thread never reads what the simulation is writing.
+struct RenderFrame {
+	gameScene scene;
+	int winner;				// of the result scene
+	bool freeForAll;
+	World world;			// ships and bullets of the match, or of the free for all
+	std::vector<Position> patternBullets;		// of scripted emitters
+	std::vector<sf::Uint8> patternAppearances;
+	sf::Vector2f camera;	// top left corner of the window in the world
+	sf::Int64 simTime;		// when it was published, on the input clock
+};
+
+// Rows of one archetype, or scripted bullets of a frame, that one job turns into render commands.
+struct DrawChunk {
+	int archetype;	// PATTERN_BULLET_CHUNK for scripted bullets
+	int layer;
+	int first;
+	int count;
 };
 
+// A frame being turned into render commands by drawEntities, one command list per chunk.
+struct DrawJobs {
+	const RenderFrame* frame;
+	const SpriteType* types;
+	std::vector<DrawChunk> chunks;
+	int chunkRows;
+	RenderCommandBuffer commands;
+};
+
+// Adds every entity with a Position and an Appearance straight to its layer, in world order: ships
+// on the ship layer, the rest (bullets) on the bullet layer. This is how frames were drawn before
+// render commands, --render-benchmark compares them.
+struct DirectDrawSystem {
+	Compositor* compositor;
+	const SpriteType* types;
+	sf::Vector2f camera;	// top left corner of the window, in the world
+
+	void operator()(World &world, int archetype) const
+	{
+		const Position* positions = getColumn<Position>(world, archetype);
+		const Appearance* appearances = getColumn<Appearance>(world, archetype);
+		const Health* health = getColumn<Health>(world, archetype);
+		const Projectile* projectiles = getColumn<Projectile>(world, archetype);
+		int layer = health ? shipLayer : bulletLayer;
+		for (int i = 0; i < world.archetypes[archetype].count; ++i)
+		{
+			if ((health && health[i].points <= 0) || (projectiles && projectiles[i].collided))
+				continue;
+			const SpriteType &type = types[appearances[i].type];
+			sf::FloatRect rect(positions[i].x - camera.x, positions[i].y - camera.y, type.size.x, type.size.y);
+			if (rect.left + rect.width < 0 || rect.top + rect.height < 0 || rect.left > VIDEO_WIDTH || rect.top > VIDEO_HEIGHT)
+				continue;
+			addTexturedRectangle(*compositor, layer, type.texture, type.textureRect, rect);
+		}
+	}
+};
+
+// A frame that reached the screen, handed back to the simulation for its latency stats.
+struct DisplayedFrame {
+	sf::Int64 simTime;		// of the frame
+	sf::Int64 time;			// when window.display() returned
+};
+
+// What the simulation and render threads need from main.
+struct GameThreadData {
+	sf::RenderWindow* window;
+	TripleBuffer<RenderFrame>* frames;			// simulation to render thread
+	TripleBuffer<DisplayedFrame>* displayed;	// render to simulation thread
+	std::atomic<bool>* simulating;				// cleared by the simulation thread when the game ends
+	InputQueue* input;
+	sf::Clock* inputClock;
+	LockstepSession* network;	// NULL unless playing online in lockstep
+	RollbackSession* rollback;	// NULL unless playing online with rollback
+	ClientSession* client;		// NULL unless playing on a dedicated server
+	SpectatorSession* spectator;	// NULL unless watching a match of a dedicated server
+	LocalFreeForAll* freeForAll;	// NULL unless playing a free for all or a bullet hell
+};
+
+// One side of --network-test.
+struct NetworkTestPeer {
+	LockstepSession lockstep;
+	RollbackSession rollback;
+	LockstepSession* transport;	// lockstep, or the transport of rollback
+	Match match;
+	sf::Uint32 random;			// the peer types at random, from its own generator
+	sf::Uint8 input;
+	sf::Uint32 stalls;			// ticks spent waiting for the other peer
+};
+
+// What the thread of --spectate without a window needs.
+struct HeadlessSpectator {
+	SpectatorSession* session;
+	std::atomic<bool> running;	// cleared by the main thread to stop it
+	int seconds;				// 0 to run until stopped
+};
+
+void runGame(GameThreadData* data);
+void runSimulation(GameThreadData* data);
+void publishFrame(const GameState &state, GameThreadData &data);
+int runHeadlessLatency();
+int runServer(unsigned short basePort, int cores, int loadMatches);
+int runNetworkTest(bool rollback, const NetworkConditions &conditions);
+bool stepNetworkTestPeer(NetworkTestPeer &peer, bool rollback);
+int runPredictionTest(const NetworkConditions &conditions);
+int runDeterminismTest(int ticks, sf::Uint32 seed);
+int runAllocationTest(int ticks);
+int runEntityBenchmark(int ships);
+int runCookMasks(const std::string &path);
+int runFreeForAllBenchmark(int ticks);
+double timeFreeForAll(LocalFreeForAll &local, int ships, int bullets, int ticks);
+void startLocalFreeForAll(LocalFreeForAll &local, int ships, int health);
+void updateFreeForAllBots(LocalFreeForAll &local, int firstShip);
+int runCollisionBenchmark(int bullets);
+int runBulletHellBenchmark(int ticks);
+int runPatternBenchmark(int bullets);
+int runRenderBenchmark(int bullets);
+void updateHandWrittenWaves(std::vector<HandWrittenWave> &bullets, const sf::FloatRect &bounds);
+int runHeadlessSpectator(SpectatorSession &session, int seconds);
+void updateHeadlessSpectator(HeadlessSpectator* watch);
+void sendSyntheticInput(GameThreadData* data);
+void runTick(GameState &state, GameThreadData &data, sf::Int64 tickEnd, LatencyStats &latency);
+void handleEvent(GameState &state, const sf::Event &event);
+bool getInputType(const sf::Event &event, inputType &type);
 void initializeTitleScreen(sf::Sprite &titleScreen, sf::Sprite &titleInstructions, Assets &assets);
-void loadAssets(Assets &assets, std::list<Bullet> &bullets);
-void initializePlayerSettings(Player &player1, Player &player2, Assets &assets);
-bool willBeInBounds(sf::Sprite& sprite, sf::Vector2f offset);
-void movePlayers(Player &player1, Player &player2, Assets &assets);
-void checkCollisions(std::list<Bullet> &bullets, Player &player1, Player &player2);
-void removeBullets(std::list<Bullet> &bullets);
-void drawBullets(sf::RenderWindow &window, Assets &assets);
-void drawPlayers(sf::RenderWindow &window, Player &player1, Player &player2, gameScene &scene);
-void showResults(sf::RenderWindow &window, Player &p1, Player &p2, Assets &assets);
-void changeCooldownRates(Player &player1, Player &player2);
+void bakeTitleScreen(sf::RenderTexture &titleCache, sf::Sprite &titleScreen, sf::Sprite &titleImg, sf::Sprite &titleInstructions);
+renderPolicy getRenderPolicy(gameScene scene);
+void loadAssets(Assets &assets);
+sf::Uint8 getPlayerInput(const KeyboardState &keys, sf::Keyboard::Key left, sf::Keyboard::Key right, sf::Keyboard::Key fire);
+void initializeLayers(Compositor &compositor, Assets &assets);
+void initializeSpriteTypes(Assets &assets);
+void initializeDrawJobs(DrawJobs &jobs, SpriteType types[]);
+void addDrawChunks(DrawJobs &jobs, int archetype, int layer, int rows);
+void drawChunk(void* data, int job);
+void drawEntities(Compositor &compositor, DrawJobs &jobs, JobSystem* threads, RenderFrame &frame, const SpriteType types[]);
+void drawHealthBars(Compositor &compositor, World &world);
+void showResults(sf::RenderWindow &window, int winner, Assets &assets);
 
 /********************************************* Main Function *********************************************/
-int main()
+int main(int argc, char* argv[])
 {
+	// Measure the simulation side of input latency without a window (for CI)
+	if (argc > 1 && std::string(argv[1]) == "--headless-latency")
+		return runHeadlessLatency();
+
+	// Play both sides of an online match over a simulated bad network (for CI)
+	if (argc > 2 && std::string(argv[1]) == "--network-test")
+	{
+		NetworkConditions conditions;
+		conditions.latencyMs = (argc > 3) ? std::atoi(argv[3]) : 0;
+		conditions.jitterMs = (argc > 4) ? std::atoi(argv[4]) : 0;
+		conditions.loss = (argc > 5) ? static_cast<float>(std::atof(argv[5])) / 100 : 0;
+		conditions.duplication = (argc > 6) ? static_cast<float>(std::atof(argv[6])) / 100 : 0;
+		conditions.reordering = (argc > 7) ? static_cast<float>(std::atof(argv[7])) / 100 : 0;
+		conditions.seed = (argc > 8) ? static_cast<sf::Uint32>(std::atoi(argv[8])) : 1;
+		return runNetworkTest(std::string(argv[2]) == "rollback", conditions);
+	}
+	if (argc > 1 && std::string(argv[1]) == "--prediction-test")
+	{
+		NetworkConditions conditions;
+		conditions.latencyMs = (argc > 2) ? std::atoi(argv[2]) : 0;
+		conditions.jitterMs = (argc > 3) ? std::atoi(argv[3]) : 0;
+		conditions.loss = (argc > 4) ? static_cast<float>(std::atof(argv[4])) / 100 : 0;
+		conditions.duplication = 0;
+		conditions.reordering = 0;
+		conditions.seed = (argc > 5) ? static_cast<sf::Uint32>(std::atoi(argv[5])) : 1;
+		return runPredictionTest(conditions);
+	}
+	// Check that this build simulates a fixed point match like every other build (for CI)
+	if (argc > 1 && std::string(argv[1]) == "--determinism-test")
+	{
+		int ticks = (argc > 2) ? std::atoi(argv[2]) : DETERMINISM_TEST_TICKS;
+		sf::Uint32 seed = (argc > 3) ? static_cast<sf::Uint32>(std::atoi(argv[3])) : DETERMINISM_TEST_SEED;
+		return runDeterminismTest(ticks, seed);
+	}
+	// Check that steady gameplay ticks never touch the heap (for CI)
+	if (argc > 1 && std::string(argv[1]) == "--allocation-test")
+		return runAllocationTest((argc > 2) ? std::atoi(argv[2]) : ALLOCATION_TEST_TICKS);
+
+	// Time the ticks of free for all matches played by bots
+	if (argc > 1 && std::string(argv[1]) == "--free-for-all-benchmark")
+		return runFreeForAllBenchmark((argc > 2) ? std::atoi(argv[2]) : FREE_FOR_ALL_BENCHMARK_TICKS);
+
+	// Time the parallel hit test of a free for all on more and more threads
+	if (argc > 1 && std::string(argv[1]) == "--collision-benchmark")
+		return runCollisionBenchmark((argc > 2) ? std::atoi(argv[2]) : COLLISION_BENCHMARK_BULLETS);
+
+	// Time the render commands of a free for all frame on more and more threads
+	if (argc > 1 && std::string(argv[1]) == "--render-benchmark")
+		return runRenderBenchmark((argc > 2) ? std::atoi(argv[2]) : RENDER_BENCHMARK_BULLETS);
+
+	// Time the emitters of a bullet hell and the kernel that moves their bullets
+	if (argc > 1 && std::string(argv[1]) == "--bullet-hell-benchmark")
+		return runBulletHellBenchmark((argc > 2) ? std::atoi(argv[2]) : BULLET_HELL_BENCHMARK_TICKS);
+	// Time a pattern script against the same pattern written in C++
+	if (argc > 1 && std::string(argv[1]) == "--pattern-benchmark")
+		return runPatternBenchmark((argc > 2) ? std::atoi(argv[2]) : PATTERN_BENCHMARK_BULLETS);
+
+	// Compare iterating ships as entities and as the structs they used to be
+	if (argc > 1 && std::string(argv[1]) == "--entity-benchmark")
+		return runEntityBenchmark((argc > 2) ? std::atoi(argv[2]) : ENTITY_BENCHMARK_SHIPS);
+
+	// Rebuild the collision masks of the sprites from their textures
+	if (argc > 2 && std::string(argv[1]) == "--cook-masks")
+		return runCookMasks(argv[2]);
+
+	// Host matches without a window: --server <first port> [cores], --server-load <matches> [cores]
+	if (argc > 2 && (std::string(argv[1]) == "--server" || std::string(argv[1]) == "--server-load"))
+	{
+		int cores = (argc > 3) ? std::atoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+		if (std::string(argv[1]) == "--server")
+			return runServer(static_cast<unsigned short>(std::atoi(argv[2])), cores, 0);
+		return runServer(SERVER_LOAD_PORT, cores, std::atoi(argv[2]));
+	}
+
+	// Online match: --lockstep <player 1|2> <local port> <remote address> <remote port> [input delay]
+	LockstepSession session;
+	LockstepSession* network = NULL;
+	if (argc > 5 && std::string(argv[1]) == "--lockstep")
+	{
+		int inputDelay = (argc > 6) ? std::atoi(argv[6]) : DEFAULT_INPUT_DELAY;
+		if (!startLockstep(session, std::atoi(argv[2]) == 2 ? 2 : 1, static_cast<unsigned short>(std::atoi(argv[3])),
+			sf::IpAddress(argv[4]), static_cast<unsigned short>(std::atoi(argv[5])), inputDelay, NULL))
+			return 1;
+		network = &session;
+	}
+	// Same, but predicting the other peer's input: --rollback <player 1|2> <local port> <remote address> <remote port> [input delay]
+	RollbackSession rollbackSession;
+	RollbackSession* rollback = NULL;
+	if (argc > 5 && std::string(argv[1]) == "--rollback")
+	{
+		int inputDelay = (argc > 6) ? std::atoi(argv[6]) : DEFAULT_ROLLBACK_INPUT_DELAY;
+		if (!startRollback(rollbackSession, std::atoi(argv[2]) == 2 ? 2 : 1, static_cast<unsigned short>(std::atoi(argv[3])),
+			sf::IpAddress(argv[4]), static_cast<unsigned short>(std::atoi(argv[5])), inputDelay, NULL))
+			return 1;
+		rollback = &rollbackSession;
+	}
+	// Dedicated server match: --connect <server address> <port>
+	static ClientSession clientSession;	// keeps a history of predicted ticks, too big for the stack
+	ClientSession* client = NULL;
+	if (argc > 3 && std::string(argv[1]) == "--connect")
+	{
+		std::srand(static_cast<unsigned int>(std::time(NULL)));
+		sf::Uint32 id = static_cast<sf::Uint32>(std::rand()) ^ (static_cast<sf::Uint32>(std::time(NULL)) << 16);
+		if (!startClient(clientSession, sf::IpAddress(argv[2]), static_cast<unsigned short>(std::atoi(argv[3])), id, NULL)) {
+			std::cout << "Could not open a UDP socket" << std::endl;
+			return 1;
+		}
+		client = &clientSession;
+	}
+	// Watch a match: --spectate <address> <port> <match> [seconds], --relay <local port> <address> <port> <match> [seconds]
+	static SpectatorSession spectatorSession;
+	SpectatorSession* spectator = NULL;
+	if ((argc > 4 && std::string(argv[1]) == "--spectate") || (argc > 5 && std::string(argv[1]) == "--relay"))
+	{
+		bool relay = (std::string(argv[1]) == "--relay");
+		int arg = relay ? 3 : 2;
+		unsigned short localPort = relay ? static_cast<unsigned short>(std::atoi(argv[2])) : static_cast<unsigned short>(sf::Socket::AnyPort);
+		if (!startSpectator(spectatorSession, localPort, sf::IpAddress(argv[arg]), static_cast<unsigned short>(std::atoi(argv[arg + 1])),
+			static_cast<sf::Uint32>(std::atoi(argv[arg + 2])), relay)) {
+			std::cout << "Could not bind UDP port " << localPort << std::endl;
+			return 1;
+		}
+		if (relay || argc > arg + 3)
+			return runHeadlessSpectator(spectatorSession, (argc > arg + 3) ? std::atoi(argv[arg + 3]) : 0);
+		spectator = &spectatorSession;
+	}
+
+	// Free for all against bots: --free-for-all [ships]
+	static LocalFreeForAll localFreeForAll;	// a grid and a world of thousands of bullets, too big for the stack
+	LocalFreeForAll* freeForAll = NULL;
+	if (argc > 1 && std::string(argv[1]) == "--free-for-all")
+	{
+		startLocalFreeForAll(localFreeForAll, (argc > 2) ? std::atoi(argv[2]) : MAX_FREE_FOR_ALL_SHIPS, FREE_FOR_ALL_HEALTH);
+		freeForAll = &localFreeForAll;
+	}
+	// Bullet hell, the local ship alone: --bullet-hell [emitters]
+	static PatternLibrary patterns;
+	if (argc > 1 && std::string(argv[1]) == "--bullet-hell")
+	{
+		startLocalFreeForAll(localFreeForAll, 1, FREE_FOR_ALL_HEALTH);
+		// A pattern file with errors is reported and left out, the other patterns still play
+		if (loadPatterns(resourcePath() + "assets/patterns.txt", patterns, std::cout))
+			setFreeForAllPatterns(localFreeForAll.game, &patterns);
+		else
+			std::cout << "Playing without scripted patterns" << std::endl;
+		addBulletHellEmitters(localFreeForAll.game, (argc > 2) ? std::atoi(argv[2]) : BULLET_HELL_EMITTERS);
+		freeForAll = &localFreeForAll;
+	}
+	// Either one tests its bullets for hits on every core
+	static JobSystem collisionJobs;
+	if (freeForAll)
+	{
+		startJobSystem(collisionJobs, std::min(static_cast<int>(std::thread::hardware_concurrency()), MAX_COLLISION_THREADS));
+		setFreeForAllJobs(freeForAll->game, &collisionJobs);
+	}
+
 	// INITIALIZAION
-	gameScene scene = start;
 	sf::RenderWindow window(sf::VideoMode(VIDEO_WIDTH, VIDEO_HEIGHT), "Toasty Duels!");
 	window.setFramerateLimit(FRAME_LIMIT);
+	// The window is drawn from the render thread, this thread only collects input
+	window.setActive(false);
 
-	// declare an STL linked list of Bullets
-	std::list<Bullet> bullets;
+	// The simulation hands frames to the render thread, which hands back when it showed them
+	static TripleBuffer<RenderFrame> frames;	// three worlds of thousands of bullets, too big for the stack
+	static TripleBuffer<DisplayedFrame> displayed;
+	initializeTripleBuffer(frames);
+	initializeTripleBuffer(displayed);
+	std::atomic<bool> simulating(true);
 
-	// Load assets
-	Assets assets;
-	loadAssets(assets, bullets);
+	sf::Clock inputClock;
+	InputQueue input;
+	initializeInputQueue(input);
 
-	// Title screen settings
-	sf::Sprite titleScreen;
-	sf::Sprite titleInstructions;
-	sf::Sprite titleImg;
-	titleImg.setTexture(assets.titlePng);
-	titleImg.setPosition(TITLE_POS_X, TITLE_POS_Y);
-	initializeTitleScreen(titleScreen, titleInstructions, assets);
+	GameThreadData data;
+	data.window = &window;
+	data.frames = &frames;
+	data.displayed = &displayed;
+	data.simulating = &simulating;
+	data.input = &input;
+	data.inputClock = &inputClock;
+	data.network = network;
+	data.rollback = rollback;
+	data.client = client;
+	data.spectator = spectator;
+	data.freeForAll = freeForAll;
+	sf::Thread simulationThread(&runSimulation, &data);
+	simulationThread.launch();
+	sf::Thread renderThread(&runGame, &data);
+	renderThread.launch();
+
+	// INPUT LOOP
+	// Events must be pulled on the thread that created the window. Each one is stamped as soon as
+	// the OS hands it over and queued for the simulation, independently of the frame rate.
+	sf::Event event;
+	while (window.waitEvent(event))
+	{
+		if (!isGameEvent(event))
+			continue;
+
+		TimedEvent timed;
+		timed.event = event;
+		timed.time = inputClock.getElapsedTime().asMicroseconds();
+		while (!pushInput(input, timed))
+			sf::sleep(sf::milliseconds(1));	// simulation thread is behind, wait for room
+
+		if (event.type == sf::Event::Closed)
+			break;
+	}
+
+	simulationThread.wait();
+	renderThread.wait();
+	window.close();
+	if (freeForAll)
+		stopJobSystem(collisionJobs);
+
+	return 0;
+}
+
+/*This function runs the simulation thread: it advances the game in fixed ticks, with the input
+queued by the main thread, and publishes a frame to the render thread after the ticks of every
+loop. It never waits for a frame to be drawn, so a slow display or a driver stall doesn't move
+a tick.*/
+void runSimulation(GameThreadData* data)
+{
+	GameState state;
+	state.networked = (data->network != NULL || data->rollback != NULL || data->client != NULL || data->spectator != NULL);
+	state.freeForAll = (data->freeForAll != NULL);
+	state.scene = (state.networked || state.freeForAll) ? gameplay : start;
+	state.running = true;
+	state.resultRound = -1;
 
 	// Initialize Player settings
-	Player player1, player2;
-	initializePlayerSettings(player1, player2, assets);
+	initializeMatch(state.match);
+	if (FIXED_POINT_ONLINE && (data->network || data->rollback))
+		enableFixedPoint(state.match);
+
+	LatencyStats latency;
+	initializeLatencyStats(latency, true);
+
+	// Time the simulation has been advanced to, on the input clock
+	sf::Int64 simTime = data->inputClock->getElapsedTime().asMicroseconds();
+	// Time since the last tick the network let us simulate
+	sf::Clock stallClock;
+	int resultTicks = 0;	// the result screen has been up for
+	publishFrame(state, *data);
+	gameScene publishedScene = state.scene;
 
 	// GAME LOOP
-	while (window.isOpen())
+	while (state.running)
 	{
-		sf::Event event;
+		// Inputs are on screen once a frame of a later tick is
+		if (acquireFrontSlot(*data->displayed)) {
+			const DisplayedFrame &shown = getFrontSlot(*data->displayed);
+			recordFrameDisplayed(latency, shown.simTime, shown.time);
+		}
 
-		if (scene == gameplay)
-		{
-			movePlayers(player1, player2, assets);
+		// Nothing happens on the title screen until a key is pressed, sleep until one is
+		if (state.scene == start)
+			waitForInput(*data->input);
 
-		}
+		// Don't try to catch up after a stall (window dragged...)
+		sf::Int64 now = data->inputClock->getElapsedTime().asMicroseconds();
+		if (now - simTime > MAX_TICKS_BEHIND * TICK_MICROSECONDS)
+			simTime = now - TICK_MICROSECONDS;
 
-		while (window.pollEvent(event))
+		// SIMULATE WORLD
+		bool ticked = false;
+		while (state.running && simTime + TICK_MICROSECONDS <= now)
 		{
-			// HANDLE EVENTS
-			switch (scene)
+			// In a lockstep match a tick only runs once the other peer's input for it has arrived,
+			// with rollback it runs unless the other peer is more than MAX_ROLLBACK ticks behind
+			if ((data->network || data->rollback) && state.scene == gameplay)
 			{
-			case start:
-				// Trigger gameplay when "Enter" is pressed
-				if (sf::Keyboard::isKeyPressed(sf::Keyboard::Return))
-					scene = gameplay;
-				break;
-			case gameplay:
-				if (sf::Keyboard::isKeyPressed(sf::Keyboard::Escape)) {
-					initializePlayerSettings(player1, player2, assets);
-					scene = start;
+				bool ready;
+				if (data->rollback) {
+					updateRollback(*data->rollback, state.match);	// corrects wrong guesses right away
+					ready = canPredictTick(*data->rollback);
 				}
-				break;
-			case result:
-				// Restart game when "Enter is pressed
-				if (sf::Keyboard::isKeyPressed(sf::Keyboard::R)) {
-					initializePlayerSettings(player1, player2, assets);
-					scene = start;
+				else {
+					receiveInputs(*data->network);
+					ready = isTickReady(*data->network);
 				}
-				break;
+				if (!ready)
+				{
+					LockstepSession &transport = data->rollback ? data->rollback->transport : *data->network;
+					sendInputs(transport);	// our last packet may have been lost
+					// The other peer may be launched long after this one, only time out once it has started
+					if (transport.packetsReceived == 0)
+						stallClock.restart();
+					else if (stallClock.getElapsedTime().asSeconds() > NETWORK_TIMEOUT) {
+						std::cout << "Lost connection to the other player." << std::endl;
+						state.running = false;
+					}
+					break;
+				}
+				stallClock.restart();
 			}
+			simTime += TICK_MICROSECONDS;
+			runTick(state, *data, simTime, latency);
+			ticked = true;
 
-			if (event.type == sf::Event::Closed)
-				window.close();
+			// The result screen stays up for RESULT_SCREEN_DELAY. Lockstep peers reach the result on the
+			// same tick, so both start the rematch together. With rollback the peers are apart by a few
+			// ticks, the simulation starts the rematch itself.
+			resultTicks = (state.scene == result) ? resultTicks + 1 : 0;
+			if (resultTicks >= RESULT_SCREEN_DELAY * TICK_RATE)
+			{
+				if (!data->rollback)
+					initializePlayerSettings(state.match);
+				state.scene = state.networked ? gameplay : start;
+				stallClock.restart();
+				resultTicks = 0;
+			}
+		}
+		if (!state.running)
+			break;
+		// Scenes that only change on input get a frame when the scene changes, the render thread
+		// sleeps through the rest of their ticks
+		if (ticked && (getRenderPolicy(state.scene) == renderContinuous || state.scene != publishedScene)) {
+			publishFrame(state, *data);
+			publishedScene = state.scene;
 		}
 
-		// SIMULATE WORLD
-		if (scene == gameplay)
-			checkCollisions(bullets, player1, player2);
+		// Sleep until the next tick is due
+		sf::Int64 wait = simTime + TICK_MICROSECONDS - data->inputClock->getElapsedTime().asMicroseconds();
+		sf::sleep(sf::microseconds(std::max<sf::Int64>(wait, NETWORK_POLL_MS * 1000)));
+	}
+	// Wake the render thread, which stops without drawing the slot
+	data->simulating->store(false);
+	publishBackSlot(*data->frames);
+
+	if (REPORT_LATENCY)
+		printLatencyReport(latency, std::cout, true);
+	LockstepSession* transport = data->rollback ? &data->rollback->transport : data->network;
+	if (transport && transport->tick > 0)
+	{
+		std::cout << "Sent " << transport->bytesSent << " bytes in " << transport->packetsSent << " packets over "
+			<< transport->tick << " ticks (" << static_cast<double>(transport->bytesSent) / transport->tick
+			<< " bytes per tick)" << std::endl;
+		std::cout << "Compared " << transport->checkedHashes << " state hashes with the other peer";
+		if (transport->desyncTick != NO_TICK)
+			std::cout << ", they first differed after tick " << transport->desyncTick;
+		std::cout << std::endl;
+	}
+	if (data->rollback)
+		printRollbackReport(*data->rollback, std::cout);
+	if (data->client)
+		printClientReport(*data->client, std::cout);
+	if (data->spectator)
+		printSpectatorReport(*data->spectator, std::cout);
+}
+
+/*This function copies what the next frame shows into the back slot of the frame buffer and hands
+it to the render thread. Slots keep their storage, so once each has held the biggest world it
+copies without allocating.*/
+void publishFrame(const GameState &state, GameThreadData &data)
+{
+	RenderFrame &frame = getBackSlot(*data.frames);
+	frame.scene = state.scene;
+	frame.winner = getWinner(state.match);
+	frame.freeForAll = state.freeForAll;
+	frame.camera = sf::Vector2f(0, 0);
+	frame.patternBullets.clear();
+	frame.patternAppearances.clear();
+	if (state.scene == gameplay && data.freeForAll)
+	{
+		// The window follows the local ship around the arena
+		const FreeForAll &game = data.freeForAll->game;
+		frame.world = game.world;
+		const Position &ship = getColumn<Position>(game.world, SHIP_ARCHETYPE)[0];
+		frame.camera = sf::Vector2f(ship.x + SHIP_WIDTH / 2 - VIDEO_WIDTH / 2, ship.y + SHIP_HEIGHT / 2 - VIDEO_HEIGHT / 2);
+		frame.camera.x = std::max(0.f, std::min(frame.camera.x, static_cast<float>(FREE_FOR_ALL_WIDTH - VIDEO_WIDTH)));
+		frame.camera.y = std::max(0.f, std::min(frame.camera.y, static_cast<float>(FREE_FOR_ALL_HEIGHT - VIDEO_HEIGHT)));
+		for (std::size_t script = 0; script < game.patterns.groups.size(); ++script)
+		{
+			const float* x = getPatternRegister(game.patterns, static_cast<int>(script), registerX);
+			const float* y = getPatternRegister(game.patterns, static_cast<int>(script), registerY);
+			const float* vy = getPatternRegister(game.patterns, static_cast<int>(script), registerVY);
+			for (int i = 0; i < game.patterns.groups[script].count; ++i)
+			{
+				Position bullet = { x[i], y[i] };
+				frame.patternBullets.push_back(bullet);
+				frame.patternAppearances.push_back(static_cast<sf::Uint8>((vy[i] < 0) ? bulletUpAppearance : bulletDownAppearance));
+			}
+		}
+	}
+	else if (state.scene == gameplay)
+		frame.world = state.match.world;
+	frame.simTime = data.inputClock->getElapsedTime().asMicroseconds();
+	publishBackSlot(*data.frames);
+}
+
+/*This function runs the render thread: it loads the assets and draws the newest frame the
+simulation published, as often as the display lets it, until the simulation stops. Between frames
+it sleeps until the next publish. It only reads its front slot, which the simulation never
+writes.*/
+void runGame(GameThreadData* data)
+{
+	sf::RenderWindow &window = *data->window;
+	window.setActive(true);
+
+	// Load assets
+	Assets assets;
+	loadAssets(assets);
+
+	// Title screen settings
+	sf::Sprite titleScreen;
+	sf::Sprite titleInstructions;
+	sf::Sprite titleImg;
+	titleImg.setTexture(assets.titlePng);
+	titleImg.setPosition(TITLE_POS_X, TITLE_POS_Y);
+	initializeTitleScreen(titleScreen, titleInstructions, assets);
+	// The title never changes, so it is composed once and drawn as a single sprite
+	sf::RenderTexture titleCache;
+	bakeTitleScreen(titleCache, titleScreen, titleImg, titleInstructions);
+	sf::Sprite titleFrame(titleCache.getTexture());
+	bool frameIsCurrent = false;	// the last displayed frame still shows the current scene
+	gameScene drawnScene = start;
+
+	// Gameplay is drawn through cached and batched layers, the entities through sorted render
+	// commands, generated on several cores in a free for all
+	Compositor compositor;
+	initializeLayers(compositor, assets);
+	static DrawJobs drawJobs;
+	initializeDrawJobs(drawJobs, assets.spriteTypes);
+	JobSystem drawThreads;
+	if (data->freeForAll)
+		startJobSystem(drawThreads, std::min(static_cast<int>(std::thread::hardware_concurrency()), MAX_DRAW_THREADS));
+
+	// RENDER LOOP
+	while (true)
+	{
+		waitForFrontSlot(*data->frames);
+		if (!data->simulating->load())
+			break;
+		RenderFrame &frame = getFrontSlot(*data->frames);
+
+		// Static scenes are only drawn again when the scene changes
+		frameIsCurrent = frameIsCurrent && frame.scene == drawnScene;
+		if (frameIsCurrent && getRenderPolicy(frame.scene) == renderOnChange)
+			continue;
+
 		// clear window
 		window.clear();
-		
+
 		// Draw game
-		switch (scene)
+		switch (frame.scene)
 		{
 		case start:
-			/*assets.title.setString("Toasty Duels");
-			assets.title.setColor(sf::Color::Black);
-			assets.title.setPosition(100, 200);
-			window.draw(assets.title);*/
-			window.draw(titleScreen);
-			window.draw(titleImg);	// Add title image
-			window.draw(titleInstructions);
+			window.draw(titleFrame);	// background, title image and instructions (see bakeTitleScreen)
 			break;
 		case gameplay:
-			drawBullets(window, assets);
-			removeBullets(bullets);
-			drawPlayers(window, player1, player2, scene);
+			beginFrame(compositor);
+			drawEntities(compositor, drawJobs, data->freeForAll ? &drawThreads : NULL, frame, assets.spriteTypes);
+			if (!frame.freeForAll)
+				drawHealthBars(compositor, frame.world);
+			composite(window, compositor);
+			if (REPORT_LAYER_COSTS)
+				reportLayerCosts(compositor, LAYER_REPORT_INTERVAL);
 			break;
 		case result:
-			sf::Clock resultClock;
-			while (resultClock.getElapsedTime().asSeconds() < RESULT_SCREEN_DELAY)
-			{
-				//std::cout << resultClock.getElapsedTime().asSeconds() << std::endl;
-				showResults(window, player1, player2, assets);
-			}
-			resultClock.restart();
-			initializePlayerSettings(player1, player2, assets);
-			scene = start;
+			showResults(window, frame.winner, assets);
 			break;
 		}
 		window.display();
+		drawnScene = frame.scene;
+		frameIsCurrent = true;
+
+		DisplayedFrame &shown = getBackSlot(*data->displayed);
+		shown.simTime = frame.simTime;
+		shown.time = data->inputClock->getElapsedTime().asMicroseconds();
+		publishBackSlot(*data->displayed);
 	}
 
-	return 0;
+	if (data->freeForAll)
+		stopJobSystem(drawThreads);
+	// Hand the window back to the main thread so it can close it
+	window.setActive(false);
 }
 
-/******************************************** Game Functions ********************************************/
-
-/*This function draws the result screen*/
-void showResults(sf::RenderWindow &window, Player &p1, Player &p2, Assets &assets)
+/*This function runs the simulation without a window, fed by a thread that types like a player,
+and prints how long inputs wait before a tick applies them. Nothing is loaded, the simulation
+only needs the texture sizes.
+Fails if the 99th percentile is above two ticks.*/
+int runHeadlessLatency()
 {
-	// clear window
-	window.clear();
+	sf::Clock inputClock;
+	InputQueue input;
+	initializeInputQueue(input);
 
-	sf::Texture shipExplosion;
-	shipExplosion.loadFromFile(resourcePath() + "assets/resultImg.jpg");
-	sf::Sprite resultScene;
-	resultScene.setTexture(shipExplosion);
-	resultScene.setScale(RESULT_IMG_SCALE_X, RESULT_IMG_SCALE_Y);
+	GameState state;
+	state.scene = start;
+	state.running = true;
+	state.networked = false;
+	state.freeForAll = false;
+	state.resultRound = -1;
+	initializeMatch(state.match);
 
-	window.draw(resultScene);
-	sf::Text resultText;
-	resultText.setFont(assets.myFont);
+	LatencyStats latency;
+	initializeLatencyStats(latency, false);
 
-	if (p1.health == 0) {
-		resultText.setString("Player 2 Wins!");
+	GameThreadData data;
+	data.window = NULL;
+	data.frames = NULL;
+	data.displayed = NULL;
+	data.simulating = NULL;
+	data.input = &input;
+	data.inputClock = &inputClock;
+	data.network = NULL;
+	data.rollback = NULL;
+	data.client = NULL;
+	data.spectator = NULL;
+	data.freeForAll = NULL;
+	sf::Thread inputThread(&sendSyntheticInput, &data);
+	inputThread.launch();
+
+	sf::Int64 simTime = inputClock.getElapsedTime().asMicroseconds();
+	while (state.running)
+	{
+		sf::Int64 now = inputClock.getElapsedTime().asMicroseconds();
+		while (state.running && simTime + TICK_MICROSECONDS <= now)
+		{
+			simTime += TICK_MICROSECONDS;
+			runTick(state, data, simTime, latency);
+		}
+		sf::sleep(sf::milliseconds(1));
 	}
-	else
-		resultText.setString("Player 1 Wins!");
+	inputThread.wait();
 
-	resultText.setColor(sf::Color::Red);
-	resultText.setPosition(RESULT_TEXT_POS_X, RESULT_TEXT_POS_Y);
+	printLatencyReport(latency, std::cout, false);
 
-	// Draw result scene
-	window.draw(resultText);
-	window.display();
+	for (int i = 0; i < INPUT_TYPE_COUNT; ++i)
+	{
+		if (getLatencyPercentile(latency.inputToSim[i], 0.99f) > 2 * TICK_MICROSECONDS)
+			return 1;
+	}
+	return 0;
 }
 
-/*This function sets up the title screen.*/
-void initializeTitleScreen(sf::Sprite &titleScreen, sf::Sprite &titleInstructions, Assets &assets)
+/*This function runs a dedicated server with one shard per core. With loadMatches, bots playing that
+many matches are started in the same process and the server stops by itself after SERVER_LOAD_SECONDS;
+otherwise it stops when "Enter" is pressed.*/
+int runServer(unsigned short basePort, int cores, int loadMatches)
 {
-	// Create background image
-	titleScreen.setTexture(assets.background);
-	titleScreen.setScale(TITLE_BACKGROUND_SCALE_X, TITLE_BACKGROUND_SCALE_Y);
-	// Create instruction textbox
-	assets.instructions.loadFromFile(resourcePath() + "assets/instructions.png");
-	titleInstructions.setTexture(assets.instructions);
-	titleInstructions.setPosition(INSTRUCTIONS_POS_X, INSTRUCTIONS_POS_Y);
-	// Create title text
-	
+	if (cores < 1)
+		cores = 1;
+	Server server;
+	if (!startServer(server, basePort, cores, loadMatches / cores + 1))
+		return 1;
+	std::cout << "Hosting matches on UDP ports " << basePort << "-" << basePort + cores - 1 << std::endl;
+
+	if (loadMatches > 0)
+	{
+		BotLoad bots;
+		if (!startBots(bots, sf::IpAddress::LocalHost, basePort, cores, loadMatches, SERVER_LOAD_BOT_THREADS)) {
+			stopServer(server, std::cout);
+			return 1;
+		}
+		sf::sleep(sf::seconds(SERVER_LOAD_SECONDS));
+		stopBots(bots, std::cout);
+	}
+	else
+	{
+		std::cout << "Press Enter to stop." << std::endl;
+		std::cin.get();
+	}
+	stopServer(server, std::cout);
+	return 0;
 }
 
-/*This function loads the textures from assets folder.*/
-void loadAssets(Assets &assets, std::list<Bullet> &bullets)
+/*This function plays an online match between two peers in this process, over loopback through a
+shim that makes the network as bad as asked, and prints desyncs, stalls, rollbacks and bandwidth.
+Each peer types at random from a fixed seed, so a run can be repeated.
+Fails if the peers ever disagree on a tick both consider final, or stop hearing each other, or if
+packets arrive out of order without jitter or reordering.*/
+int runNetworkTest(bool rollback, const NetworkConditions &conditions)
 {
-	// Title screen assets
-	assets.titlePng.loadFromFile(resourcePath() + "assets/title.png");
-	assets.background.loadFromFile(resourcePath() + "assets/battleshipTitle.jpg");
-	assets.myFont.loadFromFile(resourcePath() + "assets/Cowboys.ttf");
-	// Game assets
-	assets.ship.loadFromFile(resourcePath() + "assets/battleship.png");
-	assets.bulletDown.loadFromFile(resourcePath() + "assets/bulletDown.png");
-	assets.bulletUp.loadFromFile(resourcePath() + "assets/bulletUp.png");
-	assets.gameBckground.loadFromFile(resourcePath() + "assets/gameBackground.jpg");
-	assets.ocean.setTexture(assets.gameBckground);
-	// Assign bullets linked list to assets
-	assets.bullets = &bullets;
-}
-
-/*This function will initialize player settings, such as sprite, cooldownRate, health etc,
-for both player1 and player2*/
-void initializePlayerSettings(Player &player1, Player &player2, Assets &assets)
-{
-	// Initialize player1
-	player1.sprite.setTexture(assets.ship);
-	player1.sprite.setScale(sf::Vector2f(SHIP_SCALE_X, SHIP_SCALE_Y));
-	player1.sprite.setPosition(sf::Vector2f(START_X1, START_Y1));
-	player1.playerHit = false;
-	player1.health = HEALTH;
-	player1.cooldownRate = MIN_SHOT_COOLDOWN;
-	player1.healthBar.setFillColor(sf::Color::Red);
-	player1.startTrigger = false;
-
-	// Initialize player2
-	player2.sprite.setTexture(assets.ship);
-	player2.sprite.setScale(sf::Vector2f(SHIP_SCALE_X, SHIP_SCALE_Y));
-	player2.sprite.setPosition(sf::Vector2f(START_X2, START_Y2));
-	player2.playerHit = false;
-	player2.health = HEALTH;
-	player2.cooldownRate = MIN_SHOT_COOLDOWN;
-	player2.healthBar.setPosition(sf::Vector2f(0, VIDEO_HEIGHT - HEALTH_BAR_HEIGHT));
-	player2.healthBar.setFillColor(sf::Color::Yellow);
-	player2.startTrigger = false;
-
-	// Clear bullets on screen
-	assets.bullets->clear();
-}
-
-/*This function check if the sprites are within the screen boundaries*/
-bool willBeInBounds(sf::Sprite& sprite, sf::Vector2f offset) {
-	sf::FloatRect bounds = sprite.getGlobalBounds();
-
-	if ((bounds.top + offset.y) < 0) {
-		return false;
+	NetworkTestPeer peers[2];
+	for (int i = 0; i < 2; ++i)
+	{
+		NetworkTestPeer &peer = peers[i];
+		NetworkConditions peerConditions = conditions;
+		peerConditions.seed = conditions.seed * 2 + i;	// each direction gets its own bad luck
+		unsigned short localPort = static_cast<unsigned short>(NETWORK_TEST_PORT + i);
+		unsigned short remotePort = static_cast<unsigned short>(NETWORK_TEST_PORT + 1 - i);
+		bool started = rollback
+			? startRollback(peer.rollback, i + 1, localPort, sf::IpAddress::LocalHost, remotePort, DEFAULT_ROLLBACK_INPUT_DELAY, &peerConditions)
+			: startLockstep(peer.lockstep, i + 1, localPort, sf::IpAddress::LocalHost, remotePort, DEFAULT_INPUT_DELAY, &peerConditions);
+		if (!started)
+			return 1;
+		peer.transport = rollback ? &peer.rollback.transport : &peer.lockstep;
+		initializeMatch(peer.match);
+		if (FIXED_POINT_ONLINE)
+			enableFixedPoint(peer.match);
+		peer.random = conditions.seed + i;
+		peer.input = 0;
+		peer.stalls = 0;
 	}
-	if ((bounds.left + offset.x) < 0) {
-		return false;
+
+	sf::Uint32 checks = 0;
+	sf::Uint32 desyncs = 0;
+	const sf::Uint32 ticks = NETWORK_TEST_SECONDS * TICK_RATE;
+	sf::Clock clock;
+	sf::Clock stallClock;
+	sf::Int64 simTime = 0;
+	while (peers[0].transport->tick < ticks || peers[1].transport->tick < ticks)
+	{
+		// Same pacing as the game, both peers from this thread
+		sf::Int64 now = clock.getElapsedTime().asMicroseconds();
+		if (simTime + TICK_MICROSECONDS > now) {
+			sf::sleep(sf::microseconds(simTime + TICK_MICROSECONDS - now));
+			continue;
+		}
+		simTime += TICK_MICROSECONDS;
+
+		for (int i = 0; i < 2; ++i)
+		{
+			if (stepNetworkTestPeer(peers[i], rollback))
+				stallClock.restart();
+		}
+		if (stallClock.getElapsedTime().asSeconds() > NETWORK_TIMEOUT) {
+			std::cout << "The peers stopped hearing each other." << std::endl;
+			return 1;
+		}
+
+		// Compare the peers whenever they are at the same final tick, both states are at hand here
+		const Match* states[2] = { NULL, NULL };
+		if (rollback)
+		{
+			if (peers[0].rollback.confirmed == peers[1].rollback.confirmed) {
+				states[0] = &getConfirmedMatch(peers[0].rollback, peers[0].match);
+				states[1] = &getConfirmedMatch(peers[1].rollback, peers[1].match);
+			}
+		}
+		else if (peers[0].lockstep.tick == peers[1].lockstep.tick)
+		{
+			states[0] = &peers[0].match;
+			states[1] = &peers[1].match;
+		}
+		if (states[0])
+		{
+			checks++;
+			if (!isSameMatch(*states[0], *states[1]) && desyncs++ == 0) {
+				std::cout << "Peers differ at tick " << (rollback ? peers[0].rollback.confirmed : peers[0].lockstep.tick) << ":" << std::endl;
+				printMatchDiff(*states[0], *states[1], std::cout);
+			}
+		}
 	}
-	if ((bounds.left + bounds.width + offset.x) > VIDEO_WIDTH) {
-		return false;
+
+	std::cout << "NETWORK TEST (" << (rollback ? "rollback" : "lockstep") << ", " << conditions.latencyMs << "ms +"
+		<< conditions.jitterMs << "ms, loss " << conditions.loss * 100 << "%, duplicates " << conditions.duplication * 100
+		<< "%, reordering " << conditions.reordering * 100 << "%, seed " << conditions.seed << ")" << std::endl;
+	std::cout << "  desyncs: " << desyncs << " of " << checks << " checks, " << peers[0].transport->checkedHashes << " and "
+		<< peers[1].transport->checkedHashes << " state hashes compared by the peers" << std::endl;
+	for (int i = 0; i < 2; ++i)
+	{
+		if (peers[i].transport->desyncTick != NO_TICK)
+			std::cout << "  player " << i + 1 << " saw the hashes differ after tick " << peers[i].transport->desyncTick << std::endl;
 	}
-	if ((bounds.top + bounds.height + offset.y) > VIDEO_HEIGHT) {
-		return false;
+	for (int i = 0; i < 2; ++i)
+	{
+		const NetworkTestPeer &peer = peers[i];
+		std::cout << "  player " << i + 1 << ": " << peer.stalls << " stalled ticks, "
+			<< static_cast<double>(peer.transport->bytesSent) / peer.transport->tick << " bytes per tick, "
+			<< peer.transport->shim.dropped << " dropped, " << peer.transport->shim.duplicated << " duplicated, "
+			<< peer.transport->shim.reordered << " reordered" << std::endl;
+		if (rollback)
+			printRollbackReport(peer.rollback, std::cout);
 	}
-	return true;
+	bool hashesAgreed = (peers[0].transport->desyncTick == NO_TICK && peers[1].transport->desyncTick == NO_TICK);
+
+	// Without jitter or reordering the shim must be a FIFO link, like the real one it stands for
+	bool inOrder = true;
+	if (conditions.jitterMs == 0 && conditions.reordering == 0 &&
+		(peers[0].transport->shim.reordered > 0 || peers[1].transport->shim.reordered > 0)) {
+		std::cout << "  packets left the shim out of order without jitter or reordering" << std::endl;
+		inOrder = false;
+	}
+	return (desyncs == 0 && hashesAgreed && inOrder) ? 0 : 1;
 }
 
-/*This function handles controls, move the player ship sprites and spawn bullets.*/
-void movePlayers(Player &player1, Player &player2, Assets &assets)
+/*This function advances one --network-test peer by a tick, if the network lets it. Returns false
+while stalled.*/
+bool stepNetworkTestPeer(NetworkTestPeer &peer, bool rollback)
 {
-	// HANDLE CONTROLS
-	sf::Keyboard::Key left = sf::Keyboard::Left;
-	sf::Keyboard::Key right = sf::Keyboard::Right;
-	sf::Keyboard::Key A = sf::Keyboard::A;
-	sf::Keyboard::Key D = sf::Keyboard::D;
-	sf::Keyboard::Key space = sf::Keyboard::Space;
-	sf::Keyboard::Key shift = sf::Keyboard::RShift;
-	sf::Vector2f rightBoundary = sf::Vector2f(-SHIP_VELOCITY, 0);
-	sf::Vector2f leftBoundary = sf::Vector2f(SHIP_VELOCITY, 0);
+	peer.random = peer.random * 1664525u + 1013904223u;
+	if ((peer.random >> 16) % 10 == 0)
+		peer.input = static_cast<sf::Uint8>((peer.random >> 8) % 8);
 
-	// Initialize move settings
+	bool ready;
+	if (rollback) {
+		updateRollback(peer.rollback, peer.match);
+		ready = canPredictTick(peer.rollback);
+	}
+	else {
+		receiveInputs(peer.lockstep);
+		ready = isTickReady(peer.lockstep);
+	}
+	if (!ready)
+	{
+		sendInputs(*peer.transport);
+		peer.stalls++;
+		return false;
+	}
 
-	player1.moved = false;
-	player2.moved = false;
+	if (rollback)
+		advanceRollback(peer.rollback, peer.match, peer.input);
+	else
+	{
+		sf::Uint8 input1, input2;
+		advanceLockstep(peer.lockstep, peer.input, input1, input2);
+		simulateTick(peer.match, input1, input2);
+		recordState(peer.lockstep, peer.lockstep.tick - 1, peer.match);
+	}
+	return true;
+}
 
-	// Move player1
-	if (sf::Keyboard::isKeyPressed(left) && willBeInBounds(player1.sprite, rightBoundary))
+/*This function hosts a match on a local server and connects two predicting clients to it through a
+shim that delays, and maybe drops, what the clients send (so the latency is the whole round trip).
+The clients type at random from a fixed seed. Prints how often and how far the server corrected
+the predicted ships.*/
+int runPredictionTest(const NetworkConditions &conditions)
+{
+	Server server;
+	if (!startServer(server, PREDICTION_TEST_PORT, 1, 1))
+		return 1;
+
+	static ClientSession clients[2];
+	sf::Uint32 random[2];
+	sf::Uint8 input[2] = { 0, 0 };
+	for (int i = 0; i < 2; ++i)
 	{
-		player1.sprite.move(-SHIP_VELOCITY, 0);
-		player1.moved = true;
+		NetworkConditions clientConditions = conditions;
+		clientConditions.seed = conditions.seed * 2 + i;
+		if (!startClient(clients[i], sf::IpAddress::LocalHost, PREDICTION_TEST_PORT, i + 1, &clientConditions)) {
+			stopServer(server, std::cout);
+			return 1;
+		}
+		random[i] = conditions.seed + i;
 	}
-	if (sf::Keyboard::isKeyPressed(right) && willBeInBounds(player1.sprite, leftBoundary))
+
+	sf::Clock clock;
+	sf::Int64 simTime = 0;
+	while (simTime < static_cast<sf::Int64>(PREDICTION_TEST_SECONDS) * 1000000)
 	{
-		player1.sprite.move(SHIP_VELOCITY, 0);
-		player1.moved = true;
+		sf::Int64 now = clock.getElapsedTime().asMicroseconds();
+		if (simTime + TICK_MICROSECONDS > now) {
+			sf::sleep(sf::microseconds(simTime + TICK_MICROSECONDS - now));
+			continue;
+		}
+		simTime += TICK_MICROSECONDS;
+
+		for (int i = 0; i < 2; ++i)
+		{
+			random[i] = random[i] * 1664525u + 1013904223u;
+			if ((random[i] >> 16) % 10 == 0)
+				input[i] = static_cast<sf::Uint8>((random[i] >> 8) % 8);
+			advanceClient(clients[i], input[i]);
+		}
 	}
-	if (sf::Keyboard::isKeyPressed(left) && sf::Keyboard::isKeyPressed(right))
+	stopServer(server, std::cout);
+
+	std::cout << "PREDICTION TEST (" << conditions.latencyMs << "ms +" << conditions.jitterMs << "ms round trip, loss "
+		<< conditions.loss * 100 << "%, seed " << conditions.seed << ")" << std::endl;
+	for (int i = 0; i < 2; ++i)
+		printClientReport(clients[i], std::cout);
+	return (clients[0].snapshots > 0 && clients[1].snapshots > 0) ? 0 : 1;
+}
+
+/*This function plays the same random input into a fixed point match and a float match, as fast as
+it can, and prints both state hashes at every checkpoint. The fixed point hashes must be the same on
+every compiler, CPU and build type; the float ones are printed to show where they are not. With the
+default ticks and seed, fails if the fixed point match does not end on DETERMINISM_TEST_HASH.*/
+int runDeterminismTest(int ticks, sf::Uint32 seed)
+{
+	Match fixedMatch, floatMatch;
+	initializeMatch(fixedMatch);
+	enableFixedPoint(fixedMatch);
+	initializeMatch(floatMatch);
+
+	sf::Uint32 random[2] = { seed, seed + 1 };
+	sf::Uint8 input[2] = { 0, 0 };
+	std::cout << "DETERMINISM TEST (" << ticks << " ticks, seed " << seed << ")" << std::endl;
+	std::cout << std::hex;
+	for (int tick = 1; tick <= ticks; ++tick)
 	{
-		player1.moved = false;
+		for (int i = 0; i < 2; ++i)
+		{
+			random[i] = random[i] * 1664525u + 1013904223u;
+			if ((random[i] >> 16) % 10 == 0)
+				input[i] = static_cast<sf::Uint8>((random[i] >> 8) % 8);
+		}
+		simulateTick(fixedMatch, input[0], input[1]);
+		simulateTick(floatMatch, input[0], input[1]);
+		if (tick % DETERMINISM_CHECKPOINT_TICKS == 0 || tick == ticks)
+			std::cout << "  tick " << std::dec << tick << std::hex << ": fixed " << hashMatch(fixedMatch)
+				<< ", float " << hashMatch(floatMatch) << std::endl;
 	}
+	sf::Uint64 hash = hashMatch(fixedMatch);
+	std::cout << std::dec;
+	if (ticks != DETERMINISM_TEST_TICKS || seed != DETERMINISM_TEST_SEED)
+		return 0;
+	if (hash != DETERMINISM_TEST_HASH) {
+		std::cout << "  the fixed point match should have ended on " << std::hex << DETERMINISM_TEST_HASH << std::dec << std::endl;
+		writeMatchState(fixedMatch, std::cout);
+		return 1;
+	}
+	std::cout << "  the fixed point match ended on the expected state" << std::endl;
+	return 0;
+}
 
-	// Spawn bullets for player1
-	if (sf::Keyboard::isKeyPressed(shift) && player1.shootingClock.getElapsedTime().asSeconds() > player1.cooldownRate)
+/*This function plays a float match and a fixed point match of random input, saving every tick of
+the float one the way rollback does and hashing both, and counts the heap allocations made after
+the warm up. Fails if there was any, or if this build does not count them.*/
+int runAllocationTest(int ticks)
+{
+	if (!COUNT_HEAP_ALLOCATIONS) {
+		std::cout << "ALLOCATION TEST: this build does not count heap allocations, build it with COUNT_HEAP_ALLOCATIONS" << std::endl;
+		return 1;
+	}
+
+	static Match floatMatch, fixedMatch;
+	static Match saved[ROLLBACK_STATES];
+	initializeMatch(floatMatch);
+	initializeMatch(fixedMatch);
+	enableFixedPoint(fixedMatch);
+
+	sf::Uint32 random[2] = { 1, 2 };
+	sf::Uint8 input[2] = { 0, 0 };
+	sf::Uint64 hashes = 0;
+	sf::Uint64 before = 0;
+	for (int tick = 0; tick < ALLOCATION_WARMUP_TICKS + ticks; ++tick)
 	{
-		int x = (player1.sprite.getPosition().x) + ((player1.sprite.getGlobalBounds().width) / 2);	// get x-coordinate of player1
+		if (tick == ALLOCATION_WARMUP_TICKS)
+			before = getHeapAllocations();
+		for (int i = 0; i < 2; ++i)
+		{
+			random[i] = random[i] * 1664525u + 1013904223u;
+			if ((random[i] >> 16) % 10 == 0)
+				input[i] = static_cast<sf::Uint8>((random[i] >> 8) % 8);
+		}
+		saved[tick % ROLLBACK_STATES] = floatMatch;
+		simulateTick(floatMatch, input[0], input[1]);
+		simulateTick(fixedMatch, input[0], input[1]);
+		hashes ^= hashMatch(floatMatch) ^ hashMatch(fixedMatch);
+	}
+	sf::Uint64 allocations = getHeapAllocations() - before;
+
+	std::cout << "ALLOCATION TEST (" << ticks << " ticks after " << ALLOCATION_WARMUP_TICKS << " of warm up)" << std::endl;
+	std::cout << "  " << allocations << " heap allocations, " << floatMatch.round + fixedMatch.round << " rounds played"
+		<< " (hashes " << std::hex << hashes << std::dec << ")" << std::endl;
+	return (allocations == 0) ? 0 : 1;
+}
+
+// A ship as it was stored before ships were entities: the simulated fields next to a sprite and a
+// health bar shape. Only --entity-benchmark uses it, as the baseline.
+struct LegacyShip {
+	sf::Sprite sprite;
+	int ticksSinceShot;
+	int health;
+	bool playerHit;
+	float cooldownRate;
+	sf::RectangleShape healthBar;
+	bool moved;
+	bool startTrigger;
+	Fixed x;
+	Fixed y;
+	Fixed cooldownTicks;
+};
 
-		Bullet bltDown;
-		bltDown.sprite.setTexture(assets.bulletDown);
-		bltDown.sprite.setScale(sf::Vector2f(BULLET_SCALE_X, BULLET_SCALE_Y));
-		bltDown.facingUp = false;
-		bltDown.collided = false;
-		bltDown.sprite.setPosition(x, (player1.sprite.getGlobalBounds().top + player1.sprite.getGlobalBounds().height));
-		assets.bullets->push_back(bltDown);
-		player1.shootingClock.restart();
+// The benchmark's movement system: every ship steps sideways, counts a tick and updates its cooldown.
+struct BenchmarkMoveSystem {
+	float step;
+	float* checksum;
 
-		// start bullet decay when bullets are first spawned
-		if (!player1.startTrigger)
-			player1.startTrigger = true;
+	void operator()(World &world, int archetype) const
+	{
+		Position* positions = getColumn<Position>(world, archetype);
+		Gun* guns = getColumn<Gun>(world, archetype);
+		float sum = 0;
+		for (int i = 0; i < world.archetypes[archetype].count; ++i)
+		{
+			positions[i].x += step;
+			guns[i].ticksSinceShot++;
+			guns[i].moved = true;
+			updateCooldownRate(guns[i]);
+			sum += positions[i].x + guns[i].cooldownRate;
+		}
+		*checksum += sum;
 	}
-	// Move player2
-	if (sf::Keyboard::isKeyPressed(A) && willBeInBounds(player2.sprite, rightBoundary))
+};
+
+/*This function runs the same movement over many ships stored as LegacyShip structs and as
+entities, and prints the time per ship of each. Fails if the two did not compute the same.*/
+int runEntityBenchmark(int ships)
+{
+	if (ships < 1)
+		ships = 1;
+	std::vector<LegacyShip> legacy(ships);
+	World world;
+	ComponentMask shipComponents = componentBit<Position>() | componentBit<Gun>() | componentBit<Health>();
+	int archetype = addArchetype(world, shipComponents, ships, COMPONENT_SIZES);
+	for (int i = 0; i < ships; ++i)
 	{
-		player2.sprite.move(-SHIP_VELOCITY, 0);
-		player2.moved = true;
+		int row = addRow(world, archetype);
+		Position &position = getColumn<Position>(world, archetype)[row];
+		Gun &gun = getColumn<Gun>(world, archetype)[row];
+		position.x = static_cast<float>(i % VIDEO_WIDTH);
+		position.y = static_cast<float>(START_Y1);
+		gun.cooldownRate = MIN_SHOT_COOLDOWN;
+		gun.startTrigger = true;
+		getColumn<Health>(world, archetype)[row].points = HEALTH;
+		legacy[i].sprite.setPosition(position.x, position.y);
+		legacy[i].ticksSinceShot = 0;
+		legacy[i].health = HEALTH;
+		legacy[i].cooldownRate = MIN_SHOT_COOLDOWN;
+		legacy[i].moved = false;
+		legacy[i].startTrigger = true;
 	}
-	if (sf::Keyboard::isKeyPressed(D) && willBeInBounds(player2.sprite, leftBoundary))
+
+	// Ships step right on even passes and left on odd ones, so they stay on screen
+	float legacySum = 0;
+	sf::Clock clock;
+	for (int pass = 0; pass < ENTITY_BENCHMARK_PASSES; ++pass)
 	{
-		player2.sprite.move(SHIP_VELOCITY, 0);
-		player2.moved = true;
+		float step = (pass % 2 == 0) ? SHIP_VELOCITY : -SHIP_VELOCITY;
+		float sum = 0;
+		for (std::vector<LegacyShip>::iterator it = legacy.begin(); it != legacy.end(); ++it)
+		{
+			it->sprite.move(step, 0);
+			it->ticksSinceShot++;
+			it->moved = true;
+			if (it->moved && it->cooldownRate > MIN_SHOT_COOLDOWN)
+				it->cooldownRate = it->cooldownRate - (SHOT_COOLDOWN_INC * SHOT_DECAY_MULTIPLIER);
+			if (it->startTrigger && it->cooldownRate < MAX_SHOT_COOLDOWN)
+				it->cooldownRate += SHOT_COOLDOWN_INC;
+			sum += it->sprite.getPosition().x + it->cooldownRate;
+		}
+		legacySum += sum;
 	}
-	if (sf::Keyboard::isKeyPressed(A) && sf::Keyboard::isKeyPressed(D))
+	sf::Int64 legacyTime = clock.restart().asMicroseconds();
+
+	float entitySum = 0;
+	for (int pass = 0; pass < ENTITY_BENCHMARK_PASSES; ++pass)
 	{
-		player2.moved = false;
+		BenchmarkMoveSystem system = { (pass % 2 == 0) ? SHIP_VELOCITY : -SHIP_VELOCITY, &entitySum };
+		forEachArchetype(world, componentBit<Position>() | componentBit<Gun>(), system);
+	}
+	sf::Int64 entityTime = clock.restart().asMicroseconds();
+
+	double updates = static_cast<double>(ships) * ENTITY_BENCHMARK_PASSES;
+	std::cout << "ENTITY BENCHMARK (" << ships << " ships, " << ENTITY_BENCHMARK_PASSES << " passes)" << std::endl;
+	std::cout << "  structs:  " << legacyTime * 1000.0 / updates << " ns per ship (" << sizeof(LegacyShip)
+		<< " bytes per ship)" << std::endl;
+	std::cout << "  entities: " << entityTime * 1000.0 / updates << " ns per ship (" << sizeof(Position) + sizeof(Gun)
+		<< " bytes of Position and Gun per ship)" << std::endl;
+	if (entityTime > 0)
+		std::cout << "  " << static_cast<double>(legacyTime) / entityTime << "x the throughput of the structs" << std::endl;
+	if (legacySum != entitySum) {
+		std::cout << "  the two did not compute the same ships" << std::endl;
+		return 1;
 	}
+	return 0;
+}
 
-	// Spawn bullets for player2
-	if (sf::Keyboard::isKeyPressed(space) && player2.shootingClock.getElapsedTime().asSeconds() > player2.cooldownRate)
+/*This function starts a free for all of some ships in the window, with ship 0 for the local player.*/
+void startLocalFreeForAll(LocalFreeForAll &local, int ships, int health)
+{
+	initializeFreeForAll(local.game, ships, health);
+	for (int i = 0; i < MAX_FREE_FOR_ALL_SHIPS; ++i)
 	{
-		int x = (player2.sprite.getPosition().x) + ((player2.sprite.getGlobalBounds().width) / 2);	// get x-coordinate of player2
+		local.inputs[i].buttons = 0;
+		local.inputs[i].aim = 0;
+	}
+	local.random = FREE_FOR_ALL_BOT_SEED;
+}
 
-		Bullet bltUp;
-		bltUp.sprite.setTexture(assets.bulletUp);
-		bltUp.sprite.setScale(sf::Vector2f(BULLET_SCALE_X, BULLET_SCALE_Y));
-		bltUp.facingUp = true;
-		bltUp.collided = false;
-		bltUp.sprite.setPosition(x, START_Y2);
-		assets.bullets->push_back(bltUp);
-		player2.shootingClock.restart();
+/*This function picks the input of every bot, the ships from firstShip on.*/
+void updateFreeForAllBots(LocalFreeForAll &local, int firstShip)
+{
+	for (int ship = firstShip; ship < local.game.ships; ++ship)
+		updateFreeForAllBot(local.game, ship, local.random, local.inputs[ship]);
+}
 
-		// start bullet decay when bullets are first spawned
-		if (!player2.startTrigger)
-			player2.startTrigger = true;
+/*This function plays a free for all of bots for some ticks, each tick first adding bullets at
+random until there are at least bullets in flight, and prints how long the ticks took. Returns
+the mean, in microseconds.*/
+double timeFreeForAll(LocalFreeForAll &local, int ships, int bullets, int ticks)
+{
+	startLocalFreeForAll(local, ships, FREE_FOR_ALL_BENCHMARK_HEALTH);
+	sf::Int64 simulated = 0, slowest = 0;
+	sf::Uint64 entities = 0;
+	sf::Clock clock;
+	for (int tick = 0; tick < ticks; ++tick)
+	{
+		updateFreeForAllBots(local, 0);
+		for (int ship = 0; ship < ships; ++ship)
+		{
+			local.random = local.random * 1664525u + 1013904223u;
+			local.inputs[ship].aim = static_cast<sf::Uint8>(local.random >> 24);
+		}
+		while (local.game.world.archetypes[BULLET_ARCHETYPE].count < bullets)
+		{
+			local.random = local.random * 1664525u + 1013904223u;
+			float angle = (local.random >> 8) * (6.2831853f / (1 << 24));
+			sf::Vector2f position(static_cast<float>(local.random % (FREE_FOR_ALL_WIDTH - 64)), static_cast<float>((local.random >> 12) % (FREE_FOR_ALL_HEIGHT - 64)));
+			addFreeForAllBullet(local.game, position, sf::Vector2f(std::cos(angle) * BULLET_VELOCITY, std::sin(angle) * BULLET_VELOCITY), local.random % ships);
+		}
+		clock.restart();
+		simulateFreeForAllTick(local.game, local.inputs);
+		sf::Int64 elapsed = clock.getElapsedTime().asMicroseconds();
+		simulated += elapsed;
+		slowest = std::max(slowest, elapsed);
+		entities += ships + local.game.world.archetypes[BULLET_ARCHETYPE].count;
 	}
-	// Update the bullet cooldown rates for both players
-	changeCooldownRates(player1, player2);
+	double mean = static_cast<double>(simulated) / ticks;
+	std::cout << "  " << ships << " ships, " << static_cast<double>(entities) / ticks - ships << " bullets in flight: "
+		<< mean << "us per tick (slowest " << slowest << "us), " << simulated * 1000.0 / entities << "ns per entity" << std::endl;
+	return mean;
+}
+
+/*This function times free for all ticks as ships, then bullets, are added, to show that the cost
+per entity stays about the same. The bots can't die and fire every way at random. Fails if the
+mean tick of any match takes longer than a tick lasts.*/
+int runFreeForAllBenchmark(int ticks)
+{
+	static LocalFreeForAll local;
+	if (ticks < 1)
+		ticks = 1;
+	std::cout << "FREE FOR ALL BENCHMARK (" << ticks << " ticks per match)" << std::endl;
+	double slowest = 0;
+	for (int ships = 8; ships <= MAX_FREE_FOR_ALL_SHIPS; ships *= 2)
+		slowest = std::max(slowest, timeFreeForAll(local, ships, 0, ticks));
+	for (int bullets = 1024; bullets <= MAX_FREE_FOR_ALL_BULLETS; bullets *= 2)
+		slowest = std::max(slowest, timeFreeForAll(local, MAX_FREE_FOR_ALL_SHIPS, bullets, ticks));
+	return (slowest <= TICK_MICROSECONDS) ? 0 : 1;
 }
 
-/*This function removes collided or out of bounds bullets from the bullets linked list.*/
-void removeBullets(std::list<Bullet> &bullets)
+/*This function times the hit test of a free for all of 64 ships and some bullets at random, on 1
+to MAX_COLLISION_THREADS threads. Fails if any thread count finds other hits than one thread.*/
+int runCollisionBenchmark(int bullets)
 {
-	// Remove collided bullets from list.
-	for (std::list<Bullet>::iterator it = bullets.begin(); it != bullets.end(); ++it)
+	static LocalFreeForAll local;
+	bullets = std::max(1, std::min(bullets, MAX_FREE_FOR_ALL_BULLETS));
+	startLocalFreeForAll(local, MAX_FREE_FOR_ALL_SHIPS, FREE_FOR_ALL_BENCHMARK_HEALTH);
+	while (local.game.world.archetypes[BULLET_ARCHETYPE].count < bullets)
+	{
+		local.random = local.random * 1664525u + 1013904223u;
+		float angle = (local.random >> 8) * (6.2831853f / (1 << 24));
+		sf::Vector2f position(static_cast<float>(local.random % (FREE_FOR_ALL_WIDTH - 64)), static_cast<float>((local.random >> 12) % (FREE_FOR_ALL_HEIGHT - 64)));
+		addFreeForAllBullet(local.game, position, sf::Vector2f(std::cos(angle) * BULLET_VELOCITY, std::sin(angle) * BULLET_VELOCITY), local.random % MAX_FREE_FOR_ALL_SHIPS);
+	}
+	std::cout << "COLLISION BENCHMARK (" << bullets << " bullets, " << MAX_FREE_FOR_ALL_SHIPS << " ships, " << FREE_FOR_ALL_REGIONS
+		<< " regions, " << std::thread::hardware_concurrency() << " cores)" << std::endl;
+
+	sf::Uint64 expected = 0;
+	double single = 0;
+	bool same = true;
+	for (int threads = 1; threads <= MAX_COLLISION_THREADS; threads *= 2)
 	{
-		if (it->collided) {
-			bullets.erase(it);
+		JobSystem jobs;
+		startJobSystem(jobs, threads);
+		setFreeForAllJobs(local.game, &jobs);
+		findFreeForAllHits(local.game);	// wakes the workers up once before timing them
+		sf::Clock clock;
+		for (int pass = 0; pass < COLLISION_BENCHMARK_PASSES; ++pass)
+			findFreeForAllHits(local.game);
+		double mean = static_cast<double>(clock.getElapsedTime().asMicroseconds()) / COLLISION_BENCHMARK_PASSES;
+		stopJobSystem(jobs);
+
+		// The hits, in bullet order, as one number
+		sf::Uint64 hash = 14695981039346656037ULL;
+		int hits = 0;
+		for (int i = 0; i < bullets; ++i)
+		{
+			hash = (hash ^ static_cast<sf::Uint8>(local.game.regions.hits[i])) * 1099511628211ULL;
+			hits += (local.game.regions.hits[i] >= 0) ? 1 : 0;
 		}
-		break;
+		if (threads == 1) {
+			expected = hash;
+			single = mean;
+		}
+		std::cout << "  " << threads << " threads: " << mean << "us per pass (" << single / std::max(mean, 1.0) << "x), "
+			<< hits << " hits" << std::endl;
+		if (hash != expected) {
+			std::cout << "  the hits are not the ones of 1 thread" << std::endl;
+			same = false;
+		}
+	}
+	setFreeForAllJobs(local.game, NULL);
+	return same ? 0 : 1;
+}
+
+/*This function draws a free for all frame of 64 ships and some bullets, all in the window, into
+layers without a window: first every entity straight to its layer in world order, as frames used
+to be drawn, then through sorted render commands generated on 1 to MAX_DRAW_THREADS threads. Fails
+if the commands of any thread count are not those of one thread, or draw another number of quads.*/
+int runRenderBenchmark(int bullets)
+{
+	static LocalFreeForAll local;
+	static RenderFrame frame;
+	static DrawJobs jobs;
+	bullets = std::max(1, std::min(bullets, MAX_FREE_FOR_ALL_BULLETS));
+	startLocalFreeForAll(local, MAX_FREE_FOR_ALL_SHIPS, FREE_FOR_ALL_BENCHMARK_HEALTH);
+	while (local.game.world.archetypes[BULLET_ARCHETYPE].count < bullets)
+	{
+		local.random = local.random * 1664525u + 1013904223u;
+		sf::Vector2f position(static_cast<float>(local.random % (VIDEO_WIDTH - 16)), static_cast<float>((local.random >> 12) % (VIDEO_HEIGHT - 16)));
+		addFreeForAllBullet(local.game, position, sf::Vector2f(0, ((local.random >> 24) & 1) ? BULLET_VELOCITY : -BULLET_VELOCITY), local.random % MAX_FREE_FOR_ALL_SHIPS);
+	}
+	frame.scene = gameplay;
+	frame.freeForAll = true;
+	frame.world = local.game.world;
+	frame.camera = sf::Vector2f(0, 0);
+
+	// Textures are never loaded or drawn, only the vertices are built
+	Assets assets;
+	initializeSpriteTypes(assets);
+	initializeDrawJobs(jobs, assets.spriteTypes);
+	Compositor compositor;
+	initializeCompositor(compositor, VIDEO_WIDTH, VIDEO_HEIGHT);
+	addLayer(compositor, "background", false);
+	addLayer(compositor, "bullets", false);
+	addLayer(compositor, "ships", false);
+	addLayer(compositor, "hud", false);
+	std::cout << "RENDER BENCHMARK (" << bullets << " bullets, " << MAX_FREE_FOR_ALL_SHIPS << " ships, "
+		<< std::thread::hardware_concurrency() << " cores)" << std::endl;
+
+	sf::Clock clock;
+	for (int pass = 0; pass < RENDER_BENCHMARK_FRAMES; ++pass)
+	{
+		beginFrame(compositor);
+		DirectDrawSystem system = { &compositor, assets.spriteTypes, frame.camera };
+		forEachArchetype(frame.world, componentBit<Position>() | componentBit<Appearance>(), system);
 	}
+	double direct = static_cast<double>(clock.getElapsedTime().asMicroseconds()) / RENDER_BENCHMARK_FRAMES;
+	std::size_t expectedVertices = 0;
+	for (int i = 0; i < compositor.layerCount; ++i)
+		for (std::size_t batch = 0; batch < compositor.layers[i].batches.size(); ++batch)
+			expectedVertices += compositor.layers[i].batches[batch].vertices.getVertexCount();
+	std::cout << "  straight to layers: " << direct << "us per frame, " << expectedVertices / 6 << " quads" << std::endl;
 
-	// Remove old bullets from list.
-	for (std::list<Bullet>::iterator it = bullets.begin(); it != bullets.end(); ++it)
+	sf::Uint64 expected = 0;
+	bool same = true;
+	for (int threads = 1; threads <= MAX_DRAW_THREADS; threads *= 2)
 	{
-		sf::Vector2f bulletBoundary = it->facingUp ? sf::Vector2f(0, -BULLET_VELOCITY) : sf::Vector2f(0, BULLET_VELOCITY);
-		if (!willBeInBounds(it->sprite, bulletBoundary))
+		JobSystem drawThreads;
+		startJobSystem(drawThreads, threads);
+		beginFrame(compositor);
+		drawEntities(compositor, jobs, &drawThreads, frame, assets.spriteTypes);	// wakes the workers up once before timing them
+		clock.restart();
+		for (int pass = 0; pass < RENDER_BENCHMARK_FRAMES; ++pass)
 		{
-			bullets.erase(it);
-			break;
+			beginFrame(compositor);
+			drawEntities(compositor, jobs, &drawThreads, frame, assets.spriteTypes);
+		}
+		double mean = static_cast<double>(clock.getElapsedTime().asMicroseconds()) / RENDER_BENCHMARK_FRAMES;
+		stopJobSystem(drawThreads);
+
+		// The sorted keys, which tell the commands and their order, as one number
+		sf::Uint64 hash = 14695981039346656037ULL;
+		for (std::size_t i = 0; i < jobs.commands.sorted.size(); ++i)
+			hash = (hash ^ jobs.commands.sorted[i]) * 1099511628211ULL;
+		std::size_t vertices = 0;
+		for (int i = 0; i < compositor.layerCount; ++i)
+			for (std::size_t batch = 0; batch < compositor.layers[i].batches.size(); ++batch)
+				vertices += compositor.layers[i].batches[batch].vertices.getVertexCount();
+		if (threads == 1)
+			expected = hash;
+		std::cout << "  " << threads << " threads: " << mean << "us per frame (" << direct / std::max(mean, 1.0) << "x), "
+			<< jobs.chunks.size() << " chunks, " << countRenderCommands(jobs.commands) << " commands" << std::endl;
+		if (hash != expected || vertices != expectedVertices) {
+			std::cout << "  the commands are not the ones of 1 thread, or draw other quads" << std::endl;
+			same = false;
 		}
 	}
+	return same ? 0 : 1;
 }
 
-/*This function checks for three types of collisions in the game: bullet-bullet collision,
-bullet-player1 collision and bullet-player2 collision.*/
-void checkCollisions(std::list<Bullet> &bullets, Player &player1, Player &player2)
+/*This function plays a bullet hell of every emitter the arena holds, against one ship that can't
+die, and prints how many bullets its ticks move, hit test and keep per second, on one core. Then
+it times the integration kernel alone over MAX_FREE_FOR_ALL_BULLETS bullets, against the same loop
+one bullet at a time. Fails if a mean tick takes longer than a tick lasts, or if the kernel does
+not compute the same positions.*/
+int runBulletHellBenchmark(int ticks)
 {
-	// Create an iterator to traverse the list 
-	for (std::list<Bullet>::iterator it = bullets.begin(); it != bullets.end(); ++it)
+	static LocalFreeForAll local;
+	if (ticks < 1)
+		ticks = 1;
+	std::cout << "BULLET HELL BENCHMARK (" << ticks << " ticks, " << MAX_FREE_FOR_ALL_EMITTERS << " emitters, "
+		<< (BULLET_KERNEL_SSE2 ? "SSE2" : "scalar") << " kernel)" << std::endl;
+	startLocalFreeForAll(local, 1, FREE_FOR_ALL_BENCHMARK_HEALTH);
+	addBulletHellEmitters(local.game, MAX_FREE_FOR_ALL_EMITTERS);
+	sf::Int64 simulated = 0, slowest = 0;
+	sf::Uint64 bullets = 0;
+	sf::Clock clock;
+	for (int tick = 0; tick < ticks; ++tick)
 	{
-		if (it->facingUp)
-			it->sprite.move(0, -BULLET_VELOCITY);
-		if (!(it->facingUp))
-			it->sprite.move(0, BULLET_VELOCITY);
+		clock.restart();
+		simulateFreeForAllTick(local.game, local.inputs);
+		sf::Int64 elapsed = clock.getElapsedTime().asMicroseconds();
+		simulated += elapsed;
+		slowest = std::max(slowest, elapsed);
+		bullets += local.game.world.archetypes[BULLET_ARCHETYPE].count;
 	}
+	double mean = static_cast<double>(simulated) / ticks;
+	std::cout << "  ticks: " << static_cast<double>(bullets) / ticks << " bullets in flight, " << mean << "us per tick (slowest "
+		<< slowest << "us), " << bullets * 1e6 / std::max<sf::Int64>(simulated, 1) << " bullets per second per core" << std::endl;
 
-	// Compare bullets to check for collision
-	for (std::list<Bullet>::iterator it = bullets.begin(); it != bullets.end(); ++it)
+	// The kernel alone, over the bullets of the last tick and random ones up to a full arena
+	const World &world = local.game.world;
+	int count = world.archetypes[BULLET_ARCHETYPE].count;
+	std::vector<Position> positions(MAX_FREE_FOR_ALL_BULLETS), scalarPositions;
+	std::vector<Velocity> velocities(MAX_FREE_FOR_ALL_BULLETS);
+	std::copy(getColumn<Position>(world, BULLET_ARCHETYPE), getColumn<Position>(world, BULLET_ARCHETYPE) + count, positions.begin());
+	std::copy(getColumn<Velocity>(world, BULLET_ARCHETYPE), getColumn<Velocity>(world, BULLET_ARCHETYPE) + count, velocities.begin());
+	for (int i = count; i < MAX_FREE_FOR_ALL_BULLETS; ++i)
 	{
-		// Check for bullet-ship1 collision
-		if (it->facingUp && overlap(it->sprite, player1.sprite)) {
-			it->collided = true;
-			player1.playerHit = true;
-			player1.health--;
-			continue;
+		local.random = local.random * 1664525u + 1013904223u;
+		positions[i].x = static_cast<float>(local.random % FREE_FOR_ALL_WIDTH);
+		positions[i].y = static_cast<float>((local.random >> 12) % FREE_FOR_ALL_HEIGHT);
+		velocities[i].x = static_cast<float>(local.random >> 24) / 32 - 4;
+		velocities[i].y = static_cast<float>((local.random >> 16) & 255) / 32 - 4;
+	}
+	scalarPositions = positions;
+	clock.restart();
+	for (int pass = 0; pass < BULLET_KERNEL_BENCHMARK_PASSES; ++pass)
+		integrateBulletsScalar(&scalarPositions[0], &velocities[0], MAX_FREE_FOR_ALL_BULLETS);
+	sf::Int64 scalarTime = std::max<sf::Int64>(clock.getElapsedTime().asMicroseconds(), 1);
+	clock.restart();
+	for (int pass = 0; pass < BULLET_KERNEL_BENCHMARK_PASSES; ++pass)
+		integrateBullets(&positions[0], &velocities[0], MAX_FREE_FOR_ALL_BULLETS);
+	sf::Int64 kernelTime = std::max<sf::Int64>(clock.getElapsedTime().asMicroseconds(), 1);
+	double moved = static_cast<double>(BULLET_KERNEL_BENCHMARK_PASSES) * MAX_FREE_FOR_ALL_BULLETS;
+	std::cout << "  one bullet at a time: " << moved * 1e6 / scalarTime << " bullets per second per core" << std::endl;
+	std::cout << "  kernel: " << moved * 1e6 / kernelTime << " bullets per second per core ("
+		<< static_cast<double>(scalarTime) / kernelTime << "x)" << std::endl;
+
+	bool same = true;
+	for (int i = 0; i < MAX_FREE_FOR_ALL_BULLETS; ++i)
+		same = same && positions[i].x == scalarPositions[i].x && positions[i].y == scalarPositions[i].y;
+	if (!same)
+		std::cout << "  the kernel did not compute the same positions" << std::endl;
+	return (same && mean <= TICK_MICROSECONDS) ? 0 : 1;
+}
+
+/*This function is the wave of PATTERN_BENCHMARK_SCRIPT written in C++, one bullet at a time, with
+the bounds test of removePatternBullets.*/
+void updateHandWrittenWaves(std::vector<HandWrittenWave> &bullets, const sf::FloatRect &bounds)
+{
+	for (std::size_t i = 0; i < bullets.size(); ++i)
+	{
+		HandWrittenWave &bullet = bullets[i];
+		if (bullet.age == 0) {
+			bullet.baseX = bullet.vx;
+			bullet.baseY = bullet.vy;
 		}
-		// Check for bullet-ship2 collision
-		else if (!(it->facingUp) && overlap(it->sprite, player2.sprite)) {
-			it->collided = true;
-			player2.playerHit = true;
-			player2.health--;
+		float side = std::sin(bullet.age * .1f) * .8f;
+		bullet.vx = bullet.baseX - bullet.baseY * side;
+		bullet.vy = bullet.baseY + bullet.baseX * side;
+		bullet.x += bullet.vx;
+		bullet.y += bullet.vy;
+		bullet.age += 1;
+		bullet.killed = !bounds.contains(bullet.x, bullet.y);
+	}
+}
+
+/*This function runs some bullets of the wave pattern for PATTERN_BENCHMARK_TICKS ticks, through
+the pattern VM and through the same pattern written in C++, and prints how long a tick of each
+took. Fails if the two do not end at the same positions, or if a mean tick of the VM takes longer
+than a tick lasts.*/
+int runPatternBenchmark(int bullets)
+{
+	if (bullets < 1)
+		bullets = 1;
+	PatternLibrary library;
+	if (!assemblePatterns(PATTERN_BENCHMARK_SCRIPT, library, std::cout))
+		return 1;
+	PatternVM vm;
+	initializePatternVM(vm, &library, bullets);
+	std::vector<HandWrittenWave> handWritten(bullets);
+	sf::Uint32 random = FREE_FOR_ALL_BOT_SEED;
+	for (int i = 0; i < bullets; ++i)
+	{
+		random = random * 1664525u + 1013904223u;
+		float angle = (random >> 8) * (6.2831853f / (1 << 24));
+		HandWrittenWave bullet = { static_cast<float>(random % FREE_FOR_ALL_WIDTH), static_cast<float>((random >> 12) % FREE_FOR_ALL_HEIGHT),
+			std::cos(angle) * BULLET_VELOCITY, std::sin(angle) * BULLET_VELOCITY, 0, 0, 0, false };
+		handWritten[i] = bullet;
+		addPatternBullet(vm, 0, sf::Vector2f(bullet.x, bullet.y), sf::Vector2f(bullet.vx, bullet.vy), 0);
+	}
+	// Far enough that no bullet leaves, both sides keep all of them
+	sf::FloatRect bounds(-1e9f, -1e9f, 2e9f, 2e9f);
+
+	std::cout << "PATTERN BENCHMARK (" << bullets << " bullets, " << PATTERN_BENCHMARK_TICKS << " ticks, "
+		<< library.scripts[0].code.size() << " instructions)" << std::endl;
+	sf::Clock clock;
+	for (int tick = 0; tick < PATTERN_BENCHMARK_TICKS; ++tick)
+	{
+		runPatterns(vm);
+		removePatternBullets(vm, bounds);
+	}
+	double vmTime = static_cast<double>(clock.getElapsedTime().asMicroseconds()) / PATTERN_BENCHMARK_TICKS;
+	clock.restart();
+	for (int tick = 0; tick < PATTERN_BENCHMARK_TICKS; ++tick)
+		updateHandWrittenWaves(handWritten, bounds);
+	double handWrittenTime = static_cast<double>(clock.getElapsedTime().asMicroseconds()) / PATTERN_BENCHMARK_TICKS;
+	std::cout << "  pattern VM: " << vmTime << "us per tick, " << vmTime * 1000 / bullets << "ns per bullet" << std::endl;
+	std::cout << "  hand written: " << handWrittenTime << "us per tick, " << handWrittenTime * 1000 / bullets << "ns per bullet (the VM takes "
+		<< vmTime / std::max(handWrittenTime, 1.0) << "x as long)" << std::endl;
+
+	const float* x = getPatternRegister(vm, 0, registerX);
+	const float* y = getPatternRegister(vm, 0, registerY);
+	bool same = (vm.groups[0].count == bullets);
+	for (int i = 0; same && i < bullets; ++i)
+		same = (x[i] == handWritten[i].x && y[i] == handWritten[i].y);
+	if (!same)
+		std::cout << "  the pattern VM and the hand written pattern did not move the bullets the same" << std::endl;
+	return (same && vmTime <= TICK_MICROSECONDS) ? 0 : 1;
+}
+
+/*This function watches, or relays, a match without a window: for some seconds, or until "Enter"
+is pressed if seconds is 0. Fails if the match could not be followed exactly.*/
+int runHeadlessSpectator(SpectatorSession &session, int seconds)
+{
+	HeadlessSpectator watch;
+	watch.session = &session;
+	watch.running = true;
+	watch.seconds = seconds;
+	if (seconds > 0)
+		updateHeadlessSpectator(&watch);
+	else
+	{
+		sf::Thread thread(&updateHeadlessSpectator, &watch);
+		thread.launch();
+		std::cout << "Press Enter to stop." << std::endl;
+		std::cin.get();
+		watch.running = false;
+		thread.wait();
+	}
+	printSpectatorReport(session, std::cout);
+	return (session.synced && session.desyncs == 0 && session.badHashes == 0) ? 0 : 1;
+}
+
+/*This function updates a spectator session once per tick until it is stopped or the time is up.*/
+void updateHeadlessSpectator(HeadlessSpectator* watch)
+{
+	sf::Clock clock;
+	sf::Int64 simTime = 0;
+	while (watch->running && (watch->seconds <= 0 || simTime < static_cast<sf::Int64>(watch->seconds) * 1000000))
+	{
+		sf::Int64 now = clock.getElapsedTime().asMicroseconds();
+		if (simTime + TICK_MICROSECONDS > now) {
+			sf::sleep(sf::microseconds(simTime + TICK_MICROSECONDS - now));
 			continue;
 		}
+		simTime += TICK_MICROSECONDS;
+		updateSpectator(*watch->session);
+	}
+}
 
-		// Check for bullet-bullet collision
-		for (std::list<Bullet>::iterator iterator = bullets.begin(); iterator != bullets.end(); ++iterator) {
-			// Avoid comparing the same bullet
-			if (it == iterator)
-				break;
-			// Ignore comparing bullets spawned by same ship
-			if (it->facingUp == iterator->facingUp)
+/*This function plays the part of the input thread for --headless-latency: it starts a match,
+then presses and releases the movement and fire keys at random intervals, and closes.*/
+void sendSyntheticInput(GameThreadData* data)
+{
+	const sf::Keyboard::Key keys[] = { sf::Keyboard::Left, sf::Keyboard::Right, sf::Keyboard::A,
+		sf::Keyboard::D, sf::Keyboard::RShift, sf::Keyboard::Space };
+	const int keyCount = sizeof(keys) / sizeof(keys[0]);
+	std::srand(1);
+
+	sf::Event event;
+	event.type = sf::Event::KeyPressed;
+	event.key.code = sf::Keyboard::Return;
+	event.key.alt = event.key.control = event.key.shift = event.key.system = false;
+
+	while (data->inputClock->getElapsedTime().asSeconds() < HEADLESS_LATENCY_SECONDS)
+	{
+		TimedEvent timed;
+		timed.event = event;
+		timed.time = data->inputClock->getElapsedTime().asMicroseconds();
+		while (!pushInput(*data->input, timed))
+			sf::sleep(sf::milliseconds(1));
+
+		// Next: a random key, pressed or released, a few milliseconds later
+		event.type = (std::rand() % 2) ? sf::Event::KeyPressed : sf::Event::KeyReleased;
+		event.key.code = keys[std::rand() % keyCount];
+		sf::sleep(sf::microseconds(1000 + std::rand() % 20000));
+	}
+
+	TimedEvent closed;
+	closed.event.type = sf::Event::Closed;
+	closed.time = data->inputClock->getElapsedTime().asMicroseconds();
+	while (!pushInput(*data->input, closed))
+		sf::sleep(sf::milliseconds(1));
+}
+
+/*This function applies the events that happened before tickEnd, then advances the world by one tick.
+In a network match the local keys drive the local player and the other player's input comes from
+the lockstep or rollback session. On a dedicated server the server runs the match, the local ship
+is only predicted.*/
+void runTick(GameState &state, GameThreadData &data, sf::Int64 tickEnd, LatencyStats &latency)
+{
+	InputQueue &input = *data.input;
+	LockstepSession* network = data.network;
+	RollbackSession* rollback = data.rollback;
+	ClientSession* client = data.client;
+	TimedEvent timed;
+
+	// HANDLE EVENTS that happened before the end of this tick
+	while (peekInput(input, timed) && timed.time < tickEnd)
+	{
+		popInput(input);
+		handleEvent(state, timed.event);
+
+		inputType type;
+		if (getInputType(timed.event, type))
+			recordInputApplied(latency, type, timed.time);
+	}
+
+	if (state.scene == gameplay)
+	{
+		// Every system this tick reads the same snapshot of the keyboard
+		KeyboardState tickKeys = state.keyboard;
+		sf::Uint8 input1 = getPlayerInput(tickKeys, sf::Keyboard::Left, sf::Keyboard::Right, sf::Keyboard::RShift);
+		sf::Uint8 input2 = getPlayerInput(tickKeys, sf::Keyboard::A, sf::Keyboard::D, sf::Keyboard::Space);
+		if (data.spectator)
+		{
+			// Nobody plays here, the keys are ignored
+			updateSpectator(*data.spectator);
+			getSpectatorView(*data.spectator, state.match);
+		}
+		else if (data.freeForAll)
+		{
+			// Either control scheme steers the local ship, which fires at the nearest ship
+			LocalFreeForAll &local = *data.freeForAll;
+			FreeForAllInput &own = local.inputs[0];
+			own.buttons = input1 | input2;
+			if (isKeyDown(tickKeys, sf::Keyboard::Up) || isKeyDown(tickKeys, sf::Keyboard::W))
+				own.buttons |= INPUT_UP;
+			if (isKeyDown(tickKeys, sf::Keyboard::Down) || isKeyDown(tickKeys, sf::Keyboard::S))
+				own.buttons |= INPUT_DOWN;
+			int target = getNearestShip(local.game, 0);
+			if (target >= 0)
+				own.aim = getAimAt(local.game, 0, target);
+			updateFreeForAllBots(local, 1);
+			simulateFreeForAllTick(local.game, local.inputs);
+		}
+		else if (client)
+		{
+			// The server restarts finished matches itself, there is no result screen
+			advanceClient(*client, input1 | input2);
+			getClientView(*client, state.match);
+		}
+		else if (rollback)
+		{
+			advanceRollback(*rollback, state.match, input1 | input2);	// either control scheme works online
+
+			// A death that is still a guess may be rolled back, wait until it is confirmed
+			const Match &confirmed = getConfirmedMatch(*rollback, state.match);
+			if (isMatchOver(confirmed) && confirmed.round != state.resultRound) {
+				state.resultRound = confirmed.round;
+				state.scene = result;
+			}
+		}
+		else
+		{
+			if (network)
+				advanceLockstep(*network, input1 | input2, input1, input2);
+			simulateTick(state.match, input1, input2);
+			if (network)
+				recordState(*network, network->tick - 1, state.match);
+
+			// Change scene if player died
+			if (isMatchOver(state.match))
+				state.scene = result;
+		}
+	}
+	clearTickPresses(state.keyboard);
+	recordTickFinished(latency, data.inputClock->getElapsedTime().asMicroseconds());
+}
+
+/*This function reacts to one input event: key tracking, scene changes and closing.*/
+void handleEvent(GameState &state, const sf::Event &event)
+{
+	updateKeyboardState(state.keyboard, event);
+	switch (state.scene)
+	{
+	case start:
+		// Trigger gameplay when "Enter" is pressed
+		if (wasKeyPressed(event, sf::Keyboard::Return))
+			state.scene = gameplay;
+		break;
+	case gameplay:
+		if (wasKeyPressed(event, sf::Keyboard::Escape)) {
+			// There is no title screen to go back to online or in a free for all, leave the match
+			if (state.networked || state.freeForAll) {
+				state.running = false;
 				break;
-			if (overlap(it->sprite, iterator->sprite)) {
-				it->collided = true;
-				iterator->collided = true;
 			}
+			initializePlayerSettings(state.match);
+			state.scene = start;
+		}
+		break;
+	case result:
+		// Restart game when "Enter is pressed (online, the rematch starts by itself)
+		if (wasKeyPressed(event, sf::Keyboard::R) && !state.networked) {
+			initializePlayerSettings(state.match);
+			state.scene = start;
 		}
+		break;
 	}
+
+	if (event.type == sf::Event::Closed)
+		state.running = false;
 }
 
-/*This function draws the bullet to the window.*/
-void drawBullets(sf::RenderWindow &window, Assets &assets)
+/*This function sorts key presses into the input types latency is reported for.*/
+bool getInputType(const sf::Event &event, inputType &type)
 {
-	window.draw(assets.ocean);
+	if (event.type != sf::Event::KeyPressed)
+		return false;
 
-	// Draw each sprite from list
-	for (std::list<Bullet>::iterator it = assets.bullets->begin(); it != assets.bullets->end(); ++it)
+	switch (event.key.code)
 	{
-		if (!it->collided)
-			window.draw(it->sprite);
-		// Move collided bullets out of the screen and delete from list later (fix with better solution later).
-		if (it->collided)
-			it->sprite.setPosition(1200, 1200);
+	case sf::Keyboard::Left:
+	case sf::Keyboard::Right:
+	case sf::Keyboard::A:
+	case sf::Keyboard::D:
+		type = moveInput;
+		return true;
+	case sf::Keyboard::RShift:
+	case sf::Keyboard::Space:
+		type = fireInput;
+		return true;
+	case sf::Keyboard::Return:
+	case sf::Keyboard::Escape:
+	case sf::Keyboard::R:
+		type = menuInput;
+		return true;
+	default:
+		return false;
 	}
 }
 
-/*This function draw each player sprites on the window if the players are alive, and change the scene if game is over.*/
-void drawPlayers(sf::RenderWindow &window, Player &player1, Player &player2, gameScene &scene)
+/******************************************** Game Functions ********************************************/
+
+/*This function draws the result screen*/
+void showResults(sf::RenderWindow &window, int winner, Assets &assets)
 {
-	// Draw player1 ship
-	if (player1.health > 0) {
-		window.draw(player1.sprite);
-	}
-	// Draw player1 health bar
-	player1.healthBar.setSize(sf::Vector2f(player1.health * HEALTH_BAR_WIDTH, HEALTH_BAR_HEIGHT));
-	window.draw(player1.healthBar);
+	// clear window
+	window.clear();
+
+	sf::Sprite resultScene;
+	resultScene.setTexture(assets.resultImg);
+	resultScene.setScale(RESULT_IMG_SCALE_X, RESULT_IMG_SCALE_Y);
+
+	window.draw(resultScene);
+
+	// Draw result scene (text was laid out in loadAssets)
+	if (winner == 2)
+		drawCachedText(window, assets.player2Wins);
+	else
+		drawCachedText(window, assets.player1Wins);
+}
 
-	// Draw player2 ship
-	if (player2.health > 0) {
-		window.draw(player2.sprite);
+/*This function sets up the title screen.*/
+void initializeTitleScreen(sf::Sprite &titleScreen, sf::Sprite &titleInstructions, Assets &assets)
+{
+	// Create background image
+	titleScreen.setTexture(assets.background);
+	titleScreen.setScale(TITLE_BACKGROUND_SCALE_X, TITLE_BACKGROUND_SCALE_Y);
+	// Create instruction textbox
+	assets.instructions.loadFromFile(resourcePath() + "assets/instructions.png");
+	titleInstructions.setTexture(assets.instructions);
+	titleInstructions.setPosition(INSTRUCTIONS_POS_X, INSTRUCTIONS_POS_Y);
+	// Create title text
+	
+}
+
+/*This function draws the title screen sprites once into an off-screen texture.*/
+void bakeTitleScreen(sf::RenderTexture &titleCache, sf::Sprite &titleScreen, sf::Sprite &titleImg, sf::Sprite &titleInstructions)
+{
+	titleCache.create(VIDEO_WIDTH, VIDEO_HEIGHT);
+	titleCache.clear();
+	/*assets.title.setString("Toasty Duels");
+	assets.title.setColor(sf::Color::Black);
+	assets.title.setPosition(100, 200);
+	titleCache.draw(assets.title);*/
+	titleCache.draw(titleScreen);
+	titleCache.draw(titleImg);	// Add title image
+	titleCache.draw(titleInstructions);
+	titleCache.display();
+}
+
+/*This function tells the simulation thread whether a scene has to be redrawn every tick or only
+when an event changes it. Frames of a renderOnChange scene are only published when the scene
+changes, so the render thread sleeps in waitForFrontSlot while it is up.*/
+renderPolicy getRenderPolicy(gameScene scene)
+{
+	switch (scene)
+	{
+	case start:
+		return renderOnChange;
+	case result:
+		return renderOnChange;
+	default:
+		return renderContinuous;
 	}
-	// Draw player2 health bar
-	player2.healthBar.setSize(sf::Vector2f(player2.health * HEALTH_BAR_WIDTH, HEALTH_BAR_HEIGHT));
-	window.draw(player2.healthBar);
+}
 
-	// Change scene if player died
-	if (player1.health == 0 || player2.health == 0)
-		scene = result;
+/*This function loads the textures from assets folder.*/
+void loadAssets(Assets &assets)
+{
+	// Title screen assets
+	assets.titlePng.loadFromFile(resourcePath() + "assets/title.png");
+	assets.background.loadFromFile(resourcePath() + "assets/battleshipTitle.jpg");
+	assets.myFont.loadFromFile(resourcePath() + "assets/Cowboys.ttf");
+	// Result screen image and text, loaded and baked once so showResults never hits the disk or FreeType
+	assets.resultImg.loadFromFile(resourcePath() + "assets/resultImg.jpg");
+	bakeText(assets.player1Wins, assets.myFont, "Player 1 Wins!", RESULT_TEXT_SIZE, sf::Color::Red);
+	setCachedTextPosition(assets.player1Wins, RESULT_TEXT_POS_X, RESULT_TEXT_POS_Y);
+	bakeText(assets.player2Wins, assets.myFont, "Player 2 Wins!", RESULT_TEXT_SIZE, sf::Color::Red);
+	setCachedTextPosition(assets.player2Wins, RESULT_TEXT_POS_X, RESULT_TEXT_POS_Y);
+	// Game assets
+	assets.ship.loadFromFile(resourcePath() + "assets/battleship.png");
+	assets.bulletDown.loadFromFile(resourcePath() + "assets/bulletDown.png");
+	assets.bulletUp.loadFromFile(resourcePath() + "assets/bulletUp.png");
+	initializeSpriteTypes(assets);
+	assets.gameBckground.loadFromFile(resourcePath() + "assets/gameBackground.jpg");
+	assets.ocean.setTexture(assets.gameBckground);
 }
 
-void changeCooldownRates(Player &player1, Player &player2)
+/*This function builds the collision mask of every appearance from the alpha of its texture, at
+its size on screen, and writes them as the source of SPRITE_MASKS. Only images are loaded, so it
+needs no window. Fails if a texture can't be loaded or the file can't be written.*/
+int runCookMasks(const std::string &path)
 {
-	/*For Player 1*/
-	// Decrease cooldown rate if moving (increase bullet spawn rate).
-	if (player1.moved) {
-		if (player1.cooldownRate > MIN_SHOT_COOLDOWN) {
-			player1.cooldownRate = player1.cooldownRate - (SHOT_COOLDOWN_INC * SHOT_DECAY_MULTIPLIER);
+	const char* const files[APPEARANCE_TYPES] = { "assets/battleship.png", "assets/bulletDown.png", "assets/bulletUp.png" };
+	const char* const names[APPEARANCE_TYPES] = { "shipAppearance", "bulletDownAppearance", "bulletUpAppearance" };
+	const sf::Vector2f sizes[APPEARANCE_TYPES] = {
+		sf::Vector2f(SHIP_WIDTH, SHIP_HEIGHT), sf::Vector2f(BULLET_WIDTH, BULLET_HEIGHT), sf::Vector2f(BULLET_WIDTH, BULLET_HEIGHT)
+	};
+	static PixelMask masks[APPEARANCE_TYPES];
+	for (int i = 0; i < APPEARANCE_TYPES; ++i)
+	{
+		sf::Image image;
+		if (!image.loadFromFile(resourcePath() + files[i])) {
+			std::cout << "Could not load " << files[i] << std::endl;
+			return 1;
 		}
+		buildPixelMask(masks[i], image.getPixelsPtr(), image.getSize().x, image.getSize().y, sizes[i].x, sizes[i].y);
+		std::cout << names[i] << ": " << masks[i].width << "x" << masks[i].height << " pixels" << std::endl;
 	}
-	// Start constant cooldown after first bullet spawned.
-	if (player1.startTrigger)
+	std::ofstream out(path.c_str());
+	writeCookedMasks(out, masks, names, APPEARANCE_TYPES);
+	if (!out) {
+		std::cout << "Could not write " << path << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+/*This function sets how every appearance is drawn, with the textures of assets (loaded or not).*/
+void initializeSpriteTypes(Assets &assets)
+{
+	assets.spriteTypes[shipAppearance].texture = &assets.ship;
+	assets.spriteTypes[shipAppearance].textureRect = sf::IntRect(0, 0, SHIP_TEXTURE_WIDTH, SHIP_TEXTURE_HEIGHT);
+	assets.spriteTypes[shipAppearance].size = sf::Vector2f(SHIP_WIDTH, SHIP_HEIGHT);
+	const sf::Texture* bulletTextures[] = { &assets.bulletDown, &assets.bulletUp };
+	const appearanceType bulletAppearances[] = { bulletDownAppearance, bulletUpAppearance };
+	for (int i = 0; i < 2; ++i)
 	{
-		if (player1.cooldownRate < MAX_SHOT_COOLDOWN) {
-			player1.cooldownRate += SHOT_COOLDOWN_INC;
-			//std::cout << "Shoot cooldown is now: " << player1.cooldownRate << std::endl; /*Print cooldown value*/
-		}
+		SpriteType &type = assets.spriteTypes[bulletAppearances[i]];
+		type.texture = bulletTextures[i];
+		type.textureRect = sf::IntRect(0, 0, BULLET_TEXTURE_WIDTH, BULLET_TEXTURE_HEIGHT);
+		type.size = sf::Vector2f(BULLET_WIDTH, BULLET_HEIGHT);
 	}
+}
 
-	/*For Player 2*/
-	// Decrease cooldown rate if moving (increase bullet spawn rate).
-	if (player2.moved) {
-		if (player2.cooldownRate > MIN_SHOT_COOLDOWN) {
-			player2.cooldownRate = player2.cooldownRate - (SHOT_COOLDOWN_INC * SHOT_DECAY_MULTIPLIER);
-		}
+/*This function turns a player's keys into input bits.*/
+sf::Uint8 getPlayerInput(const KeyboardState &keys, sf::Keyboard::Key left, sf::Keyboard::Key right, sf::Keyboard::Key fire)
+{
+	sf::Uint8 input = 0;
+	if (isKeyDown(keys, left))
+		input |= INPUT_LEFT;
+	if (isKeyDown(keys, right))
+		input |= INPUT_RIGHT;
+	if (isKeyDown(keys, fire))
+		input |= INPUT_FIRE;
+	return input;
+}
+
+/*This function creates the gameplay layers in gameLayer order. The ocean never changes, so the
+background layer is static and filled once. It is a single sprite, so it is drawn as it is rather
+than through a cache.*/
+void initializeLayers(Compositor &compositor, Assets &assets)
+{
+	initializeCompositor(compositor, VIDEO_WIDTH, VIDEO_HEIGHT);
+	addLayer(compositor, "background", true);
+	addLayer(compositor, "bullets", false);
+	addLayer(compositor, "ships", false);
+	addLayer(compositor, "hud", false);
+
+	addSprite(compositor, backgroundLayer, assets.ocean);
+}
+
+// Cuts every archetype with a Position and an Appearance into chunks: ships on the ship layer, the
+// rest (bullets) on the bullet layer.
+struct DrawChunkSystem {
+	DrawJobs* jobs;
+
+	void operator()(World &world, int archetype) const
+	{
+		int layer = getColumn<Health>(world, archetype) ? shipLayer : bulletLayer;
+		addDrawChunks(*jobs, archetype, layer, world.archetypes[archetype].count);
 	}
-	// Start constant cooldown after first bullet spawned.
-	if (player2.startTrigger)
+};
+
+// Draws a bar one HEALTH_BAR_WIDTH long per health point for every entity that has one.
+struct HealthBarSystem {
+	Compositor* compositor;
+
+	void operator()(World &world, int archetype) const
 	{
-		if (player2.cooldownRate < MAX_SHOT_COOLDOWN) {
-			player2.cooldownRate += SHOT_COOLDOWN_INC;
-			//std::cout << "Shoot cooldown is now: " << player1.cooldownRate << std::endl;
+		const Health* health = getColumn<Health>(world, archetype);
+		const HealthBar* bars = getColumn<HealthBar>(world, archetype);
+		for (int i = 0; i < world.archetypes[archetype].count; ++i)
+		{
+			int points = (health[i].points > 0) ? health[i].points : 0;
+			sf::FloatRect bounds(bars[i].position.x, bars[i].position.y,
+				static_cast<float>(points * HEALTH_BAR_WIDTH), static_cast<float>(HEALTH_BAR_HEIGHT));
+			addRectangle(*compositor, hudLayer, bounds, bars[i].color);
 		}
 	}
-}
\ No newline at end of file
+};
+
+/*This function gives every sprite type the id of its texture in the render command buffer.*/
+void initializeDrawJobs(DrawJobs &jobs, SpriteType types[])
+{
+	initializeRenderCommands(jobs.commands);
+	for (int i = 0; i < APPEARANCE_TYPES; ++i)
+		types[i].textureId = addRenderTexture(jobs.commands, types[i].texture);
+}
+
+/*This function cuts rows of an archetype (or scripted bullets) into chunks of jobs.chunkRows.*/
+void addDrawChunks(DrawJobs &jobs, int archetype, int layer, int rows)
+{
+	for (int first = 0; first < rows; first += jobs.chunkRows)
+	{
+		DrawChunk chunk = { archetype, layer, first, std::min(jobs.chunkRows, rows - first) };
+		jobs.chunks.push_back(chunk);
+	}
+}
+
+/*This function turns the entities of one chunk that are in the window into render commands, in the
+list of the chunk. Dead ships and collided bullets are not drawn. Sprites are drawn in order of
+their bottom edge, so a ship lower on screen covers one above it. Runs on any thread, it only
+reads the frame.*/
+void drawChunk(void* data, int job)
+{
+	DrawJobs &jobs = *static_cast<DrawJobs*>(data);
+	const DrawChunk &chunk = jobs.chunks[job];
+	const RenderFrame &frame = *jobs.frame;
+	RenderCommandList &list = jobs.commands.lists[job];
+
+	const Position* positions;
+	const Appearance* appearances = NULL;
+	const Health* health = NULL;
+	const Projectile* projectiles = NULL;
+	if (chunk.archetype == PATTERN_BULLET_CHUNK)
+		positions = &frame.patternBullets[0];
+	else
+	{
+		positions = getColumn<Position>(frame.world, chunk.archetype);
+		appearances = getColumn<Appearance>(frame.world, chunk.archetype);
+		health = getColumn<Health>(frame.world, chunk.archetype);
+		projectiles = getColumn<Projectile>(frame.world, chunk.archetype);
+	}
+	for (int i = chunk.first; i < chunk.first + chunk.count; ++i)
+	{
+		if ((health && health[i].points <= 0) || (projectiles && projectiles[i].collided))
+			continue;
+		const SpriteType &type = jobs.types[appearances ? appearances[i].type : frame.patternAppearances[i]];
+		RenderCommand command;
+		command.x = positions[i].x - frame.camera.x;
+		command.y = positions[i].y - frame.camera.y;
+		command.width = type.size.x;
+		command.height = type.size.y;
+		if (command.x + command.width < 0 || command.y + command.height < 0 || command.x > VIDEO_WIDTH || command.y > VIDEO_HEIGHT)
+			continue;
+		command.u = static_cast<sf::Uint16>(type.textureRect.left);
+		command.v = static_cast<sf::Uint16>(type.textureRect.top);
+		command.uWidth = static_cast<sf::Uint16>(type.textureRect.width);
+		command.vHeight = static_cast<sf::Uint16>(type.textureRect.height);
+		command.color = sf::Color::White;
+		sf::Uint16 depth = static_cast<sf::Uint16>(command.y + command.height);	// on screen, so 0 to VIDEO_HEIGHT + a sprite
+		addRenderCommand(list, makeRenderKey(chunk.layer, type.textureId, depth), command);
+	}
+}
+
+/*This function adds the ships and bullets of a frame that are in the window to their layers,
+scripted bullets included, each looking like its appearance. Chunks of them are turned into
+render commands on threads (NULL for this thread only), then the commands are sorted by layer,
+texture and depth and added in runs.*/
+void drawEntities(Compositor &compositor, DrawJobs &jobs, JobSystem* threads, RenderFrame &frame, const SpriteType types[])
+{
+	jobs.frame = &frame;
+	jobs.types = types;
+	jobs.chunks.clear();
+
+	// Chunks grow past DRAW_CHUNK_ROWS rather than need more lists than a key can tell apart
+	int rows = static_cast<int>(frame.patternBullets.size());
+	for (int i = 0; i < frame.world.archetypeCount; ++i)
+		rows += frame.world.archetypes[i].count;
+	jobs.chunkRows = std::max(DRAW_CHUNK_ROWS, rows / (MAX_RENDER_LISTS - MAX_ARCHETYPES - 1) + 1);
+	DrawChunkSystem system = { &jobs };
+	forEachArchetype(frame.world, componentBit<Position>() | componentBit<Appearance>(), system);
+	addDrawChunks(jobs, PATTERN_BULLET_CHUNK, bulletLayer, static_cast<int>(frame.patternBullets.size()));
+
+	int chunks = static_cast<int>(jobs.chunks.size());
+	beginRenderCommands(jobs.commands, chunks);
+	runJobs(threads, drawChunk, &jobs, chunks);
+	sortRenderCommands(jobs.commands);
+	addRenderCommands(compositor, jobs.commands);
+}
+
+/*This function adds the health bars to the hud layer.*/
+void drawHealthBars(Compositor &compositor, World &world)
+{
+	HealthBarSystem system = { &compositor };
+	forEachArchetype(world, componentBit<Health>() | componentBit<HealthBar>(), system);
+}